@@ -0,0 +1,248 @@
+#include "calculator.hpp"
+#include "call_memo.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CHR_BATCH_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHR_BATCH_SSE2 1
+#endif
+
+namespace chr {
+	namespace {
+		// 每块处理的行数：栈上每一层是一块连续的 double，块内逐运算符执行
+		constexpr size_t BATCH_BLOCK_SIZE = 256;
+
+		// 二元算术核：AVX 每次 4 个、SSE2 每次 2 个，余下部分走标量
+#if defined(CHR_BATCH_AVX)
+#define CHR_BINARY_KERNEL(name, op, intrinsic)                                       \
+		void name(const double* a, const double* b, double* out, size_t n) {       \
+			size_t i = 0;                                                          \
+			for (; i + 4 <= n; i += 4) {                                           \
+				_mm256_storeu_pd(out + i, intrinsic(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i))); \
+			}                                                                      \
+			for (; i < n; i++) {                                                   \
+				out[i] = a[i] op b[i];                                             \
+			}                                                                      \
+		}
+#elif defined(CHR_BATCH_SSE2)
+#define CHR_BINARY_KERNEL(name, op, intrinsic)                                       \
+		void name(const double* a, const double* b, double* out, size_t n) {       \
+			size_t i = 0;                                                          \
+			for (; i + 2 <= n; i += 2) {                                           \
+				_mm_storeu_pd(out + i, intrinsic(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))); \
+			}                                                                      \
+			for (; i < n; i++) {                                                   \
+				out[i] = a[i] op b[i];                                             \
+			}                                                                      \
+		}
+#else
+#define CHR_BINARY_KERNEL(name, op, intrinsic)                                       \
+		void name(const double* a, const double* b, double* out, size_t n) {       \
+			for (size_t i = 0; i < n; i++) {                                       \
+				out[i] = a[i] op b[i];                                             \
+			}                                                                      \
+		}
+#endif
+
+#if defined(CHR_BATCH_AVX)
+		CHR_BINARY_KERNEL(add_kernel, +, _mm256_add_pd)
+		CHR_BINARY_KERNEL(subtract_kernel, -, _mm256_sub_pd)
+		CHR_BINARY_KERNEL(multiply_kernel, *, _mm256_mul_pd)
+		CHR_BINARY_KERNEL(divide_kernel, /, _mm256_div_pd)
+#else
+		CHR_BINARY_KERNEL(add_kernel, +, _mm_add_pd)
+		CHR_BINARY_KERNEL(subtract_kernel, -, _mm_sub_pd)
+		CHR_BINARY_KERNEL(multiply_kernel, *, _mm_mul_pd)
+		CHR_BINARY_KERNEL(divide_kernel, /, _mm_div_pd)
+#endif
+#undef CHR_BINARY_KERNEL
+
+		// 开方与取负：sqrtsd/sqrtpd 与标量 sqrt 结果一致，取负通过翻转符号位实现
+		void square_root_kernel(const double* a, double* out, size_t n) {
+			size_t i = 0;
+#if defined(CHR_BATCH_AVX)
+			for (; i + 4 <= n; i += 4) {
+				_mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_loadu_pd(a + i)));
+			}
+#elif defined(CHR_BATCH_SSE2)
+			for (; i + 2 <= n; i += 2) {
+				_mm_storeu_pd(out + i, _mm_sqrt_pd(_mm_loadu_pd(a + i)));
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = sqrt(a[i]);
+			}
+		}
+		void negate_kernel(const double* a, double* out, size_t n) {
+			size_t i = 0;
+#if defined(CHR_BATCH_AVX)
+			const __m256d sign = _mm256_set1_pd(-0.0);
+			for (; i + 4 <= n; i += 4) {
+				_mm256_storeu_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+			}
+#elif defined(CHR_BATCH_SSE2)
+			const __m128d sign = _mm_set1_pd(-0.0);
+			for (; i + 2 <= n; i += 2) {
+				_mm_storeu_pd(out + i, _mm_xor_pd(_mm_loadu_pd(a + i), sign));
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = -a[i];
+			}
+		}
+
+		// 其余运算没有对应的向量指令，逐元素调用与字节码解释器相同的标量实现
+		template <typename Func>
+		void unary_loop(const double* a, double* out, size_t n, Func func) {
+			for (size_t i = 0; i < n; i++) {
+				out[i] = func(a[i]);
+			}
+		}
+		template <typename Func>
+		void binary_loop(const double* a, const double* b, double* out, size_t n, Func func) {
+			for (size_t i = 0; i < n; i++) {
+				out[i] = func(a[i], b[i]);
+			}
+		}
+
+		void unary_kernel(opcode op, const double* a, double* out, size_t n) {
+			switch (op) {
+			case opcode::negate: negate_kernel(a, out, n); break;
+			case opcode::square_root: square_root_kernel(a, out, n); break;
+			case opcode::factorial: unary_loop(a, out, n, [](double x) { return tgamma(x + 1); }); break;
+			case opcode::sine: unary_loop(a, out, n, [](double x) { return sin(x); }); break;
+			case opcode::cosine: unary_loop(a, out, n, [](double x) { return cos(x); }); break;
+			case opcode::tangent: unary_loop(a, out, n, [](double x) { return tan(x); }); break;
+			case opcode::cotangent: unary_loop(a, out, n, [](double x) { return 1 / tan(x); }); break;
+			case opcode::secant: unary_loop(a, out, n, [](double x) { return 1 / cos(x); }); break;
+			case opcode::cosecant: unary_loop(a, out, n, [](double x) { return 1 / sin(x); }); break;
+			case opcode::arcsine: unary_loop(a, out, n, [](double x) { return asin(x); }); break;
+			case opcode::arccosine: unary_loop(a, out, n, [](double x) { return acos(x); }); break;
+			case opcode::arctangent: unary_loop(a, out, n, [](double x) { return atan(x); }); break;
+			case opcode::arccotangent: unary_loop(a, out, n, [](double x) { return atan(1 / x); }); break;
+			case opcode::arcsecant: unary_loop(a, out, n, [](double x) { return acos(1 / x); }); break;
+			case opcode::arccosecant: unary_loop(a, out, n, [](double x) { return asin(1 / x); }); break;
+			case opcode::common_logarithm: unary_loop(a, out, n, [](double x) { return log10(x); }); break;
+			case opcode::natural_logarithm: unary_loop(a, out, n, [](double x) { return log(x); }); break;
+			case opcode::cubic_root: unary_loop(a, out, n, [](double x) { return cbrt(x); }); break;
+			case opcode::degree: unary_loop(a, out, n, [](double x) { return x / CONSTANT_PI * 180; }); break;
+			case opcode::radian: unary_loop(a, out, n, [](double x) { return x / 180 * CONSTANT_PI; }); break;
+			default: throw std::runtime_error("批量求值时出现无法执行的一元操作码");
+			}
+		}
+
+		void binary_kernel(opcode op, const double* a, const double* b, double* out, size_t n) {
+			switch (op) {
+			case opcode::add: add_kernel(a, b, out, n); break;
+			case opcode::subtract: subtract_kernel(a, b, out, n); break;
+			case opcode::multiply: multiply_kernel(a, b, out, n); break;
+			case opcode::divide: divide_kernel(a, b, out, n); break;
+			case opcode::modulo: binary_loop(a, b, out, n, [](double x, double y) { return static_cast<double>(fmodl(x, y)); }); break;
+			case opcode::exponent: binary_loop(a, b, out, n, [](double x, double y) { return pow(x, y); }); break;
+			case opcode::minimum: binary_loop(a, b, out, n, [](double x, double y) { return fmin(x, y); }); break;
+			case opcode::maximum: binary_loop(a, b, out, n, [](double x, double y) { return fmax(x, y); }); break;
+			case opcode::hypotenuse: binary_loop(a, b, out, n, [](double x, double y) { return hypot(x, y); }); break;
+			default: throw std::runtime_error("批量求值时出现无法执行的二元操作码");
+			}
+		}
+
+		// 带记忆表时代价高的纯函数逐元素查表，其余运算以及暂停查表的区段仍走上面的核
+		void unary_kernel(opcode op, const double* a, double* out, size_t n, call_memo* memo) {
+			if (memo == nullptr || !is_memoizable(op)) {
+				unary_kernel(op, a, out, n);
+				return;
+			}
+			for (size_t i = 0; i < n;) {
+				if (size_t count = memo->bypass(op, n - i); count != 0) {
+					unary_kernel(op, a + i, out + i, count);
+					i += count;
+					continue;
+				}
+				out[i] = memo->apply(op, a[i], 0.0);
+				i++;
+			}
+		}
+
+		void binary_kernel(opcode op, const double* a, const double* b, double* out, size_t n, call_memo* memo) {
+			if (memo == nullptr || !is_memoizable(op)) {
+				binary_kernel(op, a, b, out, n);
+				return;
+			}
+			for (size_t i = 0; i < n;) {
+				if (size_t count = memo->bypass(op, n - i); count != 0) {
+					binary_kernel(op, a + i, b + i, out + i, count);
+					i += count;
+					continue;
+				}
+				out[i] = memo->apply(op, a[i], b[i]);
+				i++;
+			}
+		}
+
+		// 批量求值：按块逐条执行字节码，每条指令在整块数据上运行一次向量化循环
+		// 栈中每层只记录一个指向数据的指针，变量与缓存直接引用输入列/缓存块，只有运算结果写入暂存块
+		void execute_batch(const expression& expr, std::span<const std::span<const double>> columns, std::span<double> output, call_memo* memo) {
+			size_t variable_count = expr.variables().size();
+			if (columns.size() < variable_count) {
+				throw std::runtime_error("批量求值的输入列数量不足：需要 " + std::to_string(variable_count) + " 列");
+			}
+			for (size_t slot = 0; slot < variable_count; slot++) {
+				if (columns[slot].size() < output.size()) {
+					throw std::runtime_error("批量求值的输入列长度小于输出长度：" + std::string(expr.variables()[slot]));
+				}
+			}
+			std::vector<double> scratch(expr.max_depth() * BATCH_BLOCK_SIZE);
+			std::vector<double> temps(expr.temp_count() * BATCH_BLOCK_SIZE);
+			std::vector<const double*> stack(expr.max_depth());
+			for (size_t row = 0; row < output.size(); row += BATCH_BLOCK_SIZE) {
+				size_t n = std::min(BATCH_BLOCK_SIZE, output.size() - row);
+				size_t top = 0;
+				for (const auto& ins : expr.program()) {
+					double* block = scratch.data() + (top == 0 ? 0 : top - 1) * BATCH_BLOCK_SIZE;
+					switch (ins.op) {
+					case opcode::push_number:
+						block = scratch.data() + top * BATCH_BLOCK_SIZE;
+						std::fill(block, block + n, ins.value);
+						stack[top++] = block;
+						break;
+					case opcode::push_variable:
+						stack[top++] = columns[ins.slot].data() + row;
+						break;
+					case opcode::load_temp:
+						stack[top++] = temps.data() + ins.slot * BATCH_BLOCK_SIZE;
+						break;
+					case opcode::store_temp:
+						std::copy(stack[top - 1], stack[top - 1] + n, temps.data() + ins.slot * BATCH_BLOCK_SIZE);
+						break;
+					case opcode::posite:
+						break;
+					case opcode::add: case opcode::subtract: case opcode::multiply: case opcode::divide:
+					case opcode::modulo: case opcode::exponent:
+					case opcode::minimum: case opcode::maximum: case opcode::hypotenuse:
+						top--;
+						block = scratch.data() + (top - 1) * BATCH_BLOCK_SIZE;
+						binary_kernel(ins.op, stack[top - 1], stack[top], block, n, memo);
+						stack[top - 1] = block;
+						break;
+					default:
+						unary_kernel(ins.op, stack[top - 1], block, n, memo);
+						stack[top - 1] = block;
+						break;
+					}
+				}
+				std::copy(stack[0], stack[0] + n, output.data() + row);
+			}
+		}
+	}
+
+	void expression::evaluate_batch(std::span<const std::span<const double>> columns, std::span<double> output) const {
+		execute_batch(*this, columns, output, nullptr);
+	}
+
+	// 块内仍按指令逐条执行，只是代价高的纯函数逐元素经 memo 查表
+	void expression::evaluate_batch(std::span<const std::span<const double>> columns, std::span<double> output, call_memo& memo) const {
+		execute_batch(*this, columns, output, &memo);
+	}
+}
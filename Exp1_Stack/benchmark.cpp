@@ -0,0 +1,1036 @@
+#include "calculator.hpp"
+#include "jit.hpp"
+#include "expression_cache.hpp"
+#include "numeric.hpp"
+#include "tokenizer_session.hpp"
+#include "interval.hpp"
+#include "engine.hpp"
+#include "static_expression.hpp"
+#include "call_memo.hpp"
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <thread>
+
+// 统计全局堆分配次数，用于确认求值路径不分配内存
+std::atomic<size_t> allocation_count{ 0 };
+
+// 替换版本的 operator new 由 malloc 实现，delete 中的 free 与之配对；
+// GCC 把它们内联到调用处后仍按 new/free 不配对报 -Wmismatched-new-delete，这里局部关闭
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* address = std::malloc(size == 0 ? 1 : size)) {
+		return address;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* address) noexcept {
+	std::free(address);
+}
+
+void operator delete(void* address, size_t) noexcept {
+	std::free(address);
+}
+
+// std::pmr 的默认资源按对齐要求调用带 align_val_t 的版本，同样计入
+void* operator new(size_t size, std::align_val_t alignment) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	size_t align = static_cast<size_t>(alignment);
+#if defined(_MSC_VER)
+	// MSVC 不提供 std::aligned_alloc，对齐分配的内存须用 _aligned_free 释放
+	void* address = _aligned_malloc(std::max<size_t>(size, 1), align);
+#else
+	void* address = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+#endif
+	if (address != nullptr) {
+		return address;
+	}
+	throw std::bad_alloc();
+}
+
+#if defined(_MSC_VER)
+void operator delete(void* address, std::align_val_t) noexcept {
+	_aligned_free(address);
+}
+
+void operator delete(void* address, size_t, std::align_val_t) noexcept {
+	_aligned_free(address);
+}
+#else
+void operator delete(void* address, std::align_val_t) noexcept {
+	std::free(address);
+}
+
+void operator delete(void* address, size_t, std::align_val_t) noexcept {
+	std::free(address);
+}
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+	// 基准使用的表达式：覆盖帮助示例、多进制字面量、函数嵌套与一元符号
+	const std::vector<std::string> sample_expressions = {
+		"2 + 3 * 4",
+		"sin(PI/2)",
+		"0b1010 + 0x1F",
+		"2 * (3 + 4)",
+		"-(1.5e3 + .25) * 0o17 - 0x1A.F / 3!",
+		"sqrt(2) * cos(PI / 4) + ln(E) - lg(1000) ^ 2 % 7",
+		"arcsin(0.5) + arccos(0.5) + arctan(1) * deg(rad(45)) - cbrt(27)",
+		"((((1 + 2) * (3 + 4)) / ((5 - 6) * (7 - 8))) + PHI) * 0b11.01 - 0o7.4",
+	};
+
+	// main.cpp 帮助信息中的示例表达式
+	const std::vector<std::string> help_expressions = {
+		"2 + 3 * 4",
+		"sin(PI/2)",
+		"0b1010 + 0x1F",
+		"2 * (3 + 4)",
+	};
+
+	// 含变量的表达式：用于比较"每次重建"与"编译一次、多次求值"
+	const std::vector<std::string> variable_expressions = {
+		"rate * x ^ 2 + x",
+		"sqrt(x ^ 2 + y ^ 2) * cos(theta) - 0x1F % 7",
+		"(principal * (1 + rate / 12) ^ months - principal) / months",
+		"sqrt(x ^ 2 + y ^ 2) / (1 + sqrt(x ^ 2 + y ^ 2)) - cos(sqrt(x ^ 2 + y ^ 2))",
+	};
+
+	// 防止编译器优化掉被测代码的结果汇集点
+	volatile size_t sink = 0;
+	volatile double value_sink = 0;
+
+	// 执行 iterations 轮 func，返回耗时（秒）
+	template <typename Func>
+	double measure(size_t iterations, Func&& func) {
+		auto begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; i++) {
+			func();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(end - begin).count();
+	}
+
+	void print_result(const std::string& name, size_t iterations, size_t tokens_per_round, double seconds) {
+		double rounds = static_cast<double>(iterations);
+		std::cout << name << ": "
+			<< rounds * tokens_per_round / seconds << " tokens/s, "
+			<< seconds * 1e9 / (rounds * sample_expressions.size()) << " ns/expr\n";
+	}
+}
+
+// 分词与完整验证的吞吐量
+void bench_tokenizer(size_t iterations) {
+	chr::expression_tokenizer tokenizer;
+	size_t tokens_per_round = 0;
+	for (const auto& expr : sample_expressions) {
+		tokenizer.tokenize(expr);
+		tokens_per_round += tokenizer.tokens().size();
+	}
+	double tokenize_seconds = measure(iterations, [&]() {
+		for (const auto& expr : sample_expressions) {
+			tokenizer.tokenize(expr);
+			sink = sink + tokenizer.tokens().size();
+		}
+	});
+	print_result("tokenize", iterations, tokens_per_round, tokenize_seconds);
+	double validate_seconds = measure(iterations, [&]() {
+		for (const auto& expr : sample_expressions) {
+			tokenizer.validate(expr);
+			sink = sink + tokenizer.tokens().size();
+		}
+	});
+	print_result("validate", iterations, tokens_per_round, validate_seconds);
+}
+
+// 非法输入的拒绝代价：验证只记录错误种类与源文本范围，详细分析文字在需要时才生成
+void bench_rejection(size_t iterations) {
+	std::vector<std::string> invalid;
+	for (const auto& text : sample_expressions) {
+		invalid.push_back(text + " +");
+		invalid.push_back("(" + text);
+		invalid.push_back(text + " 2 x");
+		invalid.push_back("@" + text);
+	}
+	chr::expression_tokenizer tokenizer;
+	auto run = [&](bool render) {
+		size_t before = allocation_count.load();
+		double seconds = measure(iterations, [&]() {
+			for (const auto& text : invalid) {
+				sink = sink + tokenizer.validate(text) + tokenizer.errors().size();
+				if (render) {
+					sink = sink + tokenizer.detailed_analysis().size();
+				}
+			}
+		});
+		double rejections = static_cast<double>(iterations) * invalid.size();
+		return std::pair{ seconds * 1e9 / rejections, (allocation_count.load() - before) / rejections };
+	};
+	auto [validate_ns, validate_allocations] = run(false);
+	auto [render_ns, render_allocations] = run(true);
+	std::cout << "reject (validate only): " << validate_ns << " ns/expr, " << validate_allocations << " allocations/expr\n"
+		<< "reject + detailed_analysis: " << render_ns << " ns/expr, " << render_allocations << " allocations/expr\n";
+}
+
+// 数字字面量解析：进制字面量逐位移入整数尾数后按 2 的幂缩放，十进制用 from_chars；
+// 对照早期实现（按位累加 pow(radix, i) * digit、std::stod），并以编译期的精确解析为准检查边界值
+void bench_literals(size_t iterations) {
+	std::mt19937 random(20240917);
+	auto digits = [&](const char* alphabet, size_t radix, size_t length) {
+		std::string str;
+		for (size_t i = 0; i < length; i++) {
+			str += alphabet[random() % radix];
+		}
+		return str;
+	};
+	struct literal_set {
+		const char* name;
+		chr::token_t type;
+		size_t radix;
+		std::vector<std::string> texts;
+	};
+	std::vector<literal_set> sets = {
+		{ "binary", chr::token_t::binary_number, 2, {} },
+		{ "octal", chr::token_t::octal_number, 8, {} },
+		{ "hexadecimal", chr::token_t::hexadecimal_number, 16, {} },
+		{ "decimal", chr::token_t::decimal_number, 10, {} },
+	};
+	for (size_t i = 0; i < 256; i++) {
+		sets[0].texts.push_back("0b" + digits("01", 2, 8 + random() % 56) + "." + digits("01", 2, 1 + random() % 24));
+		sets[1].texts.push_back("0o" + digits("01234567", 8, 4 + random() % 20) + "." + digits("01234567", 8, 1 + random() % 8));
+		sets[2].texts.push_back("0x" + digits("0123456789ABCDEF", 16, 2 + random() % 16) + "." + digits("0123456789abcdef", 16, 1 + random() % 6));
+		sets[3].texts.push_back(digits("123456789", 9, 1) + digits("0123456789", 10, random() % 9) + "." + digits("0123456789", 10, 1 + random() % 8)
+			+ "e" + std::to_string(static_cast<int>(random() % 61) - 30));
+	}
+	// 早期实现：从低位起累加 pow(radix, i) * digit，每一步都有舍入
+	auto pow_sum = [](std::string_view str, double radix) {
+		size_t dot = str.find('.');
+		std::string_view integer = str.substr(2, dot == std::string_view::npos ? std::string_view::npos : dot - 2);
+		std::string_view fraction = dot == std::string_view::npos ? std::string_view() : str.substr(dot + 1);
+		auto digit = [](char t) { return t <= '9' ? t - '0' : t <= 'Z' ? t - 'A' + 10 : t - 'a' + 10; };
+		double value = 0;
+		for (size_t i = 0; i < integer.length(); i++) {
+			value += pow(radix, i) * digit(integer[integer.length() - i - 1]);
+		}
+		for (size_t i = 0; i < fraction.length(); i++) {
+			value += pow(radix, -(int(i) + 1)) * digit(fraction[i]);
+		}
+		return value;
+	};
+	for (const auto& set : sets) {
+		double exact_seconds = measure(iterations, [&]() {
+			for (const auto& text : set.texts) {
+				value_sink = value_sink + chr::token::from_lexeme(text, set.type).number_value();
+			}
+		});
+		double legacy_seconds = measure(iterations, [&]() {
+			for (const auto& text : set.texts) {
+				value_sink = value_sink + (set.radix == 10 ? std::stod(text) : pow_sum(text, static_cast<double>(set.radix)));
+			}
+		});
+		size_t inexact = 0;
+		for (const auto& text : set.texts) {
+			double legacy = set.radix == 10 ? std::stod(text) : pow_sum(text, static_cast<double>(set.radix));
+			inexact += legacy != chr::compile_time::literal_value(text, set.type);
+		}
+		double literals = static_cast<double>(iterations) * set.texts.size();
+		std::cout << set.name << " literals\n"
+			<< "  exact parser: " << exact_seconds * 1e9 / literals << " ns/literal\n"
+			<< "  " << (set.radix == 10 ? "std::stod" : "pow summation") << ": " << legacy_seconds * 1e9 / literals
+			<< " ns/literal（" << inexact << "/" << set.texts.size() << " 个结果不是最近舍入）\n";
+	}
+
+	// 边界值：尾数恰好 53 位、舍入进位/就近取偶、超过 64 位的长字面量、最大有限值与溢出、次正规数与下溢、十进制的极值
+	const std::pair<std::string, chr::token_t> boundaries[] = {
+		{ "0x1FFFFFFFFFFFFF", chr::token_t::hexadecimal_number },
+		{ "0x20000000000001", chr::token_t::hexadecimal_number },
+		{ "0x20000000000003", chr::token_t::hexadecimal_number },
+		{ "0x20000000000001.00000001", chr::token_t::hexadecimal_number },
+		{ "0xFFFFFFFFFFFFFFFFFFFFFFFF.FFFF", chr::token_t::hexadecimal_number },
+		{ "0x0.00000000000000000000000000000001", chr::token_t::hexadecimal_number },
+		{ "0xFFFFFFFFFFFFF8" + std::string(242, '0'), chr::token_t::hexadecimal_number },
+		{ "0xFFFFFFFFFFFFFBFF" + std::string(240, '0'), chr::token_t::hexadecimal_number },
+		{ "0xFFFFFFFFFFFFFC" + std::string(242, '0'), chr::token_t::hexadecimal_number },
+		{ "0b1" + std::string(52, '0') + "1", chr::token_t::binary_number },
+		{ "0b1" + std::string(52, '0') + "1.1", chr::token_t::binary_number },
+		{ "0b0." + std::string(1021, '0') + "1", chr::token_t::binary_number },
+		{ "0b0." + std::string(1073, '0') + "1", chr::token_t::binary_number },
+		{ "0b0." + std::string(1073, '0') + "11", chr::token_t::binary_number },
+		{ "0b0." + std::string(1074, '0') + "1", chr::token_t::binary_number },
+		{ "0o1777777777777777777777", chr::token_t::octal_number },
+		{ "0o7777777777777777777777.7777", chr::token_t::octal_number },
+		{ "9007199254740993", chr::token_t::decimal_number },
+		{ "1.7976931348623157e308", chr::token_t::decimal_number },
+		{ "2.2250738585072014e-308", chr::token_t::decimal_number },
+		{ "2.2250738585072011e-308", chr::token_t::decimal_number },
+		{ "4.9e-324", chr::token_t::decimal_number },
+		{ "2.5e-324", chr::token_t::decimal_number },
+		{ "0.1", chr::token_t::decimal_number },
+		{ "1e23", chr::token_t::decimal_number },
+	};
+	size_t mismatches = 0;
+	for (const auto& [text, type] : boundaries) {
+		double expected = chr::compile_time::literal_value(text, type);
+		double actual = chr::token::from_lexeme(text, type).number_value();
+		if (actual != expected) {
+			mismatches++;
+			std::cout << "  边界值解析错误: " << text.substr(0, 40) << (text.size() > 40 ? "..." : "") << "\n";
+		}
+	}
+	std::cout << "literal boundaries: " << std::size(boundaries) - mismatches << "/" << std::size(boundaries) << " exact\n";
+}
+
+// 同一公式换不同输入求值：每次重建表达式 vs 编译一次后按绑定求值
+void bench_evaluate(size_t iterations) {
+	for (const auto& text : variable_expressions) {
+		chr::expression compiled(text);
+		size_t count = compiled.variables().size();
+		chr::bindings values(count);
+		// 每次重建：按分词位置把变量代入为数值后重新构造
+		chr::expression_tokenizer tokenizer;
+		tokenizer.tokenize(text);
+		double rebuild_seconds = measure(iterations / 10, [&]() {
+			std::string substituted = text;
+			const auto& tokens = tokenizer.tokens();
+			for (auto it = tokens.rbegin(); it != tokens.rend(); ++it) {
+				if (it->type == chr::token_t::variable_token) {
+					substituted.replace(it->offset, it->text.length(), "1.5");
+				}
+			}
+			value_sink = value_sink + chr::expression(substituted).evaluate(chr::bindings());
+		});
+		double evaluate_seconds = measure(iterations, [&]() {
+			for (size_t slot = 0; slot < count; slot++) {
+				values[slot] = values[slot] + 1e-9;
+			}
+			value_sink = value_sink + compiled.evaluate(values);
+		});
+		const auto& report = compiled.optimization();
+		std::cout << text << "\n"
+			<< "  nodes: " << report.nodes_after << " -> " << report.dag_nodes << " after CSE\n"
+			<< "  rebuild + evaluate: " << rebuild_seconds * 1e9 / (iterations / 10) << " ns/eval\n"
+			<< "  evaluate(bindings): " << evaluate_seconds * 1e9 / iterations << " ns/eval\n";
+	}
+}
+
+// 同一表达式的两种求值方式：按语法树逐节点求值（long double）、字节码解释器
+void bench_backends(size_t iterations) {
+	const chr::bindings none;
+	for (const auto& text : help_expressions) {
+		chr::expression expr(text);
+		double tree_seconds = measure(iterations, [&]() {
+			value_sink = value_sink + static_cast<double>(chr::evaluate_as<long double>(expr, {}));
+		});
+		double bytecode_seconds = measure(iterations, [&]() {
+			value_sink = value_sink + expr.evaluate(none);
+		});
+		std::cout << text << "\n"
+			<< "  tree (long double): " << tree_seconds * 1e9 / iterations << " ns/eval\n"
+			<< "  bytecode: " << bytecode_seconds * 1e9 / iterations << " ns/eval\n";
+	}
+}
+
+// 本机代码 vs 字节码解释器
+void bench_jit(size_t iterations) {
+	std::vector<std::string> formulas = help_expressions;
+	formulas.insert(formulas.end(), variable_expressions.begin(), variable_expressions.end());
+	formulas.push_back("(x + 1) * (y - 2) / 3 - x * y + -(x / y)");
+	for (const auto& text : formulas) {
+		chr::expression expr(text);
+		chr::native_expression native(expr);
+		chr::bindings values(expr.variables().size(), 1.25);
+		double bytecode_seconds = measure(iterations, [&]() {
+			value_sink = value_sink + expr.evaluate(values);
+		});
+		double native_seconds = measure(iterations, [&]() {
+			value_sink = value_sink + native.evaluate(values);
+		});
+		std::cout << text << (native.is_native() ? "" : " (未生成本机代码)") << "\n"
+			<< "  bytecode: " << bytecode_seconds * 1e9 / iterations << " ns/eval\n"
+			<< "  native: " << native_seconds * 1e9 / iterations << " ns/eval\n";
+	}
+}
+
+// 编译期解析的表达式 vs 运行时解析后的字节码求值
+template <chr::fixed_string Source>
+void bench_static_formula(size_t iterations) {
+	using formula = chr::static_expression<Source>;
+	chr::expression expr{ std::string(formula::source()) };
+	chr::bindings values(formula::variable_count, 1.25);
+	double bytecode_seconds = measure(iterations, [&]() {
+		value_sink = value_sink + expr.evaluate(values);
+	});
+	double static_seconds = measure(iterations, [&]() {
+		value_sink = value_sink + formula::evaluate(std::span<const double>(values.data(), values.size()));
+	});
+	std::cout << formula::source() << "\n"
+		<< "  bytecode: " << bytecode_seconds * 1e9 / iterations << " ns/eval\n"
+		<< "  static_expression: " << static_seconds * 1e9 / iterations << " ns/eval\n";
+}
+
+void bench_static(size_t iterations) {
+	bench_static_formula<"rate * x ^ 2 + x">(iterations);
+	bench_static_formula<"sqrt(x ^ 2 + y ^ 2) * cos(theta) - 0x1F % 7">(iterations);
+	bench_static_formula<"(principal * (1 + rate / 12) ^ months - principal) / months">(iterations);
+	bench_static_formula<"max(x, y, 0) + hypot(x, y) - min(x, 1)">(iterations);
+}
+
+// 对一百万行输入逐行求值 vs 批量求值
+void bench_batch() {
+	const size_t rows = 1 << 20;
+	const std::vector<std::string> formulas = {
+		"sqrt(x * x + y * y) / (x - y)",
+		"(x + 1) * (y - 2) / 3 - x * y",
+		"sin(x) * cos(y) + sqrt(x * x + 1)",
+	};
+	std::vector<double> x(rows), y(rows), output(rows);
+	for (size_t i = 0; i < rows; i++) {
+		x[i] = 0.5 + i % 1000 * 0.001;
+		y[i] = 2.0 - i % 777 * 0.002;
+	}
+	for (const auto& text : formulas) {
+		chr::expression expr(text);
+		chr::bindings values(2);
+		size_t sx = expr.variable_slot("x"), sy = expr.variable_slot("y");
+		double row_seconds = measure(1, [&]() {
+			for (size_t i = 0; i < rows; i++) {
+				values[sx] = x[i];
+				values[sy] = y[i];
+				output[i] = expr.evaluate(values);
+			}
+		});
+		std::vector<std::span<const double>> columns(2);
+		columns[sx] = x;
+		columns[sy] = y;
+		double batch_seconds = measure(1, [&]() {
+			expr.evaluate_batch(columns, output);
+		});
+		value_sink = value_sink + output[rows / 2];
+		std::cout << text << "\n"
+			<< "  evaluate(bindings) per row: " << row_seconds * 1e9 / rows << " ns/row\n"
+			<< "  evaluate_batch: " << batch_seconds * 1e9 / rows << " ns/row\n";
+	}
+}
+
+// 批量求值时代价高的纯函数经记忆表查表：distinct 为每列不同取值的个数，取值越少命中率越高
+void bench_memo() {
+	const size_t rows = 1 << 20;
+	const std::vector<std::string> formulas = {
+		"n! / (k! * (n - k)!)",
+		"arcsin(x) + arccos(x) * x ^ 2.5",
+		"ln(x) + lg(k) + hypot(x, n)",
+	};
+	std::mt19937_64 random(7);
+	for (size_t distinct : { size_t(16), size_t(1024), size_t(1) << 20 }) {
+		std::vector<double> n(rows), k(rows), x(rows), output(rows), reference(rows);
+		for (size_t i = 0; i < rows; i++) {
+			n[i] = static_cast<double>(10 + random() % distinct % 50);
+			k[i] = static_cast<double>(random() % distinct % 10);
+			x[i] = static_cast<double>(random() % distinct + 1) / static_cast<double>(distinct + 1);
+		}
+		std::cout << "每列不同取值约 " << distinct << " 个\n";
+		for (const auto& text : formulas) {
+			chr::expression expr(text);
+			std::vector<std::span<const double>> columns(expr.variables().size());
+			for (size_t slot = 0; slot < columns.size(); slot++) {
+				const std::string_view name = expr.variables()[slot];
+				columns[slot] = name == "n" ? n : name == "k" ? k : x;
+			}
+			double plain_seconds = measure(1, [&]() {
+				expr.evaluate_batch(columns, reference);
+			});
+			chr::call_memo memo;
+			double memo_seconds = measure(1, [&]() {
+				expr.evaluate_batch(columns, output, memo);
+			});
+			if (std::memcmp(output.data(), reference.data(), rows * sizeof(double)) != 0) {
+				std::cout << "  记忆表结果与直接计算不一致\n";
+			}
+			value_sink = value_sink + output[rows / 2];
+			std::cout << text << "\n"
+				<< "  evaluate_batch: " << plain_seconds * 1e9 / rows << " ns/row\n"
+				<< "  evaluate_batch + call_memo: " << memo_seconds * 1e9 / rows << " ns/row"
+				<< "（命中率 " << memo.statistics().hit_rate() * 100 << "%）\n";
+		}
+	}
+}
+
+// 多线程重复请求同一批公式：每次重建 vs 经分片缓存取已编译结果
+void bench_cache(size_t iterations) {
+	std::vector<std::string> formulas = sample_expressions;
+	formulas.insert(formulas.end(), variable_expressions.begin(), variable_expressions.end());
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	auto run = [&](auto&& request) {
+		return measure(1, [&]() {
+			std::vector<std::thread> workers;
+			for (size_t t = 0; t < threads; t++) {
+				workers.emplace_back([&, t]() {
+					size_t local = 0;
+					for (size_t i = 0; i < iterations; i++) {
+						local += request(formulas[(i + t) % formulas.size()]);
+					}
+					sink = sink + local;
+				});
+			}
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		});
+	};
+	double requests = static_cast<double>(iterations) * threads;
+	double rebuild_seconds = run([](const std::string& text) {
+		return chr::expression(text).program().size();
+	});
+	chr::expression_cache cache;
+	double cached_seconds = run([&](const std::string& text) {
+		return cache.get(text)->program().size();
+	});
+	chr::cache_statistics stats = cache.statistics();
+	std::cout << "线程数: " << threads << "\n"
+		<< "  rebuild: " << requests / rebuild_seconds << " requests/s\n"
+		<< "  expression_cache: " << requests / cached_seconds << " requests/s"
+		<< "（命中 " << stats.hits << ", 未命中 " << stats.misses << ", 淘汰 " << stats.evictions << "）\n";
+}
+
+// 成批独立表达式：逐个构造并求值的顺序循环 vs 工作窃取并行引擎
+// 每隔一段插入一个很长的表达式，使各段成本不均，考察窃取的负载均衡效果
+void bench_engine(size_t iterations) {
+	std::string heavy = "0";
+	for (size_t i = 0; i < 200; i++) {
+		heavy += " + sin(" + std::to_string(i) + ") * 2";
+	}
+	std::vector<std::string> texts;
+	for (size_t i = 0; i < iterations; i++) {
+		texts.push_back(i % 997 < 50 ? heavy : sample_expressions[i % sample_expressions.size()]);
+	}
+	double sequential_seconds = measure(1, [&]() {
+		for (const auto& text : texts) {
+			value_sink = value_sink + chr::expression(text).evaluate(chr::bindings());
+		}
+	});
+	chr::evaluation_engine engine;
+	std::vector<chr::evaluation_result> results;
+	double engine_seconds = measure(1, [&]() {
+		results = engine.evaluate(texts);
+	});
+	double count = static_cast<double>(texts.size());
+	std::cout << texts.size() << " 个表达式\n"
+		<< "  sequential: " << count / sequential_seconds << " expr/s\n"
+		<< "  evaluation_engine (" << engine.threads() << " 线程): " << count / engine_seconds << " expr/s\n";
+	for (size_t w = 0; w < engine.statistics().size(); w++) {
+		const chr::worker_statistics& stats = engine.statistics()[w];
+		std::cout << "    线程 " << w << ": " << stats.expressions << " 个表达式, " << stats.tasks << " 个任务, 窃取 "
+			<< stats.steals << "/" << stats.steal_attempts << ", 忙碌 " << stats.busy_seconds * 1000 << " ms\n";
+	}
+}
+
+// 同一公式在各数值后端下的求值耗时与结果
+void bench_numeric(size_t iterations) {
+	const std::vector<std::string> formulas = {
+		"(principal * (1 + rate / 12) ^ months - principal) / months",
+		"0.1 + 0.2 - 0.3",
+	};
+	auto run = [&](const chr::expression& expr, auto tag) {
+		using number = decltype(tag);
+		std::vector<number> values;
+		for (const auto& name : expr.variables()) {
+			values.push_back(chr::number_traits<number>::literal(name == "principal" ? "1000" : name == "rate" ? "0.05" : "12"));
+		}
+		number result{};
+		double seconds = measure(iterations, [&]() {
+			result = chr::evaluate_as<number>(expr, std::span<const number>(values));
+		});
+		return std::make_pair(seconds * 1e9 / iterations, chr::number_traits<number>::to_string(result));
+	};
+	for (const auto& text : formulas) {
+		chr::expression expr(text);
+		std::cout << text << "\n";
+		auto print = [](const char* name, const std::pair<double, std::string>& row) {
+			std::cout << "  " << name << ": " << row.first << " ns/eval = " << row.second << "\n";
+		};
+		print("double", run(expr, double()));
+		print("long double", run(expr, (long double)0));
+		print("rational", run(expr, chr::rational()));
+		print("decimal", run(expr, chr::decimal()));
+	}
+
+	// 结果位数超出上限的精确乘幂应立即报错，而不是陷入大整数乘法
+	for (const char* text : { "(1000!)^4096", "(10^4096)^4096" }) {
+		chr::expression expr(text);
+		bool rejected = false;
+		double seconds = measure(1, [&]() {
+			try {
+				chr::evaluate_as<chr::rational>(expr, std::span<const chr::rational>());
+			}
+			catch (const std::runtime_error&) {
+				rejected = true;
+			}
+		});
+		std::cout << text << "\n  rational: " << (rejected ? "rejected" : "NOT rejected") << " in " << seconds * 1e3 << " ms\n";
+	}
+}
+
+// 模拟在长表达式中逐字符输入：每次按键后完整重新验证 vs 增量会话只重扫受影响的 token
+void bench_session(size_t iterations) {
+	std::string prefix;
+	for (const auto& text : sample_expressions) {
+		prefix += "(" + text + ") + ";
+	}
+	const std::string typed = "sqrt(x ^ 2 + y ^ 2) * 0x1F";
+	const size_t keystrokes = std::max<size_t>(1, iterations / 100);
+	chr::expression_tokenizer tokenizer;
+	double full_seconds = measure(keystrokes, [&]() {
+		std::string text = prefix;
+		for (size_t i = 0; i < typed.size(); i++) {
+			text.insert(prefix.size() / 2 + i, 1, typed[i]);
+			sink = sink + tokenizer.validate(text);
+		}
+	});
+	size_t relexed = 0;
+	double session_seconds = measure(keystrokes, [&]() {
+		chr::tokenizer_session session(prefix);
+		for (size_t i = 0; i < typed.size(); i++) {
+			session.insert(prefix.size() / 2 + i, std::string(1, typed[i]));
+			relexed += session.relexed_tokens();
+			sink = sink + session.valid();
+		}
+	});
+	double edits = static_cast<double>(keystrokes * typed.size());
+	std::cout << "逐键编辑（" << prefix.size() << " 字符）\n"
+		<< "  validate: " << full_seconds * 1e9 / edits << " ns/edit\n"
+		<< "  tokenizer_session: " << session_seconds * 1e9 / edits << " ns/edit, "
+		<< relexed / edits << " tokens/edit\n";
+}
+
+// 梯度：中心差分（每个变量 2 次求值）vs 前向模式 vs 反向模式
+void bench_gradient(size_t iterations) {
+	// 变量数从少到多：前向模式的代价随变量数增长，反向模式基本不变
+	const std::vector<std::string> formulas = {
+		"sqrt(x ^ 2 + y ^ 2) * cos(theta) - 0x1F % 7",
+		"(principal * (1 + rate / 12) ^ months - principal) / months + sin(a) * cos(b)",
+		"a*b + b*c + c*d + d*e + e*f + f*g + g*h + h*i + i*j + j*k + k*l + l*a + sqrt(a^2 + e^2 + i^2)",
+	};
+	for (const auto& text : formulas) {
+		chr::expression expr(text);
+		const size_t n = expr.variables().size();
+		std::vector<double> values(n, 1.5), gradient(n);
+		double fd_seconds = measure(iterations, [&]() {
+			std::vector<double> shifted = values;
+			for (size_t k = 0; k < n; k++) {
+				const double h = 1e-6;
+				shifted[k] = values[k] + h;
+				double up = expr.evaluate(std::span<const double>(shifted));
+				shifted[k] = values[k] - h;
+				double down = expr.evaluate(std::span<const double>(shifted));
+				shifted[k] = values[k];
+				gradient[k] = (up - down) / (2 * h);
+			}
+			value_sink = value_sink + gradient[0];
+		});
+		double forward_seconds = measure(iterations, [&]() {
+			value_sink = value_sink + expr.gradient_forward(values, gradient);
+		});
+		double reverse_seconds = measure(iterations, [&]() {
+			value_sink = value_sink + expr.gradient_reverse(values, gradient);
+		});
+		double rounds = static_cast<double>(iterations);
+		std::cout << text << "（" << n << " 个变量）\n"
+			<< "  finite difference: " << fd_seconds * 1e9 / rounds << " ns/gradient\n"
+			<< "  forward: " << forward_seconds * 1e9 / rounds << " ns/gradient\n"
+			<< "  reverse: " << reverse_seconds * 1e9 / rounds << " ns/gradient\n";
+	}
+}
+
+// 值域估计：一次区间求值 vs 网格采样（采样只能给出值域的内估计，区间给出保证的外包络）
+void bench_interval(size_t iterations) {
+	const std::vector<std::string> formulas = {
+		"sqrt(x ^ 2 + y ^ 2) * cos(theta) - 0x1F % 7",
+		"(principal * (1 + rate / 12) ^ months - principal) / months",
+	};
+	const size_t samples_per_variable = 10;
+	for (const auto& text : formulas) {
+		chr::expression expr(text);
+		const size_t n = expr.variables().size();
+		std::vector<chr::interval> boxes(n, chr::interval{ 1, 2 });
+		chr::interval bounds{};
+		double interval_seconds = measure(iterations, [&]() {
+			bounds = chr::evaluate_interval(expr, boxes);
+		});
+		// 每个变量取 samples_per_variable 个等距点，遍历整个网格
+		size_t grid = 1;
+		for (size_t i = 0; i < n; i++) {
+			grid *= samples_per_variable;
+		}
+		double sampled_lower = INFINITY, sampled_upper = -INFINITY;
+		std::vector<double> values(n);
+		double sample_seconds = measure(1, [&]() {
+			for (size_t index = 0; index < grid; index++) {
+				size_t rest = index;
+				for (size_t k = 0; k < n; k++) {
+					values[k] = 1 + static_cast<double>(rest % samples_per_variable) / (samples_per_variable - 1);
+					rest /= samples_per_variable;
+				}
+				double y = expr.evaluate(std::span<const double>(values));
+				sampled_lower = std::min(sampled_lower, y);
+				sampled_upper = std::max(sampled_upper, y);
+			}
+		});
+		std::cout << text << "（变量均取 [1, 2]）\n"
+			<< "  interval: " << interval_seconds * 1e9 / iterations << " ns, ["
+			<< bounds.lower << ", " << bounds.upper << "]\n"
+			<< "  grid " << grid << " points: " << sample_seconds * 1e9 << " ns, ["
+			<< sampled_lower << ", " << sampled_upper << "]\n";
+	}
+}
+
+// 构造表达式的耗时：默认内存资源 vs 栈上缓冲区的单调 arena（每轮结束整体释放）
+void bench_construction(size_t iterations) {
+	std::byte buffer[16384];
+	double default_seconds = measure(iterations, [&]() {
+		for (const auto& text : sample_expressions) {
+			chr::expression expr(text);
+			sink = sink + expr.program().size();
+		}
+	});
+	double arena_seconds = measure(iterations, [&]() {
+		for (const auto& text : sample_expressions) {
+			std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+			chr::expression expr(text, &arena);
+			sink = sink + expr.program().size();
+		}
+	});
+	double constructions = static_cast<double>(iterations) * sample_expressions.size();
+	std::cout << "construct (default resource): " << default_seconds * 1e9 / constructions << " ns/expr\n"
+		<< "construct (monotonic arena): " << arena_seconds * 1e9 / constructions << " ns/expr\n";
+}
+
+// 各求值路径每次求值的堆分配次数，以及构造表达式本身的堆分配次数
+void bench_allocations() {
+	const size_t rounds = 1000;
+	auto allocations_per_eval = [&](auto&& func) {
+		size_t before = allocation_count.load();
+		for (size_t i = 0; i < rounds; i++) {
+			func();
+		}
+		return static_cast<double>(allocation_count.load() - before) / rounds;
+	};
+	for (const auto& text : sample_expressions) {
+		chr::expression expr(text);
+		chr::bindings values;
+		std::byte buffer[16384];
+		std::cout << text << "\n"
+			<< "  construct (default resource): " << allocations_per_eval([&]() {
+				chr::expression constructed(text);
+				sink = sink + constructed.program().size();
+			}) << " allocs/expr\n"
+			<< "  construct (monotonic arena): " << allocations_per_eval([&]() {
+				std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+				chr::expression constructed(text, &arena);
+				sink = sink + constructed.program().size();
+			}) << " allocs/expr\n"
+			<< "  evaluate(bindings): " << allocations_per_eval([&]() {
+				value_sink = value_sink + expr.evaluate(values);
+			}) << " allocs/eval\n";
+	}
+}
+
+namespace {
+	// 回归基准的一类语料
+	struct corpus {
+		std::string name;
+		std::vector<std::string> expressions;
+	};
+
+	// 回归基准的一项结果：某类语料上某个阶段的单次耗时与堆分配次数
+	struct stage_result {
+		std::string corpus;
+		std::string stage;
+		double ns_per_op;
+		double allocs_per_op;
+	};
+
+	// 生成回归基准的语料，每类 count 个表达式；固定种子，保证每次运行（以及基线）的输入完全相同
+	std::vector<corpus> generate_corpora(size_t count) {
+		std::mt19937 random(20240601);
+		auto pick = [&](size_t n) { return static_cast<size_t>(random() % n); };
+		auto number = [&]() { return std::to_string(1 + pick(999)) + "." + std::to_string(pick(100)); };
+		auto binary_operator = [&]() {
+			const char* symbols[] = { " + ", " - ", " * ", " / " };
+			return std::string(symbols[pick(4)]);
+		};
+		auto digits = [&](const char* alphabet, size_t radix, size_t length) {
+			std::string str;
+			for (size_t i = 0; i < length; i++) {
+				str += alphabet[pick(radix)];
+			}
+			return str;
+		};
+		auto radix_literal = [&]() {
+			const char* prefixes[] = { "0b", "0o", "0x" };
+			const size_t radixes[] = { 2, 8, 16 };
+			size_t kind = pick(3);
+			std::string str = prefixes[kind] + digits("0123456789ABCDEF", radixes[kind], 1 + pick(10));
+			if (pick(2) == 0) {
+				str += "." + digits("0123456789abcdef", radixes[kind], 1 + pick(4));
+			}
+			return str;
+		};
+		const char* functions[] = { "sin", "cos", "tan", "arctan", "sqrt", "cbrt", "ln", "lg", "deg", "rad" };
+
+		std::vector<corpus> corpora = { { "short", {} }, { "deep_nested", {} }, { "long_flat", {} }, { "function_heavy", {} }, { "radix_heavy", {} } };
+		for (size_t i = 0; i < count; i++) {
+			// 短表达式：2 到 4 个操作数
+			std::string str = number();
+			for (size_t k = 1 + pick(3); k > 0; k--) {
+				str += binary_operator() + number();
+			}
+			corpora[0].expressions.push_back(str);
+			// 深度嵌套：24 到 39 层括弧，随机向左或向右嵌套（向右嵌套时后缀求值栈同样变深）
+			str = number();
+			for (size_t depth = 24 + pick(16); depth > 0; depth--) {
+				str = pick(2) == 0 ? "(" + str + ")" + binary_operator() + number() : number() + binary_operator() + "(" + str + ")";
+			}
+			corpora[1].expressions.push_back(str);
+			// 长而平坦：100 到 199 个操作数，不含括弧
+			str = number();
+			for (size_t k = 99 + pick(100); k > 0; k--) {
+				str += binary_operator() + number();
+			}
+			corpora[2].expressions.push_back(str);
+			// 函数密集：8 到 15 层函数调用，部分层再接一个二元运算
+			str = number();
+			for (size_t k = 8 + pick(8); k > 0; k--) {
+				str = std::string(functions[pick(std::size(functions))]) + "(" + str + ")";
+				if (pick(3) == 0) {
+					str += binary_operator() + number();
+				}
+			}
+			corpora[3].expressions.push_back(str);
+			// 进制字面量密集：6 到 11 个二/八/十六进制操作数
+			str = radix_literal();
+			for (size_t k = 5 + pick(6); k > 0; k--) {
+				str += binary_operator() + radix_literal();
+			}
+			corpora[4].expressions.push_back(str);
+		}
+		return corpora;
+	}
+
+	// 对语料中每个表达式执行至少 iterations 轮 func(index)：轮数倍增直到一次测量不短于 SUITE_MIN_SECONDS，
+	// 避免廉价阶段的计时被噪声淹没；再重复 SUITE_REPEATS 次取最短耗时，分配次数取第一次重复的统计
+	constexpr double SUITE_MIN_SECONDS = 0.01;
+	constexpr size_t SUITE_REPEATS = 3;
+
+	template <typename Func>
+	stage_result measure_stage(const corpus& input, const std::string& stage, size_t iterations, Func&& func) {
+		auto round = [&]() {
+			for (size_t index = 0; index < input.expressions.size(); index++) {
+				func(index);
+			}
+		};
+		size_t before = allocation_count.load();
+		double seconds = measure(iterations, round);
+		double allocations = (allocation_count.load() - before) / (static_cast<double>(iterations) * input.expressions.size());
+		while (seconds < SUITE_MIN_SECONDS) {
+			iterations *= 2;
+			seconds = measure(iterations, round);
+		}
+		for (size_t repeat = 1; repeat < SUITE_REPEATS; repeat++) {
+			seconds = std::min(seconds, measure(iterations, round));
+		}
+		return { input.name, stage, seconds * 1e9 / (static_cast<double>(iterations) * input.expressions.size()), allocations };
+	}
+
+	// 各类语料上分四个阶段测量：tokenize（分词）、validate（完整验证）、
+	// parse（构造表达式：验证 + 优先级爬升建立语法树 + 优化 + 编译为字节码）、evaluate（执行字节码）
+	std::vector<stage_result> run_suite(size_t iterations) {
+		std::vector<stage_result> results;
+		for (const corpus& input : generate_corpora(32)) {
+			std::vector<chr::expression> compiled;
+			const chr::bindings none;
+			for (const auto& text : input.expressions) {
+				compiled.emplace_back(text);
+			}
+			chr::expression_tokenizer tokenizer;
+			results.push_back(measure_stage(input, "tokenize", iterations, [&](size_t index) {
+				tokenizer.tokenize(input.expressions[index]);
+				sink = sink + tokenizer.tokens().size();
+			}));
+			results.push_back(measure_stage(input, "validate", iterations, [&](size_t index) {
+				tokenizer.validate(input.expressions[index]);
+				sink = sink + tokenizer.tokens().size();
+			}));
+			results.push_back(measure_stage(input, "parse", iterations, [&](size_t index) {
+				chr::expression expr(input.expressions[index]);
+				sink = sink + expr.program().size();
+			}));
+			results.push_back(measure_stage(input, "evaluate", iterations, [&](size_t index) {
+				value_sink = value_sink + compiled[index].evaluate(none);
+			}));
+		}
+		return results;
+	}
+
+	// 每项结果单独占一行，read_baseline 按行读取
+	void write_json(std::ostream& out, size_t iterations, const std::vector<stage_result>& results) {
+		out << "{\n  \"iterations\": " << iterations << ",\n  \"results\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const stage_result& result = results[i];
+			out << "    {\"corpus\": \"" << result.corpus << "\", \"stage\": \"" << result.stage
+				<< "\", \"ns_per_op\": " << result.ns_per_op << ", \"allocs_per_op\": " << result.allocs_per_op << "}"
+				<< (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+	}
+
+	// 取出一行中 "key": 之后的值（字符串去掉引号），没有该键时返回空串
+	std::string json_field(const std::string& line, const std::string& key) {
+		size_t pos = line.find("\"" + key + "\": ");
+		if (pos == std::string::npos) {
+			return "";
+		}
+		pos += key.size() + 4;
+		if (line[pos] == '"') {
+			return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+		}
+		return line.substr(pos, line.find_first_of(",}", pos) - pos);
+	}
+
+	// 读取 write_json 写出的基线文件（只识别该格式：每项结果一行）
+	std::vector<stage_result> read_baseline(const std::string& path) {
+		std::ifstream in(path);
+		if (!in) {
+			throw std::runtime_error("无法读取基线文件：" + path);
+		}
+		std::vector<stage_result> results;
+		std::string line;
+		while (std::getline(in, line)) {
+			if (line.find("\"corpus\"") == std::string::npos) {
+				continue;
+			}
+			results.push_back({ json_field(line, "corpus"), json_field(line, "stage"),
+				std::stod(json_field(line, "ns_per_op")), std::stod(json_field(line, "allocs_per_op")) });
+		}
+		return results;
+	}
+
+	// 与基线逐项比较：耗时增加超过 threshold 百分比或分配次数增加即视为回归，返回是否没有回归
+	bool compare_baseline(const std::vector<stage_result>& current, const std::vector<stage_result>& baseline, double threshold) {
+		size_t regressions = 0;
+		for (const stage_result& result : current) {
+			auto it = std::find_if(baseline.begin(), baseline.end(), [&](const stage_result& base) {
+				return base.corpus == result.corpus && base.stage == result.stage;
+			});
+			std::cout << result.corpus << "/" << result.stage << ": ";
+			if (it == baseline.end()) {
+				std::cout << "基线中没有此项\n";
+				continue;
+			}
+			double change = (result.ns_per_op / it->ns_per_op - 1) * 100;
+			bool regressed = change > threshold || result.allocs_per_op > it->allocs_per_op + 0.01;
+			regressions += regressed;
+			std::cout << it->ns_per_op << " -> " << result.ns_per_op << " ns/op (" << (change >= 0 ? "+" : "") << change << "%), "
+				<< it->allocs_per_op << " -> " << result.allocs_per_op << " allocs/op" << (regressed ? "  [回归]" : "") << "\n";
+		}
+		std::cout << "回归项数: " << regressions << "（阈值 " << threshold << "%）\n";
+		return regressions == 0;
+	}
+
+	// 整个参数都是数字时才接受，避免 std::stoul 对 --help 之类的参数抛出异常
+	template <typename Number>
+	bool parse_argument(std::string_view text, Number& value) {
+		auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+		return ec == std::errc() && end == text.data() + text.size();
+	}
+
+	int print_usage() {
+		std::cout << "用法:\n"
+			<< "  Benchmark [iterations]\n"
+			<< "  Benchmark --json [path] [iterations]\n"
+			<< "  Benchmark --baseline path [--threshold pct] [iterations]\n";
+		return 2;
+	}
+}
+
+// 用法：
+//   Benchmark [iterations]                        各项基准的可读报告
+//   Benchmark --json [path] [iterations]          回归基准，结果以 JSON 写入 path（省略时写到标准输出）
+//   Benchmark --baseline path [--threshold pct]   回归基准并与保存的 JSON 基线比较，有回归时返回 1
+// 两个回归选项可同时使用：先保存本次结果，再与基线比较
+int main(int argc, char* argv[]) {
+	std::optional<size_t> requested;
+	std::optional<std::string> json_path, baseline_path;
+	double threshold = 10;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--json") {
+			json_path = i + 1 < argc && argv[i + 1][0] != '-' && !std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))
+				? argv[++i] : "";
+		}
+		else if (arg == "--baseline" && i + 1 < argc) {
+			baseline_path = argv[++i];
+		}
+		else if (arg == "--threshold" && i + 1 < argc) {
+			if (!parse_argument(argv[++i], threshold)) {
+				return print_usage();
+			}
+		}
+		else {
+			size_t count = 0;
+			if (!parse_argument(arg, count)) {
+				return print_usage();
+			}
+			requested = count;
+		}
+	}
+	if (json_path || baseline_path) {
+		size_t iterations = requested.value_or(200);
+		std::vector<stage_result> results = run_suite(iterations);
+		if (json_path && json_path->empty()) {
+			write_json(std::cout, iterations, results);
+		}
+		else if (json_path) {
+			std::ofstream out(*json_path);
+			write_json(out, iterations, results);
+		}
+		if (baseline_path) {
+			return compare_baseline(results, read_baseline(*baseline_path), threshold) ? 0 : 1;
+		}
+		return 0;
+	}
+
+	size_t iterations = requested.value_or(20000);
+	std::cout << "迭代轮数: " << iterations << "\n";
+	bench_tokenizer(iterations);
+	bench_rejection(iterations);
+	bench_literals(iterations);
+	bench_session(iterations);
+	bench_allocations();
+	bench_construction(iterations);
+	bench_evaluate(iterations);
+	bench_backends(iterations);
+	bench_batch();
+	bench_memo();
+	bench_jit(iterations);
+	bench_static(iterations);
+	bench_cache(iterations);
+	bench_engine(iterations);
+	bench_numeric(iterations);
+	bench_gradient(iterations);
+	bench_interval(iterations);
+	return 0;
+}
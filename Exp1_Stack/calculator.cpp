@@ -1,558 +1,1085 @@
-#include "calculator.hpp"
-
-namespace chr {
-	namespace {
-		// ʽģʽ
-		// ƣ0b1010  0b11.01С㣩
-		const std::string binary_pattern = R"((0b[01]+(\.[01]*)?))";
-		// ˽ƣ0o755  0o7.3
-		const std::string octal_pattern = R"((0o[0-7]+(\.[0-7]*)?))";
-		// ʮƣ0x1A3F  0x1A.F
-		const std::string hexadecimal_pattern = R"((0x[0-9A-Fa-f]+(\.[0-9A-Fa-f]*)?))";
-		// ʮƣСѧ
-		const std::string decimal_pattern = R"(((\d+\.?\d*|\.\d+)([eE][-+]?\d+)?))";
-		// ֵ֧ĳ
-		const std::string constant_pattern = R"(PI|E|PHI)";
-		// ͨ׳ˡȡȵַ
-		const std::string normal_pattern = R"([+\-*/^()!%])";
-		// ڲʹõһԪpos/neg
-		const std::string signal_pattern = R"(pos|neg)";
-		// ֵ֧ĺбƥ䵥ʣ
-		const std::string function_pattern =
-			R"(sin|cos|tan|cot|sec|csc|)"
-			R"(arcsin|arccos|arctan|arccot|arcsec|arccsc|)"
-			R"(ln|lg|deg|rad|sqrt|cbrt)";
-	}
-
-	// λж token_t İλʵ֣ is_number / is_operator ȣ
-	byte operator&(token_t a, token_t b) noexcept
-	{
-		return static_cast<byte>(a) & static_cast<byte>(b);
-	}
-
-	// ַж token ͣʹȼƥ䣩
-	token_t token_type(const std::string& str) noexcept {
-		if (std::regex_match(str, std::regex(binary_pattern))) {
-			return token_t::binary_number;
-		}
-		else if (std::regex_match(str, std::regex(octal_pattern))) {
-			return token_t::octal_number;
-		}
-		else if (std::regex_match(str, std::regex(hexadecimal_pattern))) {
-			return token_t::hexadecimal_number;
-		}
-		else if (std::regex_match(str, std::regex(decimal_pattern))) {
-			return token_t::decimal_number;
-		}
-		else if (std::regex_match(str, std::regex(normal_pattern))) {
-			return token_t::normal_operator;
-		}
-		else if (std::regex_match(str, std::regex(constant_pattern))) {
-			return token_t::constant_number;
-		}
-		else if (std::regex_match(str, std::regex(function_pattern))) {
-			return token_t::function_operator;
-		}
-		else if (std::regex_match(str, std::regex(signal_pattern))) {
-			return token_t::signal_operator;
-		}
-		return token_t::invalid_token;
-	}
-
-	// ִʣʹƥ֪ token ģʽͬʱδַ֪Ϊ
-	bool expression_tokenizer::tokenize(const std::string& expression) {
-		m_tokens.clear();
-		m_errors.clear();
-		std::regex pattern(binary_pattern + "|" + octal_pattern + "|" + hexadecimal_pattern + "|" +
-			decimal_pattern + "|" + constant_pattern + "|" + normal_pattern + "|" + function_pattern);
-		size_t pos = 0;
-		auto words_begin = std::sregex_iterator(expression.begin(), expression.end(), pattern);
-		auto words_end = std::sregex_iterator();
-		for (auto& it = words_begin; it != words_end; it++) {
-			std::smatch match = *it;
-			std::string token = match.str();
-			size_t token_pos = match.position();
-			// ȫǿհ׵ƥ䣨Ȼͨƥհף
-			if (std::all_of(token.begin(), token.end(), isspace)) {
-				continue;
-			}
-			// ǰƥ֮ǰδƥݣΪδַ֪
-			if (token_pos > pos) {
-				std::string unknown = expression.substr(pos, token_pos - pos);
-				if (!std::all_of(unknown.begin(), unknown.end(), isspace)) {
-					m_errors.push_back({ unknown,"޷ʶַ" });
-				}
-			}
-			m_tokens.push_back(token);
-			pos = token_pos + token.length();
-		}
-		// ĩβǷʣ޷ʶ
-		if (pos < expression.length()) {
-			std::string remaining = expression.substr(pos);
-			if (!std::all_of(remaining.begin(), remaining.end(), isspace)) {
-				m_errors.push_back({ remaining, "ʽĩβ޷ʶַ" });
-			}
-		}
-		// һԪ + / - Ϊڲ pos/neg֤
-		parse_signal_operators();
-		return m_errors.empty();
-	}
-
-	// ֤ȷִʣ﷨
-	bool expression_tokenizer::validate(const std::string& expression) {
-		if (!tokenize(expression)) {
-			return 0;
-		}
-		parse_parenthese();         // Լ
-		parse_operator_sequence();  // ˳ϷԼ
-		parse_number_format();      // ʽ
-		parse_function_usage();     // ʽ飨 '('
-		return m_errors.empty();
-	}
-
-	// ΪԪ + - ںλʶΪһԪ pos/neg
-	void expression_tokenizer::parse_signal_operators() {
-		std::vector<std::string> processed_tokens;
-		for (size_t i = 0; i < m_tokens.size(); ++i) {
-			const std::string& token = m_tokens[i];
-			if (token == "+" || token == "-") {
-				// Ǳʽͷǰһ(Ҳ׳)ΪһԪ
-				if (i == 0 || (i > 0 && (is_operator(m_tokens[i - 1]) && m_tokens[i - 1] != ")"
-					&& m_tokens[i - 1] != "!") || is_function(m_tokens[i - 1]))) {
-					processed_tokens.push_back(token == "+" ? "pos" : "neg");
-				}
-				else {
-					processed_tokens.push_back(token);
-				}
-			}
-			else {
-				processed_tokens.push_back(token);
-			}
-		}
-		m_tokens = processed_tokens;
-	}
-
-	// ƥ䣬¼Ĵλ
-	void expression_tokenizer::parse_parenthese() {
-		std::stack<std::pair<std::string, size_t>>paren_stack;
-		for (size_t i = 0; i < m_tokens.size(); i++) {
-			const auto& token = m_tokens[i];
-			if (token == "(") {
-				paren_stack.push({ token,i });
-			}
-			else if (token == ")") {
-				if (paren_stack.empty()) {
-					add_error(std::to_string(i), "ڶ");
-				}
-				else {
-					paren_stack.pop();
-				}
-			}
-		}
-		// ʣΪ
-		while (!paren_stack.empty()) {
-			add_error(std::to_string(paren_stack.top().second), "ڶ");
-			paren_stack.pop();
-		}
-	}
-
-	// еĺϷԣ / ʼβȣ
-	void expression_tokenizer::parse_operator_sequence() {
-		for (size_t i = 0; i < m_tokens.size(); ++i) {
-			const std::string& token = m_tokens[i];
-			// һԪţpos/negܳڱʽĩβҲ
-			if (token_type(token) == token_t::signal_operator) {
-				if (i == m_tokens.size() - 1) {
-					add_error(std::to_string(i), "ʽβ");
-				}
-				else {
-					if (i != 0 && token_type(m_tokens[i - 1]) == token_t::signal_operator) {
-						add_error(std::to_string(i), "ʽ");
-					}
-				}
-			}
-			// ׳˱/
-			else if (token == "!") {
-				if (i == 0) {
-					add_error(std::to_string(i), "ʽԽ׳ͷ");
-				}
-				else {
-					const std::string& prev = m_tokens[i - 1];
-					if (!(is_number(prev) || prev == ")")) {
-						add_error(std::to_string(i), "׳ǰ֡ʽ");
-					}
-				}
-			}
-			// ͨԪʼ/βԪ
-			else if (token != "(" && token != ")" && token_type(token) == token_t::normal_operator) {
-				if (i == 0) {
-					add_error(std::to_string(i), "ʽԶԪͷ");
-				}
-				else if (i == m_tokens.size() - 1) {
-					add_error(std::to_string(i), "ʽβ");
-				}
-				else if (token_type(m_tokens[i - 1]) == token_t::signal_operator) {
-					add_error(std::to_string(i), "ʽԪ");
-				}
-			}
-		}
-	}
-
-	// ʽ飺ơѧֵ
-	void expression_tokenizer::parse_number_format() {
-		for (size_t i = 0; i < m_tokens.size(); i++) {
-			const auto& token = m_tokens[i];
-			// ԱʶΪҲǳ token иʽ
-			if (is_number(token) && !is_constant(token)) {
-				// һҲ -> ִ
-				if (i > 0 && is_number(m_tokens[i - 1])) {
-					add_error(m_tokens[i - 1] + token, "ʽ");
-				}
-				else {
-					// ѧУ飺ȷ decimal_patternҲ 0x/0o/0b ǰ׺
-					if ((token.find('e') != std::string::npos || token.find('E') != std::string::npos) &&
-						!token.starts_with("0x") && !token.starts_with("0o") && !token.starts_with("0b")) {
-						if (!std::regex_match(token, std::regex(decimal_pattern))) {
-							add_error(token, "ѧʽ");
-						}
-					}
-					// ʽУ
-					if (token.starts_with("0b") &&
-						!std::regex_match(token, std::regex(binary_pattern))) {
-						add_error(token, "Ƹʽ");
-					}
-					else if (token.starts_with("0o") &&
-						!std::regex_match(token, std::regex(octal_pattern))) {
-						add_error(token, "˽Ƹʽ");
-					}
-					else if (token.starts_with("0x") &&
-						!std::regex_match(token, std::regex(hexadecimal_pattern))) {
-						add_error(token, "ʮƸʽ");
-					}
-				}
-			}
-		}
-	}
-
-	// ʹü飺 '('򱨴
-	void expression_tokenizer::parse_function_usage() {
-		for (size_t i = 0; i < m_tokens.size(); ++i) {
-			if (is_function(m_tokens[i]) && (i + 1 >= m_tokens.size() || m_tokens[i + 1] != "(")) {
-				add_error(m_tokens[i], "δ");
-			}
-		}
-	}
-
-	// Ӵ¼λ
-	void expression_tokenizer::add_error(const std::string& position, const std::string& description) {
-		m_errors.push_back({ position,description });
-	}
-
-	// ϸַгÿ token ֵ token ַг
-	std::string expression_tokenizer::detailed_analysis() const {
-		std::string str;
-		for (const auto& token : m_tokens) {
-			str += "" + std::to_string(static_cast<byte>(token_type(token))) + "" + token + "\n";
-		}
-		for (const auto& error : m_errors) {
-			str += "" + error.first + "" + error.second + "\n";
-		}
-		// ûκ pop_back  UBڴͨݣԭʵһ
-		str.pop_back();
-		return str;
-	}
-
-	// ַΪ tokenֻհ
-	token token::from_string(const std::string& str) {
-		std::string cpstr = str;
-		// ȥǰհ
-		while (!cpstr.empty() && std::isspace(cpstr.front())) {
-			cpstr.erase(0, 1);
-		}
-		while (!cpstr.empty() && std::isspace(cpstr.back())) {
-			cpstr.pop_back();
-		}
-		if (cpstr.empty()) {
-			throw std::runtime_error("ֿհ");
-		}
-		// ԽΪ
-		if (auto number = try_parse_number(cpstr)) {
-			return token::from_number(*number);
-		}
-		// ԽΪ/
-		if (auto op_token = try_parse_operator(cpstr)) {
-			return *op_token;
-		}
-		throw std::runtime_error("Ƴ");
-	}
-
-	// ԽַתΪֳֵ֧
-	inline std::optional<double> token::try_parse_number(const std::string& str) {
-		if (!chr::is_number(str)) {
-			return std::nullopt;
-		}
-		token_t type = token_type(str);
-		// ʮֱ stodֿ֧ѧ
-		if (type == token_t::decimal_number) {
-			return std::stod(str);
-		}
-		// 滻Ϊֵ
-		else if (type == token_t::constant_number) {
-			if (str == "E") {
-				return CONSTANT_E;
-			}
-			else if (str == "PI") {
-				return CONSTANT_PI;
-			}
-			else if (str == "PHI") {
-				return CONSTANT_PHI;
-			}
-			else {
-				throw std::runtime_error("Ч");
-			}
-		}
-		// //ʮС֣
-		else {
-			double value = 0;
-			int radix = 10;
-			std::string integer;
-			std::string fraction;
-			if (type == token_t::binary_number) {
-				radix = 2;
-			}
-			else if (type == token_t::octal_number) {
-				radix = 8;
-			}
-			else if (type == token_t::hexadecimal_number) {
-				radix = 16;
-			}
-			else {
-				throw std::runtime_error("Ч");
-			}
-			size_t dot_pos = str.find('.');
-			if (dot_pos == std::string::npos) {
-				// ȥǰ׺0b/0o/0x
-				integer = str.substr(2);
-			}
-			else {
-				integer = str.substr(2, dot_pos - 2);
-				fraction = str.substr(dot_pos + 1);
-			}
-			// ֣ӵλλ
-			for (size_t i = 0; i < integer.length(); i++) {
-				char t = integer[integer.length() - i - 1];
-				value += pow(radix, i) * (t <= '9' ? t - '0' : t <= 'Z' ? t - 'A' + 10 : t - 'a' + 10);
-			}
-			// С
-			for (size_t i = 0; i < fraction.length(); i++) {
-				char t = fraction[i];
-				value += pow(radix, -(int(i) + 1)) * (t <= '9' ? t - '0' : t <= 'Z' ? t - 'A' + 10 : t - 'a' + 10);
-			}
-			return value;
-		}
-	}
-
-	// ַӳΪ tokenͨ
-	std::optional<token> token::try_parse_operator(const std::string& str) {
-		static const std::unordered_map<std::string, token(*)(void)> operator_map = {
-			{"+", []() { return token::add(); }},
-			{"-", []() { return token::minus(); }},
-			{"*", []() { return token::multiply(); }},
-			{"/", []() { return token::divide(); }},
-			{"%", []() { return token::modulo(); }},
-			{"^", []() { return token::exponent(); }},
-			{"!", []() { return token::factorial(); }},
-			{"(", []() { return token::left_parentheses(); }},
-			{")", []() { return token::right_parentheses(); }},
-			{"sin", []() { return token::sine(); }},
-			{"cos", []() { return token::cosine(); }},
-			{"tan", []() { return token::tangent(); }},
-			{"cot", []() { return token::cotangent(); }},
-			{"sec", []() { return token::secant(); }},
-			{"csc", []() { return token::cosecant(); }},
-			{"arcsin", []() { return token::arcsine(); }},
-			{"arccos", []() { return token::arccosine(); }},
-			{"arctan", []() { return token::arctangent(); }},
-			{"arccot", []() { return token::arccotangent(); }},
-			{"arcsec", []() { return token::arcsecant(); }},
-			{"arccsc", []() { return token::arccosecant(); }},
-			{"lg", []() { return token::common_logarithm(); }},
-			{"ln", []() { return token::natural_logarithm(); }},
-			{"sqrt", []() { return token::square_root(); }},
-			{"cbrt", []() { return token::cubic_root(); }},
-			{"deg", []() { return token::degree(); }},
-			{"rad", []() { return token::radian(); }},
-		};
-		auto it = operator_map.find(str);
-		if (it != operator_map.end()) {
-			return it->second();
-		}
-		return std::nullopt;
-	}
-
-	// ݲ operand_num ִӦĳջ㲢ѹ
-	void expression::calculate(std::stack<token>& operands, const token& op) const {
-		byte operand_num = op.operator_operand_num();
-		if (operand_num == 0) {
-			throw std::runtime_error("ʱ");
-		}
-		else if (operand_num == 1) {
-			// һԪ㣬ջȡһ
-			double a = operands.top().number_value();
-			operands.pop();
-			operands.push(token::from_number(op.apply_operator(a, 0)));
-		}
-		else if (operand_num == 2) {
-			// Ԫ㣬עջ˳ȵ bٵ a
-			double b = operands.top().number_value();
-			operands.pop();
-			double a = operands.top().number_value();
-			operands.pop();
-			operands.push(token::from_number(op.apply_operator(a, b)));
-		}
-		else {
-			throw std::runtime_error("ʱֲ");
-		}
-	}
-
-	// 캯֤ʽ -> ַ token תΪ token  -> ׺ת׺Shunting-yard
-	expression::expression(const std::string& infix_expression) {
-		expression_tokenizer tokenizer;
-		if (!tokenizer.validate(infix_expression)) {
-			throw std::runtime_error("ʽǷ\n" + tokenizer.detailed_analysis());
-		}
-		std::vector<std::string> strings = tokenizer.tokens();
-		for (const auto& str : strings) {
-			m_infix.push_back(token::from_string(str));
-		}
-		std::stack<token> ops;
-		for (const auto& tk : m_infix) {
-			token_t type = tk.type();
-			if (type == token_t::number_token) {
-				// ֱӼ׺ʽ
-				m_postfix.push_back(tk);
-			}
-			else {
-				// ջ
-				if (tk.operator_symbol() == "(") {
-					ops.push(tk);
-				}
-				// Ӧ
-				else if (tk.operator_symbol() == ")") {
-					while (!ops.empty()) {
-						if (ops.top().operator_symbol() == "(") {
-							ops.pop();
-							break;
-						}
-						else {
-							m_postfix.push_back(ops.top());
-							ops.pop();
-						}
-					}
-				}
-				// ͨȼջ߻ȼĲ
-				else {
-					while (!ops.empty() && ops.top().operator_prioriry() >= tk.operator_prioriry()) {
-						m_postfix.push_back(ops.top());
-						ops.pop();
-					}
-					ops.push(tk);
-				}
-			}
-		}
-		// ʣ׺
-		while (!ops.empty()) {
-			m_postfix.push_back(ops.top());
-			ops.pop();
-		}
-	}
-
-	// ׺ token блΪɶֵַı
-	std::string expression::infix_expression() const {
-		std::string str;
-		for (const auto& tk : m_infix) {
-			if (tk.type() == token_t::number_token) {
-				str += std::to_string(tk.number_value()) + ' ';
-			}
-			else {
-				str += tk.operator_symbol() + ' ';
-			}
-		}
-		return str;
-	}
-
-	// ׺ token блΪַڵԣ
-	std::string expression::postfix_expression() const {
-		std::string str;
-		for (const auto& tk : m_postfix) {
-			if (tk.type() == token_t::number_token) {
-				str += std::to_string(tk.number_value()) + ' ';
-			}
-			else {
-				str += tk.operator_symbol() + ' ';
-			}
-		}
-		return str;
-	}
-
-	// Ӻ׺ֱӼ㣨 calculate 
-	double expression::evaluate_from_postfix() const {
-		std::stack<token> operands;
-		for (const auto& tk : m_postfix) {
-			if (tk.type() == token_t::number_token) {
-				operands.push(tk);
-			}
-			else {
-				calculate(operands, tk);
-			}
-		}
-		if (operands.size() != 1) {
-			throw std::runtime_error("ʱջֻһԪ");
-		}
-		return operands.top().number_value();
-	}
-
-	// ֱӰ׺㣨ʱȼ
-	double expression::evaluate_from_infix() const {
-		std::stack<token> operands;
-		std::stack<token> ops;
-		for (const auto& tk : m_infix) {
-			if (tk.type() == token_t::number_token) {
-				operands.push(tk);
-			}
-			else {
-				if (tk.operator_symbol() == "(") {
-					ops.push(tk);
-				}
-				else if (tk.operator_symbol() == ")") {
-					while (!ops.empty()) {
-						if (ops.top().operator_symbol() == "(") {
-							ops.pop();
-							break;
-						}
-						else {
-							calculate(operands, ops.top());
-							ops.pop();
-						}
-					}
-				}
-				else {
-					while (!ops.empty() && ops.top().operator_prioriry() >= tk.operator_prioriry()) {
-						calculate(operands, ops.top());
-						ops.pop();
-					}
-					ops.push(tk);
-				}
-			}
-		}
-		// ʣ
-		while (!ops.empty()) {
-			calculate(operands, ops.top());
-			ops.pop();
-		}
-		if (operands.size() != 1) {
-			throw std::runtime_error("ʱջֻһԪ");
-		}
-		return operands.top().number_value();
-	}
-}
\ No newline at end of file
+#include "calculator.hpp"
+#include "call_memo.hpp"
+#include "function_library.hpp"
+#include "instrumentation.hpp"
+#include <bit>
+#include <charconv>
+
+namespace chr {
+	namespace {
+		// 函数展开后语法树的节点数上限，防止层层嵌套的自定义函数反复复制函数体
+		constexpr size_t MAX_TREE_NODES = size_t(1) << 20;
+		// 括弧、一元符号与 ^ 的嵌套层数上限：语法树按递归下降建立，限制递归深度以免栈溢出
+		constexpr size_t MAX_NESTING_DEPTH = 512;
+
+		inline bool is_space(char c) {
+			return std::isspace(static_cast<unsigned char>(c));
+		}
+
+		// 进制字面量 0b/0o/0x（已由分词器保证格式）：各位依次移入 64 位整数尾数，小数位每位使二进制指数减 bits_per_digit，
+		// 值为 mantissa * 2^exponent，整个过程没有舍入；尾数装满后丢弃的低位只记录是否非零（sticky），
+		// 此时尾数至少有 61 位有效位，足以按 53 位（次正规数按剩余位数）就近舍入到偶数
+		double parse_radix_literal(std::string_view text, int bits_per_digit) {
+			std::uint64_t mantissa = 0;
+			int exponent = 0;
+			bool fraction = false;
+			bool sticky = false;
+			for (size_t i = 2; i < text.size(); i++) {
+				char c = text[i];
+				if (c == '.') {
+					fraction = true;
+					continue;
+				}
+				std::uint64_t digit = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+				if (mantissa >> (64 - bits_per_digit) == 0) {
+					mantissa = mantissa << bits_per_digit | digit;
+					exponent -= fraction ? bits_per_digit : 0;
+				}
+				else {
+					sticky |= digit != 0;
+					exponent += fraction ? 0 : bits_per_digit;
+				}
+			}
+			if (mantissa == 0) {
+				return 0.0;
+			}
+			// 保留的最低位不低于 2^-1074（最小次正规数），且至多 53 位
+			int width = 64 - std::countl_zero(mantissa);
+			int shift = std::max(width - 53, -1074 - exponent);
+			if (shift > 64) {
+				return 0.0; // 小于最小次正规数的一半
+			}
+			if (shift > 0) {
+				std::uint64_t kept = shift == 64 ? 0 : mantissa >> shift;
+				std::uint64_t remainder = shift == 64 ? mantissa : mantissa & ((std::uint64_t(1) << shift) - 1);
+				std::uint64_t half = std::uint64_t(1) << (shift - 1);
+				mantissa = kept + (remainder > half || (remainder == half && (sticky || (kept & 1))));
+				exponent += shift;
+			}
+			// mantissa 不超过 2^53，ldexp 的结果是精确值或在超出范围时为 inf
+			return std::ldexp(static_cast<double>(mantissa), exponent);
+		}
+
+		// 十进制字面量（格式已由分词器保证）：from_chars 按就近舍入精确转换，不复制字符串、不依赖 locale
+		double parse_decimal_literal(std::string_view text) {
+			double value = 0.0;
+			auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+			if (ec == std::errc::result_out_of_range) {
+				throw std::runtime_error("数字字面量超出 double 范围：" + std::string(text));
+			}
+			if (ec != std::errc() || end != text.data() + text.size()) {
+				throw std::runtime_error("无法解析的数字字面量：" + std::string(text));
+			}
+			return value;
+		}
+	}
+
+	// 字节码解释器：在 double 数组栈上按操作码分派，编译时已保证栈深度足够
+	// memo 非空时代价高的纯函数调用改为查记忆表；不带记忆表的实例化中这一分支不存在
+	template <bool Memoized>
+	double execute(const instruction* code, size_t length, const double* variables, double* stack, double* temps, call_memo* memo) {
+		double* top = stack; // 指向下一个空位
+		for (const instruction* ip = code; ip != code + length; ++ip) {
+			if constexpr (Memoized) {
+				if (is_memoizable(ip->op)) {
+					if (operator_lookup(ip->op).operand_num == 2) {
+						--top;
+						top[-1] = memo->apply(ip->op, top[-1], top[0]);
+					}
+					else {
+						top[-1] = memo->apply(ip->op, top[-1], 0.0);
+					}
+					continue;
+				}
+			}
+			switch (ip->op) {
+			case opcode::push_number: *top++ = ip->value; break;
+			case opcode::push_variable: *top++ = variables[ip->slot]; break;
+			case opcode::load_temp: *top++ = temps[ip->slot]; break;
+			case opcode::store_temp: temps[ip->slot] = top[-1]; break;
+			case opcode::add: --top; top[-1] = top[-1] + top[0]; break;
+			case opcode::subtract: --top; top[-1] = top[-1] - top[0]; break;
+			case opcode::modulo: --top; top[-1] = fmodl(top[-1], top[0]); break;
+			case opcode::multiply: --top; top[-1] = top[-1] * top[0]; break;
+			case opcode::divide: --top; top[-1] = top[-1] / top[0]; break;
+			case opcode::exponent: --top; top[-1] = pow(top[-1], top[0]); break;
+			case opcode::posite: break;
+			case opcode::negate: top[-1] = -top[-1]; break;
+			case opcode::factorial: top[-1] = tgamma(top[-1] + 1); break;
+			case opcode::sine: top[-1] = sin(top[-1]); break;
+			case opcode::cosine: top[-1] = cos(top[-1]); break;
+			case opcode::tangent: top[-1] = tan(top[-1]); break;
+			case opcode::cotangent: top[-1] = 1 / tan(top[-1]); break;
+			case opcode::secant: top[-1] = 1 / cos(top[-1]); break;
+			case opcode::cosecant: top[-1] = 1 / sin(top[-1]); break;
+			case opcode::arcsine: top[-1] = asin(top[-1]); break;
+			case opcode::arccosine: top[-1] = acos(top[-1]); break;
+			case opcode::arctangent: top[-1] = atan(top[-1]); break;
+			case opcode::arccotangent: top[-1] = atan(1 / top[-1]); break;
+			case opcode::arcsecant: top[-1] = acos(1 / top[-1]); break;
+			case opcode::arccosecant: top[-1] = asin(1 / top[-1]); break;
+			case opcode::common_logarithm: top[-1] = log10(top[-1]); break;
+			case opcode::natural_logarithm: top[-1] = log(top[-1]); break;
+			case opcode::square_root: top[-1] = sqrt(top[-1]); break;
+			case opcode::cubic_root: top[-1] = cbrt(top[-1]); break;
+			case opcode::degree: top[-1] = top[-1] / CONSTANT_PI * 180; break;
+			case opcode::radian: top[-1] = top[-1] / 180 * CONSTANT_PI; break;
+			case opcode::minimum: --top; top[-1] = fmin(top[-1], top[0]); break;
+			case opcode::maximum: --top; top[-1] = fmax(top[-1], top[0]); break;
+			case opcode::hypotenuse: --top; top[-1] = hypot(top[-1], top[0]); break;
+			default: throw std::runtime_error("字节码中出现无法执行的操作码");
+			}
+		}
+		return stack[0];
+	}
+
+	double execute(const instruction* code, size_t length, const double* variables, double* stack, double* temps) {
+		return execute<false>(code, length, variables, stack, temps, nullptr);
+	}
+
+	namespace {
+		// 两个 evaluate 重载共用：深度不超过 EVALUATION_STACK_SIZE 时使用栈上数组，缓存槽位紧接在求值栈之后
+		template <bool Memoized>
+		double evaluate_program(const expression& expr, std::span<const double> values, call_memo* memo) {
+			CALCULATOR_COUNT_PROBE(evaluate);
+			if (values.size() < expr.variables().size()) {
+				throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(expr.variables().size()) + " 个");
+			}
+			const auto& program = expr.program();
+			if (expr.max_depth() + expr.temp_count() > EVALUATION_STACK_SIZE) {
+				std::vector<double> stack(expr.max_depth() + expr.temp_count());
+				return execute<Memoized>(program.data(), program.size(), values.data(), stack.data(), stack.data() + expr.max_depth(), memo);
+			}
+			double stack[EVALUATION_STACK_SIZE];
+			return execute<Memoized>(program.data(), program.size(), values.data(), stack, stack + expr.max_depth(), memo);
+		}
+	}
+
+	// 运算符操作码的操作数个数（push_* / load_temp / store_temp 不适用）
+	byte operator_arity(opcode op) noexcept {
+		return operator_lookup(op).operand_num;
+	}
+
+	// 根据字符串内容判断其 token 类型（整串恰好是一个 token 时返回其类型）
+	token_t token_type(std::string_view str) noexcept {
+		if (str.empty()) {
+			return token_t::invalid_token;
+		}
+		if (str == "pos" || str == "neg") {
+			return token_t::signal_operator;
+		}
+		token_t type = token_t::invalid_token;
+		if (scan_token(str, 0, type) != str.length()) {
+			return token_t::invalid_token;
+		}
+		return type;
+	}
+
+	// 分词：单遍扫描，每个位置只尝试一次匹配，连续的未知字符合并为一条错误
+	bool expression_tokenizer::tokenize(const std::string& expression) {
+		CALCULATOR_TIMED_PROBE(tokenize);
+		m_source = expression;
+		m_tokens.clear();
+		m_errors.clear();
+		size_t pos = 0;        // 扫描位置
+		size_t unknown = 0;    // 尚未归入任何 token 的内容起点
+		while (pos < expression.length()) {
+			token_t type = token_t::invalid_token;
+			size_t len = scan_token(expression, pos, type);
+			if (len == 0) {
+				pos++;
+				continue;
+			}
+			// 如果当前匹配之前存在未匹配的内容，视为未知字符或错误
+			if (pos > unknown && !std::all_of(expression.begin() + unknown, expression.begin() + pos, is_space)) {
+				add_error(diagnostic_code::unrecognized_character, unknown, pos);
+			}
+			m_tokens.push_back({ type, expression.substr(pos, len), pos });
+			pos += len;
+			unknown = pos;
+		}
+		// 检查末尾是否有剩余无法识别内容
+		if (unknown < expression.length() && !std::all_of(expression.begin() + unknown, expression.end(), is_space)) {
+			add_error(diagnostic_code::trailing_characters, unknown, expression.length());
+		}
+		// 将一元 + / - 解析为内部标记 pos/neg，方便后续验证与计算
+		parse_signal_operators();
+		return m_errors.empty();
+	}
+
+	// 完整验证：先分词，后逐项语法检查
+	bool expression_tokenizer::validate(const std::string& expression) {
+		if (!tokenize(expression)) {
+			return 0;
+		}
+		parse_parenthese();         // 括弧配对检查
+		parse_operator_sequence();  // 运算符顺序合法性检查
+		parse_number_format();      // 数字字面量格式检查
+		parse_function_usage();     // 函数调用形式检查（函数名后必须跟 '('）
+		return m_errors.empty();
+	}
+
+	// 把作为二元运算符的 + - 在合适位置识别为一元运算符 pos/neg
+	void expression_tokenizer::parse_signal_operators() {
+		CALCULATOR_TIMED_PROBE(parse_signal_operators);
+		for (size_t i = 0; i < m_tokens.size(); ++i) {
+			lexeme& token = m_tokens[i];
+			if (token.text == "+" || token.text == "-") {
+				// 如果是表达式开头，或前一个是运算符(且不是右括弧或阶乘)或函数名，视为一元符号
+				if (i == 0 || ((token_t::operator_token & m_tokens[i - 1].type) && m_tokens[i - 1].text != ")"
+					&& m_tokens[i - 1].text != "!")) {
+					token.type = token_t::signal_operator;
+					token.text = token.text == "+" ? "pos" : "neg";
+				}
+			}
+		}
+	}
+
+	// 检查括弧匹配，并记录多余左右括弧的错误位置
+	void expression_tokenizer::parse_parenthese() {
+		CALCULATOR_TIMED_PROBE(parse_parenthese);
+		size_t depth = 0;
+		for (const auto& token : m_tokens) {
+			if (token.text == "(") {
+				depth++;
+			}
+			else if (token.text == ")") {
+				if (depth == 0) {
+					add_error(diagnostic_code::extra_right_parenthesis, token);
+				}
+				else {
+					depth--;
+				}
+			}
+		}
+		// 剩余左括弧视为多余：它们都在最后一个多余的右括弧之后，从末尾向前匹配即可找出，
+		// 先报告最靠后的一个（与按栈弹出的顺序相同），不需要额外的栈
+		for (size_t i = m_tokens.size(), closing = 0; depth > 0;) {
+			const auto& token = m_tokens[--i];
+			if (token.text == ")") {
+				closing++;
+			}
+			else if (token.text == "(") {
+				if (closing > 0) {
+					closing--;
+				}
+				else {
+					add_error(diagnostic_code::extra_left_parenthesis, token);
+					depth--;
+				}
+			}
+		}
+	}
+
+	// 检查运算符序列的合法性（连续运算符 / 运算符起始或结尾等）
+	void expression_tokenizer::parse_operator_sequence() {
+		CALCULATOR_TIMED_PROBE(parse_operator_sequence);
+		for (size_t i = 0; i < m_tokens.size(); ++i) {
+			const lexeme& token = m_tokens[i];
+			// 一元符号（pos/neg）不能出现在表达式末尾，也不能连续出现
+			if (token.type == token_t::signal_operator) {
+				if (i == m_tokens.size() - 1) {
+					add_error(diagnostic_code::ends_with_operator, token);
+				}
+				else {
+					if (i != 0 && m_tokens[i - 1].type == token_t::signal_operator) {
+						add_error(diagnostic_code::consecutive_signs, token);
+					}
+				}
+			}
+			// 阶乘必须跟在数字/常量或右括弧后面
+			else if (token.text == "!") {
+				if (i == 0) {
+					add_error(diagnostic_code::starts_with_factorial, token);
+				}
+				else {
+					const lexeme& prev = m_tokens[i - 1];
+					if (!(is_operand(prev.type) || prev.text == ")")) {
+						add_error(diagnostic_code::factorial_operand, token);
+					}
+				}
+			}
+			// 普通二元运算符（除了括弧）检查起始/结尾与连续二元运算符
+			else if (token.text != "(" && token.text != ")" && token.type == token_t::normal_operator) {
+				if (i == 0) {
+					add_error(diagnostic_code::starts_with_binary, token);
+				}
+				else if (i == m_tokens.size() - 1) {
+					add_error(diagnostic_code::ends_with_operator, token);
+				}
+				else if (m_tokens[i - 1].type == token_t::signal_operator) {
+					add_error(diagnostic_code::consecutive_binary, token);
+				}
+			}
+		}
+	}
+
+	// 数字字面量检查：进制与科学计数法格式已由分词器的扫描规则保证，这里只检查连续操作数
+	void expression_tokenizer::parse_number_format() {
+		CALCULATOR_TIMED_PROBE(parse_number_format);
+		for (size_t i = 1; i < m_tokens.size(); i++) {
+			const lexeme& token = m_tokens[i];
+			const lexeme& prev = m_tokens[i - 1];
+			// 上一个也是数字 -> 连续数字错误；涉及变量时同样不允许省略运算符
+			if ((token_t::number_token & token.type) && token.type != token_t::constant_number &&
+				(token_t::number_token & prev.type)) {
+				add_error(diagnostic_code::consecutive_digits, prev.offset, token.offset + token.length());
+			}
+			else if (is_operand(token.type) && is_operand(prev.type) &&
+				(token.type == token_t::variable_token || prev.type == token_t::variable_token)) {
+				add_error(diagnostic_code::consecutive_operands, prev.offset, token.offset + token.length());
+			}
+		}
+	}
+
+	// 函数使用检查：函数名后必须紧接 '('，否则报错
+	void expression_tokenizer::parse_function_usage() {
+		CALCULATOR_TIMED_PROBE(parse_function_usage);
+		for (size_t i = 0; i < m_tokens.size(); ++i) {
+			if (m_tokens[i].type == token_t::function_operator &&
+				(i + 1 >= m_tokens.size() || m_tokens[i + 1].text != "(")) {
+				add_error(diagnostic_code::function_without_call, m_tokens[i]);
+			}
+		}
+	}
+
+	// 添加错误记录（种类与源文本范围）
+	void expression_tokenizer::add_error(diagnostic_code code, size_t begin, size_t end) {
+		m_errors.push_back({ code, static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end) });
+	}
+
+	std::string expression_tokenizer::detailed_analysis() const {
+		return render_diagnostics(m_source, m_tokens, m_errors);
+	}
+
+	const char* diagnostic_message(diagnostic_code code) noexcept {
+		switch (code) {
+		case diagnostic_code::unrecognized_character: return "无法识别的字符或符号";
+		case diagnostic_code::trailing_characters: return "表达式末尾有无法识别的字符";
+		case diagnostic_code::extra_right_parenthesis: return "存在多余的右括弧";
+		case diagnostic_code::extra_left_parenthesis: return "存在多余的左括弧";
+		case diagnostic_code::ends_with_operator: return "表达式以运算符结尾";
+		case diagnostic_code::consecutive_signs: return "表达式含有连续符号运算符";
+		case diagnostic_code::starts_with_factorial: return "表达式以阶乘运算符开头";
+		case diagnostic_code::factorial_operand: return "阶乘运算符前面必须是数字、常量、变量或表达式";
+		case diagnostic_code::starts_with_binary: return "表达式以二元运算符开头";
+		case diagnostic_code::consecutive_binary: return "表达式含有连续二元运算符";
+		case diagnostic_code::consecutive_digits: return "表达式含有连续数字";
+		case diagnostic_code::consecutive_operands: return "表达式含有连续操作数";
+		case diagnostic_code::function_without_call: return "函数名未紧跟左括号";
+		}
+		return "";
+	}
+
+	// token 序号由错误范围的起点在 tokens 中二分查找得到
+	std::string diagnostic_position(const diagnostic& error, std::string_view source, std::span<const lexeme> tokens) {
+		auto token_at = [&]() {
+			auto it = std::lower_bound(tokens.begin(), tokens.end(), error.begin,
+				[](const lexeme& lx, size_t offset) { return lx.offset < offset; });
+			return static_cast<size_t>(it - tokens.begin());
+		};
+		switch (error.code) {
+		case diagnostic_code::extra_right_parenthesis: case diagnostic_code::extra_left_parenthesis:
+		case diagnostic_code::ends_with_operator: case diagnostic_code::consecutive_signs:
+		case diagnostic_code::starts_with_factorial: case diagnostic_code::factorial_operand:
+		case diagnostic_code::starts_with_binary: case diagnostic_code::consecutive_binary:
+			return std::to_string(token_at());
+		case diagnostic_code::consecutive_digits: case diagnostic_code::consecutive_operands: {
+			size_t index = token_at();
+			const char* separator = error.code == diagnostic_code::consecutive_operands ? " " : "";
+			return tokens[index].text + separator + tokens[index + 1].text;
+		}
+		default:
+			return std::string(source.substr(error.begin, error.end - error.begin));
+		}
+	}
+
+	std::string render_diagnostics(std::string_view source, std::span<const lexeme> tokens, std::span<const diagnostic> errors) {
+		std::string str;
+		for (const auto& token : tokens) {
+			str += "【" + std::to_string(static_cast<byte>(token.type)) + "】：" + token.text + "\n";
+		}
+		for (const auto& error : errors) {
+			str += "【" + diagnostic_position(error, source, tokens) + "】：" + diagnostic_message(error.code) + "\n";
+		}
+		if (!str.empty()) {
+			str.pop_back();
+		}
+		return str;
+	}
+
+	// 将字符串解析为 token（数字或操作符），不含空白
+	token token::from_string(const std::string& str) {
+		std::string cpstr = str;
+		// 去除前后空白
+		while (!cpstr.empty() && std::isspace(cpstr.front())) {
+			cpstr.erase(0, 1);
+		}
+		while (!cpstr.empty() && std::isspace(cpstr.back())) {
+			cpstr.pop_back();
+		}
+		if (cpstr.empty()) {
+			throw std::runtime_error("出现空白令牌");
+		}
+		// 尝试解析为数字
+		if (auto number = try_parse_number(cpstr, token_type(cpstr))) {
+			return token::from_number(*number);
+		}
+		// 尝试解析为操作符/函数
+		if (auto op_token = try_parse_operator(cpstr)) {
+			return *op_token;
+		}
+		throw std::runtime_error("解析令牌出错");
+	}
+
+	// 由分词器输出的带类型 token 构造，数字直接按已知类型解析，无需再次分类
+	token token::from_lexeme(const lexeme& lx) {
+		return from_lexeme(lx.text, lx.type);
+	}
+
+	token token::from_lexeme(std::string_view text, token_t type) {
+		if (auto number = try_parse_number(text, type)) {
+			return token::from_number(*number);
+		}
+		if (auto op_token = try_parse_operator(text)) {
+			return *op_token;
+		}
+		throw std::runtime_error("解析令牌出错");
+	}
+
+	// 尝试将字符串转换为数字值（支持常数与多进制字面量）
+	inline std::optional<double> token::try_parse_number(std::string_view str, token_t type) {
+		if (!(token_t::number_token & type)) {
+			return std::nullopt;
+		}
+		if (type == token_t::decimal_number) {
+			return parse_decimal_literal(str);
+		}
+		// 常数替换为数值
+		else if (type == token_t::constant_number) {
+			if (str == "E") {
+				return CONSTANT_E;
+			}
+			else if (str == "PI") {
+				return CONSTANT_PI;
+			}
+			else if (str == "PHI") {
+				return CONSTANT_PHI;
+			}
+			else {
+				throw std::runtime_error("出现无效常数");
+			}
+		}
+		// 二/八/十六进制字面量：每位恰好对应 1/3/4 个二进制位，可以精确解析
+		else if (type == token_t::binary_number) {
+			return parse_radix_literal(str, 1);
+		}
+		else if (type == token_t::octal_number) {
+			return parse_radix_literal(str, 3);
+		}
+		else if (type == token_t::hexadecimal_number) {
+			return parse_radix_literal(str, 4);
+		}
+		else {
+			throw std::runtime_error("出现无效进制");
+		}
+	}
+
+	expression::expression(const std::string& infix_expression)
+		:expression(std::string_view(infix_expression), std::pmr::get_default_resource()) {}
+
+	// 构造函数：分词并验证 -> 按优先级爬升建立语法树 -> 优化 -> 编译为字节码
+	// 全部临时容器都从 arena 分配并按 token 数一次预留
+	expression::expression(std::string_view infix_expression, std::pmr::memory_resource* arena)
+		:expression(infix_expression, nullptr, arena) {}
+
+	expression::expression(std::string_view infix_expression, const function_library& functions, std::pmr::memory_resource* arena)
+		:expression(infix_expression, &functions, arena) {}
+
+	expression::expression(std::string_view infix_expression, const function_library* functions, std::pmr::memory_resource* arena)
+		:m_tree(arena), m_program(arena), m_variables(arena), m_literals(arena) {
+		scan(infix_expression, functions);
+		compile(optimize());
+	}
+
+	namespace {
+		// 分词结果：text 指向源串，一元 + / - 已改写为 pos / neg
+		struct lexeme_view {
+			token_t type;
+			std::string_view text;
+		};
+
+		// 删除从根不可达的节点（未被函数体使用的实参、优化时被替换掉的子树），其余节点保持后序
+		void remove_unreachable(std::pmr::vector<ast_node>& tree) {
+			std::pmr::memory_resource* arena = tree.get_allocator().resource();
+			std::pmr::vector<bool> reachable(tree.size(), false, arena);
+			reachable.back() = true;
+			size_t count = 0;
+			for (size_t i = tree.size(); i-- > 0;) {
+				if (reachable[i]) {
+					count++;
+					if (tree[i].left != NO_INDEX) {
+						reachable[tree[i].left] = true;
+					}
+					if (tree[i].right != NO_INDEX) {
+						reachable[tree[i].right] = true;
+					}
+				}
+			}
+			if (count == tree.size()) {
+				return;
+			}
+			std::pmr::vector<std::uint32_t> mapped(tree.size(), NO_INDEX, arena);
+			size_t kept = 0;
+			for (size_t i = 0; i < tree.size(); i++) {
+				if (!reachable[i]) {
+					continue;
+				}
+				ast_node node = tree[i];
+				if (node.left != NO_INDEX) {
+					node.left = mapped[node.left];
+				}
+				if (node.right != NO_INDEX) {
+					node.right = mapped[node.right];
+				}
+				mapped[i] = static_cast<std::uint32_t>(kept);
+				tree[kept++] = node;
+			}
+			tree.resize(kept);
+		}
+
+		// 优先级爬升（Pratt）解析器：单遍读取已验证的分词结果，按后序把节点追加到语法树，不产生括弧节点
+		// 左结合的二元运算符的右操作数只接受更高优先级的运算，^ 右结合，右操作数接受同级；
+		// 一元 pos/neg 的操作数接受同级及更高优先级的运算（-2^2 为 -(2^2)），阶乘作为后缀运算符作用于已解析的左操作数
+		// 函数调用在这里展开：多参数函数的实参依次折叠为二元运算，自定义函数复制函数体的节点，
+		// 函数体中的参数节点直接换成实参子树的根，实参不复制
+		class tree_parser {
+			std::span<const lexeme_view> m_lexemes;
+			const function_library* m_functions;
+			std::pmr::vector<ast_node>& m_tree;
+			std::pmr::vector<std::pmr::string>& m_variables;
+			std::pmr::vector<std::pmr::string>& m_literals;
+			size_t m_position = 0;
+			size_t m_depth = 0;
+			// 同一位置的运算符会被逐层返回的各级 parse_expression 反复查询，缓存最近一次的查表结果
+			size_t m_lookahead_position = SIZE_MAX;
+			std::optional<token> m_lookahead;
+		public:
+			tree_parser(std::span<const lexeme_view> lexemes, const function_library* functions, std::pmr::vector<ast_node>& tree,
+				std::pmr::vector<std::pmr::string>& variables, std::pmr::vector<std::pmr::string>& literals)
+				:m_lexemes(lexemes), m_functions(functions), m_tree(tree), m_variables(variables), m_literals(literals) {}
+
+			// 解析整个表达式，全部分词都必须被消耗
+			void parse() {
+				if (m_lexemes.empty()) {
+					throw std::runtime_error("表达式为空");
+				}
+				parse_expression(0);
+				if (m_position != m_lexemes.size()) {
+					unexpected_lexeme();
+				}
+			}
+		private:
+			std::uint32_t push(const ast_node& node) {
+				m_tree.push_back(node);
+				return static_cast<std::uint32_t>(m_tree.size() - 1);
+			}
+
+			bool next_is(std::string_view text) const {
+				return m_position < m_lexemes.size() && m_lexemes[m_position].text == text;
+			}
+
+			// 在应当出现二元运算符或右括弧的位置遇到了其他分词
+			[[noreturn]] void unexpected_lexeme() const {
+				if (next_is(",")) {
+					throw std::runtime_error("逗号只能用于分隔函数参数");
+				}
+				throw std::runtime_error("表达式结构错误：计算结果不是单一数值");
+			}
+
+			// 当前位置的二元运算符或阶乘；括弧、逗号等其他分词返回空
+			std::optional<token> infix_operator() {
+				if (m_position == m_lookahead_position) {
+					return m_lookahead;
+				}
+				m_lookahead_position = m_position;
+				m_lookahead.reset();
+				if (m_position < m_lexemes.size() && m_lexemes[m_position].type == token_t::normal_operator) {
+					std::optional<token> tk = token::try_parse_operator(m_lexemes[m_position].text);
+					if (tk && (tk->operator_operand_num() == 2 || tk->operator_code() == opcode::factorial)) {
+						m_lookahead = tk;
+					}
+				}
+				return m_lookahead;
+			}
+
+			// 解析一个操作数及其后优先级不低于 min_priority 的全部运算
+			std::uint32_t parse_expression(byte min_priority) {
+				if (++m_depth > MAX_NESTING_DEPTH) {
+					throw std::runtime_error("表达式嵌套层数超过 " + std::to_string(MAX_NESTING_DEPTH) + " 层");
+				}
+				std::uint32_t left = parse_operand();
+				for (std::optional<token> op = infix_operator(); op && op->operator_prioriry() >= min_priority; op = infix_operator()) {
+					m_position++;
+					if (op->operator_operand_num() == 1) {
+						left = push({ op->operator_code(), NO_INDEX, left });
+						continue;
+					}
+					byte next = op->operator_code() == opcode::exponent ? op->operator_prioriry() : op->operator_prioriry() + 1;
+					std::uint32_t right = parse_expression(next);
+					left = push({ op->operator_code(), NO_INDEX, left, right });
+				}
+				m_depth--;
+				return left;
+			}
+
+			// 数字、变量、带一元符号的操作数、函数调用或括弧内的子表达式
+			std::uint32_t parse_operand() {
+				if (m_position == m_lexemes.size()) {
+					throw std::runtime_error("表达式结构错误：运算符缺少操作数");
+				}
+				const lexeme_view& lx = m_lexemes[m_position++];
+				// 数字保留字面量原文，高精度数值后端从原文重新解析
+				if (token_t::number_token & lx.type) {
+					double value = token::from_lexeme(lx.text, lx.type).number_value();
+					m_literals.emplace_back(lx.text);
+					return push({ opcode::push_number, static_cast<std::uint32_t>(m_literals.size() - 1), NO_INDEX, NO_INDEX, value });
+				}
+				// 变量按名字分配槽位，同名变量共享同一槽位
+				if (lx.type == token_t::variable_token) {
+					auto it = std::find(m_variables.begin(), m_variables.end(), lx.text);
+					size_t slot = it - m_variables.begin();
+					if (it == m_variables.end()) {
+						m_variables.emplace_back(lx.text);
+					}
+					return push({ opcode::push_variable, static_cast<std::uint32_t>(slot) });
+				}
+				if (lx.type == token_t::signal_operator) {
+					token sign = token::from_lexeme(lx.text, lx.type);
+					std::uint32_t operand = parse_expression(sign.operator_prioriry());
+					return push({ sign.operator_code(), NO_INDEX, operand });
+				}
+				if (lx.type == token_t::function_operator) {
+					return parse_call(lx.text);
+				}
+				if (lx.text == "(") {
+					std::uint32_t inner = parse_expression(0);
+					if (!next_is(")")) {
+						unexpected_lexeme();
+					}
+					m_position++;
+					return inner;
+				}
+				throw std::runtime_error("表达式结构错误：运算符缺少操作数");
+			}
+
+			// 函数调用：当前位置是函数名后的左括弧（验证时已保证）
+			std::uint32_t parse_call(std::string_view name) {
+				m_position++;
+				std::pmr::vector<std::uint32_t> arguments(m_tree.get_allocator().resource());
+				// f() 没有参数；否则每个参数都不能为空
+				if (next_is(")")) {
+					m_position++;
+				}
+				else {
+					for (bool more = true; more; m_position++) {
+						if (next_is(",") || next_is(")")) {
+							throw std::runtime_error("函数 " + std::string(name) + " 的参数为空");
+						}
+						arguments.push_back(parse_expression(0));
+						more = next_is(",");
+						if (!more && !next_is(")")) {
+							unexpected_lexeme();
+						}
+					}
+				}
+				size_t count = arguments.size();
+				auto variadic = std::find_if(std::begin(lexer::variadic_functions), std::end(lexer::variadic_functions),
+					[&](const lexer::variadic_function& fn) { return name == fn.name; });
+				if (const function_definition* definition = m_functions != nullptr ? m_functions->find(name) : nullptr) {
+					if (count != definition->parameters.size()) {
+						throw std::runtime_error("函数 " + std::string(name) + " 需要 " +
+							std::to_string(definition->parameters.size()) + " 个参数，实际为 " + std::to_string(count) + " 个");
+					}
+					return expand(*definition, arguments);
+				}
+				if (variadic != std::end(lexer::variadic_functions)) {
+					if (count == 0) {
+						throw std::runtime_error("函数 " + std::string(name) + " 至少需要 1 个参数");
+					}
+					std::uint32_t result = arguments[0];
+					for (size_t k = 1; k < count; k++) {
+						result = push({ variadic->op, NO_INDEX, result, arguments[k] });
+					}
+					return result;
+				}
+				if (count != 1) {
+					throw std::runtime_error("函数 " + std::string(name) + " 需要 1 个参数，实际为 " + std::to_string(count) + " 个");
+				}
+				return push({ token::from_lexeme(name, token_t::function_operator).operator_code(), NO_INDEX, arguments[0] });
+			}
+
+			// 复制自定义函数的函数体：参数节点换成对应实参的根节点，函数体的字面量接在调用方字面量之后
+			std::uint32_t expand(const function_definition& definition, std::span<const std::uint32_t> arguments) {
+				if (m_tree.size() + definition.body.size() > MAX_TREE_NODES) {
+					throw std::runtime_error("函数展开后的表达式过长");
+				}
+				size_t literal_base = m_literals.size();
+				for (const auto& literal : definition.literals) {
+					m_literals.emplace_back(literal);
+				}
+				std::pmr::vector<std::uint32_t> mapped(definition.body.size(), m_tree.get_allocator().resource());
+				for (size_t i = 0; i < definition.body.size(); i++) {
+					ast_node node = definition.body[i];
+					if (node.op == opcode::push_variable) {
+						mapped[i] = arguments[node.index];
+						continue;
+					}
+					if (node.op == opcode::push_number) {
+						node.index += static_cast<std::uint32_t>(literal_base);
+					}
+					if (node.left != NO_INDEX) {
+						node.left = mapped[node.left];
+					}
+					if (node.right != NO_INDEX) {
+						node.right = mapped[node.right];
+					}
+					mapped[i] = push(node);
+				}
+				return mapped.back();
+			}
+		};
+	}
+
+	// 分词与验证，再由 tree_parser 建立语法树写入 m_tree；分词结果以 string_view 指向源串
+	void expression::scan(std::string_view infix_expression, const function_library* functions) {
+		std::pmr::memory_resource* arena = m_tree.get_allocator().resource();
+		std::pmr::vector<lexeme_view> lexemes(arena);
+		{
+			CALCULATOR_TIMED_PROBE(scan);
+			lexemes.reserve(infix_expression.size());
+			// 分词：规则同 expression_tokenizer::tokenize，无法识别的非空白字符使表达式非法
+			bool valid = true;
+			for (size_t pos = 0; pos < infix_expression.length();) {
+				token_t type = token_t::invalid_token;
+				size_t len = scan_token(infix_expression, pos, type);
+				if (len == 0) {
+					valid = valid && is_space(infix_expression[pos]);
+					pos++;
+					continue;
+				}
+				// 一元 + / - 改写为 pos/neg，规则同 parse_signal_operators
+				std::string_view text = infix_expression.substr(pos, len);
+				if ((text == "+" || text == "-") && (lexemes.empty() || ((token_t::operator_token & lexemes.back().type)
+					&& lexemes.back().text != ")" && lexemes.back().text != "!"))) {
+					type = token_t::signal_operator;
+					text = text == "+" ? "pos" : "neg";
+				}
+				lexemes.push_back({ type, text });
+				pos += len;
+			}
+			// 自定义函数名分词时是变量，紧跟左括弧时改为函数
+			if (functions != nullptr) {
+				for (size_t i = 0; i + 1 < lexemes.size(); i++) {
+					if (lexemes[i].type == token_t::variable_token && lexemes[i + 1].text == "(" &&
+						functions->find(lexemes[i].text) != nullptr) {
+						lexemes[i].type = token_t::function_operator;
+					}
+				}
+			}
+			// 验证：括弧配对与逐个 token 的局部检查
+			size_t depth = 0;
+			for (size_t i = 0; i < lexemes.size() && valid; i++) {
+				if (lexemes[i].text == "(") {
+					depth++;
+				}
+				else if (lexemes[i].text == ")") {
+					valid = depth-- > 0;
+				}
+				valid = valid && check_token(std::span<const lexeme_view>(lexemes), i).count() == 0;
+			}
+			// 非法表达式交给 expression_tokenizer 重新分析，生成完整的错误信息
+			if (!valid || depth != 0) {
+				expression_tokenizer tokenizer;
+				tokenizer.validate(std::string(infix_expression));
+				throw std::runtime_error("表达式非法：\n" + tokenizer.detailed_analysis());
+			}
+		}
+		CALCULATOR_TIMED_PROBE(parse);
+		m_tree.reserve(lexemes.size());
+		tree_parser(lexemes, functions, m_tree, m_variables, m_literals).parse();
+		remove_unreachable(m_tree);
+	}
+
+	// 语法树优化：折叠常量子树，并按恒等式消去 x*1、1*x、x/1、x+0、0+x、x-0、pos(x)、neg(neg(x))
+	// 不做 x*0 -> 0 之类会改变 NaN/无穷结果的化简；x+0 只在 x 为 -0 时把结果变为 +0
+	// 结果是一棵新的语法树，m_tree 保持原样，供需要字面量原文的高精度数值后端使用
+	std::pmr::vector<ast_node> expression::optimize() {
+		CALCULATOR_TIMED_PROBE(optimize);
+		std::pmr::memory_resource* arena = m_tree.get_allocator().resource();
+		std::pmr::vector<ast_node> output(arena);
+		std::pmr::vector<std::uint32_t> mapped(arena); // m_tree 中每个节点在 output 中的对应节点
+		output.reserve(m_tree.size());
+		mapped.reserve(m_tree.size());
+		m_optimization = optimization_report{};
+		m_optimization.nodes_before = m_tree.size();
+		auto is_constant = [&](std::uint32_t id, double value) {
+			return output[id].op == opcode::push_number && output[id].value == value;
+		};
+		auto push = [&](const ast_node& node) {
+			output.push_back(node);
+			return static_cast<std::uint32_t>(output.size() - 1);
+		};
+		auto fold = [&](double value) {
+			m_optimization.folded_operations++;
+			return push({ opcode::push_number, NO_INDEX, NO_INDEX, NO_INDEX, value });
+		};
+		for (const ast_node& node : m_tree) {
+			if (node.op == opcode::push_number || node.op == opcode::push_variable) {
+				mapped.push_back(push(node));
+				continue;
+			}
+			const operator_info& info = operator_lookup(node.op);
+			std::uint32_t a = mapped[node.left];
+			if (info.operand_num == 1) {
+				if (output[a].op == opcode::push_number) {
+					mapped.push_back(fold(info.apply(output[a].value, 0)));
+				}
+				else if (node.op == opcode::posite) {
+					mapped.push_back(a);
+					m_optimization.simplified_identities++;
+				}
+				else if (node.op == opcode::negate && output[a].op == opcode::negate) {
+					mapped.push_back(output[a].left);
+					m_optimization.simplified_identities += 2;
+				}
+				else {
+					mapped.push_back(push({ node.op, NO_INDEX, a }));
+				}
+				continue;
+			}
+			std::uint32_t b = mapped[node.right];
+			opcode op = node.op;
+			if (output[a].op == opcode::push_number && output[b].op == opcode::push_number) {
+				mapped.push_back(fold(info.apply(output[a].value, output[b].value)));
+			}
+			// 右操作数为单位元：结果即左操作数
+			else if ((op == opcode::multiply && is_constant(b, 1)) || (op == opcode::divide && is_constant(b, 1)) ||
+				(op == opcode::add && is_constant(b, 0)) || (op == opcode::subtract && is_constant(b, 0))) {
+				mapped.push_back(a);
+				m_optimization.simplified_identities++;
+			}
+			// 左操作数为单位元：结果即右操作数
+			else if ((op == opcode::multiply && is_constant(a, 1)) || (op == opcode::add && is_constant(a, 0))) {
+				mapped.push_back(b);
+				m_optimization.simplified_identities++;
+			}
+			else {
+				mapped.push_back(push({ op, NO_INDEX, a, b }));
+			}
+		}
+		// 根可能被化简为已有节点，把它移到末尾后再删去不可达节点
+		if (mapped.back() != output.size() - 1) {
+			output.push_back(output[mapped.back()]);
+		}
+		remove_unreachable(output);
+		m_optimization.nodes_after = output.size();
+		return output;
+	}
+
+	// 将优化后的语法树编译为字节码，分两遍进行：
+	// 第一遍按后序对节点做结构哈希（操作码 + 立即数 + 子节点编号），相同子表达式归并为同一 DAG 节点；
+	// 第二遍从根出发深度优先生成指令（先左后右，即后缀顺序），被多次引用的运算节点首次计算后 store_temp 缓存，
+	// 之后再次遇到时不再展开，改为一条 load_temp
+	void expression::compile(const std::pmr::vector<ast_node>& tree) {
+		CALCULATOR_TIMED_PROBE(compile);
+		struct node_key {
+			opcode op;
+			std::uint64_t payload;     // 常数的位模式或变量槽位
+			std::uint32_t left, right; // 子节点的 DAG 编号（无子节点时为 NO_INDEX）
+			bool operator==(const node_key& other) const = default;
+		};
+		struct node_key_hash {
+			size_t operator()(const node_key& key) const {
+				size_t h = std::hash<std::uint64_t>()(key.payload);
+				h = h * 31 + static_cast<size_t>(key.op);
+				h = h * 31 + std::hash<std::uint32_t>()(key.left);
+				return h * 31 + std::hash<std::uint32_t>()(key.right);
+			}
+		};
+		std::pmr::memory_resource* arena = m_tree.get_allocator().resource();
+		std::pmr::unordered_map<node_key, std::uint32_t, node_key_hash> nodes(tree.size(), arena);
+		std::pmr::vector<std::uint32_t> ids(tree.size(), arena); // 每个语法树节点对应的 DAG 节点
+		std::pmr::vector<ast_node> dag(arena);                   // DAG 节点，子节点为 DAG 编号
+		std::pmr::vector<size_t> uses(arena);                    // 每个 DAG 节点被父节点引用的次数
+		dag.reserve(tree.size());
+		uses.reserve(tree.size());
+		for (size_t i = 0; i < tree.size(); i++) {
+			ast_node node = tree[i];
+			node_key key{ node.op, 0, NO_INDEX, NO_INDEX };
+			if (node.op == opcode::push_number) {
+				std::memcpy(&key.payload, &node.value, sizeof(node.value));
+			}
+			else if (node.op == opcode::push_variable) {
+				key.payload = node.index;
+			}
+			else {
+				node.left = key.left = ids[node.left];
+				if (node.right != NO_INDEX) {
+					node.right = key.right = ids[node.right];
+				}
+			}
+			auto [it, inserted] = nodes.try_emplace(key, static_cast<std::uint32_t>(dag.size()));
+			if (inserted) {
+				dag.push_back(node);
+				uses.push_back(0);
+				if (node.left != NO_INDEX) {
+					uses[node.left]++;
+				}
+				if (node.right != NO_INDEX) {
+					uses[node.right]++;
+				}
+			}
+			ids[i] = it->second;
+		}
+
+		// 待生成的节点：expanded 表示操作数的指令已经生成，接下来生成运算本身
+		struct pending {
+			std::uint32_t id;
+			bool expanded;
+		};
+		std::pmr::vector<std::uint32_t> temps(dag.size(), NO_INDEX, arena); // 节点对应的缓存槽位
+		std::pmr::vector<pending> work(arena);
+		work.reserve(dag.size());
+		m_program.clear();
+		m_program.reserve(tree.size());
+		m_temp_count = 0;
+		work.push_back({ ids.back(), false });
+		while (!work.empty()) {
+			pending item = work.back();
+			work.pop_back();
+			const ast_node& node = dag[item.id];
+			if (node.op == opcode::push_number) {
+				m_program.push_back({ opcode::push_number, 0, node.value });
+			}
+			else if (node.op == opcode::push_variable) {
+				m_program.push_back({ opcode::push_variable, node.index, 0.0 });
+			}
+			else if (temps[item.id] != NO_INDEX) {
+				m_program.push_back({ opcode::load_temp, temps[item.id], 0.0 });
+			}
+			else if (!item.expanded) {
+				work.push_back({ item.id, true });
+				if (node.right != NO_INDEX) {
+					work.push_back({ node.right, false });
+				}
+				work.push_back({ node.left, false });
+			}
+			else {
+				m_program.push_back({ node.op, 0, 0.0 });
+				if (uses[item.id] > 1) {
+					temps[item.id] = static_cast<std::uint32_t>(m_temp_count++);
+					m_program.push_back({ opcode::store_temp, temps[item.id], 0.0 });
+				}
+			}
+		}
+		m_optimization.dag_nodes = dag.size();
+		m_optimization.cached_nodes = m_temp_count;
+
+		// 模拟求值栈得到所需最大深度
+		size_t depth = 0;
+		m_max_depth = 0;
+		for (const auto& ins : m_program) {
+			switch (ins.op) {
+			case opcode::push_number: case opcode::push_variable: case opcode::load_temp:
+				depth++;
+				break;
+			case opcode::store_temp:
+				break;
+			default:
+				depth -= operator_arity(ins.op) - 1;
+				break;
+			}
+			m_max_depth = std::max(m_max_depth, depth);
+		}
+	}
+
+	// 按语法树逐节点拼出完全加括弧的中缀形式：数字输出字面量原文，变量输出变量名
+	std::string expression::infix_expression() const {
+		std::vector<std::string> texts;
+		texts.reserve(m_tree.size());
+		for (const ast_node& node : m_tree) {
+			std::string_view symbol = operator_lookup(node.op).symbol;
+			if (node.op == opcode::push_number) {
+				texts.emplace_back(m_literals[node.index]);
+			}
+			else if (node.op == opcode::push_variable) {
+				texts.emplace_back(m_variables[node.index]);
+			}
+			else if (node.op == opcode::posite || node.op == opcode::negate) {
+				texts.push_back((node.op == opcode::posite ? "(+" : "(-") + texts[node.left] + ")");
+			}
+			else if (node.op == opcode::factorial) {
+				texts.push_back("(" + texts[node.left] + "!)");
+			}
+			else if (node.right == NO_INDEX) {
+				texts.push_back(std::string(symbol) + "(" + texts[node.left] + ")");
+			}
+			else if (operator_lookup(node.op).priority == PRIORITY_FUNCTION) {
+				texts.push_back(std::string(symbol) + "(" + texts[node.left] + ", " + texts[node.right] + ")");
+			}
+			else {
+				texts.push_back("(" + texts[node.left] + " " + std::string(symbol) + " " + texts[node.right] + ")");
+			}
+		}
+		return texts.back();
+	}
+
+	// 字节码的后缀形式（便于调试）
+	std::string expression::postfix_expression() const {
+		std::string str;
+		for (const auto& ins : m_program) {
+			switch (ins.op) {
+			case opcode::push_number:
+				str += std::to_string(ins.value);
+				break;
+			case opcode::push_variable:
+				str += m_variables[ins.slot];
+				break;
+			case opcode::load_temp:
+				str += "t" + std::to_string(ins.slot);
+				break;
+			case opcode::store_temp:
+				str += "=t" + std::to_string(ins.slot);
+				break;
+			default:
+				str += operator_lookup(ins.op).symbol;
+				break;
+			}
+			str += ' ';
+		}
+		return str;
+	}
+
+	// 按名字查找变量槽位（在求值循环外调用一次，之后按槽位写入 bindings）
+	size_t expression::variable_slot(std::string_view name) const {
+		auto it = std::find(m_variables.begin(), m_variables.end(), name);
+		if (it == m_variables.end()) {
+			throw std::runtime_error("表达式中不存在变量：" + std::string(name));
+		}
+		return it - m_variables.begin();
+	}
+
+	// 使用变量绑定执行字节码：深度不超过 EVALUATION_STACK_SIZE 时使用栈上数组
+	double expression::evaluate(const bindings& values) const {
+		return evaluate(std::span<const double>(values.data(), values.size()));
+	}
+
+	double expression::evaluate(std::span<const double> values) const {
+		return evaluate_program<false>(*this, values, nullptr);
+	}
+
+	double expression::evaluate(std::span<const double> values, call_memo& memo) const {
+		return evaluate_program<true>(*this, values, &memo);
+	}
+}
@@ -1,248 +1,642 @@
-#ifndef CALCULATOR_HPP
-#define CALCULATOR_HPP
-
-#include <iostream>
-#include <string>
-#include <regex>
-#include <vector>
-#include <stack>
-#include <algorithm>
-#include <unordered_map>
-#include <cmath>
-#include <stdexcept>
-#include <functional>
-#include <sstream>
-#include <variant>
-#include <optional>
-
-namespace chr {
-
-	using byte = unsigned char;
-
-	// token ö٣λ/𣬵λھ
-	enum class token_t : byte {
-		invalid_token = 0x00,
-		number_token = 0x10,   // ׼
-		constant_number,       //  (PI, E, PHI)
-		binary_number,         //  0b...
-		octal_number,          // ˽ 0o...
-		hexadecimal_number,    // ʮ 0x...
-		decimal_number,        // ʮƣѧ
-		operator_token = 0x20, // ׼
-		signal_operator,       // һԪ +/-
-		normal_operator,       // Ԫͨ
-		function_operator      // sin, cos ȣ
-	};
-
-	// λ㣬жжǷΪ
-	byte operator&(token_t a, token_t b) noexcept;
-	token_t token_type(const std::string& str) noexcept;
-
-	// ж token_type
-	inline bool is_operator(const std::string& str) noexcept {
-		return token_t::operator_token & token_type(str);
-	}
-	inline bool is_function(const std::string& str) noexcept {
-		return token_t::function_operator == token_type(str);
-	}
-	inline bool is_constant(const std::string& str) noexcept {
-		return token_t::constant_number == token_type(str);
-	}
-	inline bool is_number(const std::string& str) noexcept {
-		return token_t::number_token & token_type(str);
-	}
-
-	// ִʽзΪ token ַ﷨
-	class expression_tokenizer {
-	private:
-		std::vector<std::string> m_tokens; // зֳ token бַʽ
-		std::vector<std::pair<std::string, std::string>> m_errors; // бλ/
-	private:
-		void parse_signal_operators();    // һԪ + / -תΪ pos/neg
-		void parse_parenthese();          // 
-		void parse_operator_sequence();   // кϷ
-		void parse_number_format();       // ʽơѧ
-		void parse_function_usage();      // 麯Ƿ '('
-		void add_error(const std::string& position, const std::string& description);
-	public:
-		bool tokenize(const std::string& expression); // ִʲ޷ʶַ
-		bool validate(const std::string& expression); // ֤öֽ
-		const std::vector<std::string>& tokens() const { return m_tokens; }
-		const std::vector<std::pair<std::string, std::string>>& errors() const { return m_errors; }
-		std::string detailed_analysis() const; // ϸ token Ϣ쳣Ϣ
-	};
-
-	// 
-	constexpr double CONSTANT_E = 2.718281828459;
-	constexpr double CONSTANT_PI = 3.1415926535898;
-	constexpr double CONSTANT_PHI = 0.61803398875;
-
-	// ȼȼΪߣ
-	constexpr byte PRIORITY_FUNCTION = 0xFF;
-
-	// token ݳֻͣ
-	struct number_data {
-		double value;
-		number_data(double val = 0.0) :value(val) {}
-	};
-	struct operator_data {
-		std::string symbol; // ı "+", "sin"
-		byte operand_num;   // 1  2
-		byte priority;      // ȼ׺ת׺ / 㣩
-		std::function<double(double, double)> apply; // ִк
-
-		operator_data(const std::string& sym = "", byte op_num = 0, byte pri = 0,
-			std::function<double(double, double)>func = nullptr)
-			: symbol(sym), operand_num(op_num), priority(pri), apply(std::move(func)) {}
-	};
-
-	// token ࣺװֻṩ빤
-	class token {
-		token_t m_type;
-		std::variant<number_data, operator_data> m_data;
-	public:
-		token() :m_type(token_t::invalid_token), m_data() {}
-		token(double val) :m_type(token_t::number_token), m_data(number_data{ val }) {}
-		token(const std::string& sym, byte op_num, byte pri,
-			std::function<double(double, double)>func)
-			:m_type(token_t::operator_token), m_data(operator_data{ sym,op_num,pri,std::move(func) }) {}
-		token_t type() const { return m_type; }
-		bool is_number() const { return m_type == token_t::number_token; }
-		bool is_operator() const { return m_type == token_t::operator_token; }
-		bool is_valid() const { return m_type != token_t::invalid_token; }
-		double number_value() const {
-			return std::get<number_data>(m_data).value;
-		}
-		const std::string& operator_symbol() const {
-			return std::get<operator_data>(m_data).symbol;
-		}
-		byte operator_operand_num() const {
-			return std::get<operator_data>(m_data).operand_num;
-		}
-		byte operator_prioriry() const {
-			return std::get<operator_data>(m_data).priority;
-		}
-		double apply_operator(double a, double b) const {
-			return std::get<operator_data>(m_data).apply(a, b);
-		}
-		template <typename Visitor>
-		auto visit(Visitor&& vis) -> decltype(auto) {
-			return std::visit(std::forward<Visitor>(vis), m_data);
-		}
-	public:
-		// ͵ token / ֲ / 
-		static token from_number(double val) {
-			return token(val);
-		}
-		static token add() {
-			return token("+", 2, 1, [](double a, double b) {return a + b; });
-		}
-		static token minus() {
-			return token("-", 2, 1, [](double a, double b) {return a - b; });
-		}
-		static token modulo() {
-			return token("%", 2, 2, [](double a, double b) { return fmodl(a, b); });
-		}
-		static token multiply() {
-			return token("*", 2, 3, [](double a, double b) {return a * b; });
-		}
-		static token divide() {
-			return token("/", 2, 3, [](double a, double b) {return a / b; });
-		}
-		static token posite() {
-			return token("pos", 1, 4, [](double a, double b) {return a; });
-		}
-		static token negate() {
-			return token("neg", 1, 4, [](double a, double b) {return -a; });
-		}
-		static token exponent() {
-			return token("^", 2, 5, [](double a, double b) {return pow(a, b); });
-		}
-		static token left_parentheses() {
-			return token("(", 0, 0, [](double a, double b) {return 0; });
-		}
-		static token right_parentheses() {
-			return token(")", 0, 0, [](double a, double b) {return 0; });
-		}
-		static token factorial() {
-			// ʹ tgamma(n+1) ʵֽ׳ˣݷ
-			return token("!", 1, 6, [](double a, double b) {return tgamma(a + 1); });
-		}
-		// һѧȼΪ PRIORITY_FUNCTIONΪȼһԪ
-		static token sine() {
-			return token("sin", 1, PRIORITY_FUNCTION, [](double a, double b) {return sin(a); });
-		}
-		static token cosine() {
-			return token("cos", 1, PRIORITY_FUNCTION, [](double a, double b) {return cos(a); });
-		}
-		static token tangent() {
-			return token("tan", 1, PRIORITY_FUNCTION, [](double a, double b) {return tan(a); });
-		}
-		static token cotangent() {
-			return token("cot", 1, PRIORITY_FUNCTION, [](double a, double b) {return 1 / tan(a); });
-		}
-		static token secant() {
-			return token("sec", 1, PRIORITY_FUNCTION, [](double a, double b) {return 1 / cos(a); });
-		}
-		static token cosecant() {
-			return token("csc", 1, PRIORITY_FUNCTION, [](double a, double b) {return 1 / sin(a); });
-		}
-		static token arcsine() {
-			return token("arcsin", 1, PRIORITY_FUNCTION, [](double a, double b) {return asin(a); });
-		}
-		static token arccosine() {
-			return token("arccos", 1, PRIORITY_FUNCTION, [](double a, double b) {return acos(a); });
-		}
-		static token arctangent() {
-			return token("arctan", 1, PRIORITY_FUNCTION, [](double a, double b) {return atan(a); });
-		}
-		static token arccotangent() {
-			return token("arccot", 1, PRIORITY_FUNCTION, [](double a, double b) {return atan(1 / a); });
-		}
-		static token arcsecant() {
-			return token("arcsec", 1, PRIORITY_FUNCTION, [](double a, double b) {return acos(1 / a); });
-		}
-		static token arccosecant() {
-			return token("arccsc", 1, PRIORITY_FUNCTION, [](double a, double b) {return asin(1 / a); });
-		}
-		static token common_logarithm() {
-			return token("lg", 1, PRIORITY_FUNCTION, [](double a, double b) {return log10(a); });
-		}
-		static token natural_logarithm() {
-			return token("ln", 1, PRIORITY_FUNCTION, [](double a, double b) {return log(a); });
-		}
-		static token square_root() {
-			return token("sqrt", 1, PRIORITY_FUNCTION, [](double a, double b) {return sqrt(a); });
-		}
-		static token cubic_root() {
-			return token("cbrt", 1, PRIORITY_FUNCTION, [](double a, double b) {return cbrt(a); });
-		}
-		// Ƕ/תע⣺degree / rad ÷ΪһԪ
-		static token degree() {
-			return token("deg", 1, PRIORITY_FUNCTION, [](double a, double b) {return a / CONSTANT_PI * 180; });
-		}
-		static token radian() {
-			return token("rad", 1, PRIORITY_FUNCTION, [](double a, double b) {return a / 180 * CONSTANT_PI; });
-		}
-		static token from_string(const std::string& str);
-	private:
-		// ԽַΪֻ
-		static std::optional<double> try_parse_number(const std::string& str);
-		static std::optional<token> try_parse_operator(const std::string& str);
-	};
-	// ʽࣺ׺׺ʾṩӿ
-	class expression {
-		std::vector<token> m_infix;
-		std::vector<token> m_postfix;
-	private:
-		void calculate(std::stack<token>& operands, const token& op) const;
-	public:
-		expression(const std::string& infix_expression);
-		std::string infix_expression() const;
-		std::string postfix_expression() const;
-		double evaluate_from_postfix() const;
-		double evaluate_from_infix() const;
-	};
-}
-
+#ifndef CALCULATOR_HPP
+#define CALCULATOR_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stack>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <optional>
+#include <cstdint>
+#include <span>
+#include <cstring>
+#include <memory_resource>
+
+namespace chr {
+
+	using byte = unsigned char;
+
+	// token 类型枚举：高位用于区分数字/操作符类别，低位用于具体种类
+	enum class token_t : byte {
+		invalid_token = 0x00,
+		number_token = 0x10,   // 数字类别基准
+		constant_number,       // 常数 (PI, E, PHI)
+		binary_number,         // 二进制字面量 0b...
+		octal_number,          // 八进制字面量 0o...
+		hexadecimal_number,    // 十六进制字面量 0x...
+		decimal_number,        // 十进制（含科学计数法）
+		operator_token = 0x20, // 操作符类别基准
+		signal_operator,       // 一元符号 +/-
+		normal_operator,       // 二元等普通运算符
+		function_operator,     // 函数（sin, cos 等）
+		variable_token = 0x40  // 变量（x, rate 等标识符）
+	};
+
+	// 字节码操作码：push_* 携带内联立即数，其余每个运算符/函数各占一个操作码
+	enum class opcode : byte {
+		push_number,       // 压入常数（立即数为数值）
+		push_variable,     // 压入变量（立即数为槽位）
+		load_temp,         // 压入公共子表达式缓存（立即数为缓存槽位）
+		store_temp,        // 把栈顶写入缓存槽位，不出栈
+		add, subtract, modulo, multiply, divide,
+		posite, negate, exponent, factorial,
+		sine, cosine, tangent, cotangent, secant, cosecant,
+		arcsine, arccosine, arctangent, arccotangent, arcsecant, arccosecant,
+		common_logarithm, natural_logarithm, square_root, cubic_root, degree, radian,
+		minimum, maximum, hypotenuse, // 多参数函数两两折叠后使用的二元操作码
+		left_parenthesis,  // 括弧与逗号只出现在分词结果中，不会被编译为指令
+		right_parenthesis,
+		comma
+	};
+
+	// 字节码指令：定长 16 字节，操作码 + 内联立即数（常数值或变量槽位）
+	struct instruction {
+		opcode op;
+		std::uint32_t slot; // push_variable 的变量槽位 / load_temp、store_temp 的缓存槽位
+		double value;       // push_number 的常数值
+	};
+
+	// 语法树中表示"无"的下标（无子节点、常数没有字面量原文）
+	constexpr std::uint32_t NO_INDEX = UINT32_MAX;
+
+	// 语法树节点：整棵树按后序存放在数组中，子节点的下标总小于父节点，最后一个节点为根
+	// 数字节点的 index 为字面量编号（常量折叠产生的常数为 NO_INDEX），变量节点的 index 为变量槽位；
+	// 一元运算只有 left，二元运算为 left op right；自定义函数的实参可被函数体多处引用，因此节点可以有多个父节点
+	struct ast_node {
+		opcode op;
+		std::uint32_t index = NO_INDEX;
+		std::uint32_t left = NO_INDEX;
+		std::uint32_t right = NO_INDEX;
+		double value = 0.0; // 数字节点的数值
+	};
+
+	// 字节码解释器：stack 至少需容纳编译时计算出的最大深度，temps 至少需容纳缓存槽位数
+	double execute(const instruction* code, size_t length, const double* variables, double* stack, double* temps);
+	byte operator_arity(opcode op) noexcept;
+
+	// 按位与运算，用于判断类别（例如判断是否为数字类别或操作符类别）
+	constexpr byte operator&(token_t a, token_t b) noexcept {
+		return static_cast<byte>(a) & static_cast<byte>(b);
+	}
+	token_t token_type(std::string_view str) noexcept;
+
+	// 词法规则：均为 constexpr，运行时的分词与 static_expression 的编译期解析共用同一套规则
+	namespace lexer {
+		// 支持的常数名与函数名，标识符整词匹配后据此分类，其余标识符视为变量
+		inline constexpr const char* constant_names[] = { "PI", "E", "PHI" };
+		inline constexpr const char* function_names[] = {
+			"sin", "cos", "tan", "cot", "sec", "csc",
+			"arcsin", "arccos", "arctan", "arccot", "arcsec", "arccsc",
+			"ln", "lg", "deg", "rad", "sqrt", "cbrt",
+			"min", "max", "hypot", "sum"
+		};
+		// 多参数函数：调用时把参数两两折叠为对应的二元运算
+		struct variadic_function {
+			const char* name;
+			opcode op;
+		};
+		inline constexpr variadic_function variadic_functions[] = {
+			{ "min", opcode::minimum }, { "max", opcode::maximum }, { "hypot", opcode::hypotenuse }, { "sum", opcode::add }
+		};
+		constexpr bool is_digit(char c) {
+			return c >= '0' && c <= '9';
+		}
+		constexpr bool is_binary_digit(char c) {
+			return c == '0' || c == '1';
+		}
+		constexpr bool is_octal_digit(char c) {
+			return c >= '0' && c <= '7';
+		}
+		constexpr bool is_hexadecimal_digit(char c) {
+			return is_digit(c) || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+		}
+		constexpr bool is_identifier_start(char c) {
+			return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+		}
+		constexpr bool is_identifier_char(char c) {
+			return is_identifier_start(c) || is_digit(c);
+		}
+
+		// 进制字面量：0b/0o/0x 前缀 + 至少一位数字 + 可选的 '.' 与小数位，返回匹配长度（0 表示不匹配）
+		constexpr size_t scan_radix_number(std::string_view str, size_t pos, char prefix, bool (*digit)(char)) {
+			if (pos + 2 >= str.length() || str[pos] != '0' || str[pos + 1] != prefix || !digit(str[pos + 2])) {
+				return 0;
+			}
+			size_t end = pos + 3;
+			while (end < str.length() && digit(str[end])) {
+				end++;
+			}
+			if (end < str.length() && str[end] == '.') {
+				end++;
+				while (end < str.length() && digit(str[end])) {
+					end++;
+				}
+			}
+			return end - pos;
+		}
+
+		// 十进制字面量：(\d+\.?\d*|\.\d+)([eE][-+]?\d+)?，指数部分不完整时不吞入
+		constexpr size_t scan_decimal_number(std::string_view str, size_t pos) {
+			size_t end = pos;
+			if (end < str.length() && is_digit(str[end])) {
+				while (end < str.length() && is_digit(str[end])) {
+					end++;
+				}
+				if (end < str.length() && str[end] == '.') {
+					end++;
+				}
+			}
+			else if (end + 1 < str.length() && str[end] == '.' && is_digit(str[end + 1])) {
+				end++;
+			}
+			else {
+				return 0;
+			}
+			while (end < str.length() && is_digit(str[end])) {
+				end++;
+			}
+			if (end < str.length() && (str[end] == 'e' || str[end] == 'E')) {
+				size_t exp = end + 1;
+				if (exp < str.length() && (str[exp] == '+' || str[exp] == '-')) {
+					exp++;
+				}
+				if (exp < str.length() && is_digit(str[exp])) {
+					while (exp < str.length() && is_digit(str[exp])) {
+						exp++;
+					}
+					end = exp;
+				}
+			}
+			return end - pos;
+		}
+	}
+
+	// 在 pos 处尝试匹配一个 token，按 进制 > 十进制 > 运算符 > 标识符 的顺序，
+	// 返回匹配长度（0 表示该位置无法开始任何 token），type 输出其类型
+	constexpr size_t scan_token(std::string_view str, size_t pos, token_t& type) noexcept {
+		char c = str[pos];
+		if (c == '0') {
+			if (size_t len = lexer::scan_radix_number(str, pos, 'b', lexer::is_binary_digit)) {
+				type = token_t::binary_number;
+				return len;
+			}
+			if (size_t len = lexer::scan_radix_number(str, pos, 'o', lexer::is_octal_digit)) {
+				type = token_t::octal_number;
+				return len;
+			}
+			if (size_t len = lexer::scan_radix_number(str, pos, 'x', lexer::is_hexadecimal_digit)) {
+				type = token_t::hexadecimal_number;
+				return len;
+			}
+		}
+		if (size_t len = lexer::scan_decimal_number(str, pos)) {
+			type = token_t::decimal_number;
+			return len;
+		}
+		switch (c) {
+		case '+': case '-': case '*': case '/': case '^':
+		case '(': case ')': case '!': case '%': case ',':
+			type = token_t::normal_operator;
+			return 1;
+		default:
+			break;
+		}
+		if (!lexer::is_identifier_start(c)) {
+			return 0;
+		}
+		// 标识符整词匹配（sinx 是变量而不是 sin 后跟 x），再按名字分类
+		size_t end = pos + 1;
+		while (end < str.length() && lexer::is_identifier_char(str[end])) {
+			end++;
+		}
+		size_t len = end - pos;
+		type = token_t::variable_token;
+		for (const char* name : lexer::constant_names) {
+			if (str.compare(pos, len, name) == 0) {
+				type = token_t::constant_number;
+			}
+		}
+		for (const char* name : lexer::function_names) {
+			if (str.compare(pos, len, name) == 0) {
+				type = token_t::function_operator;
+			}
+		}
+		return len;
+	}
+	// scan_token 判断 token 边界时最多越过 token 末尾查看的字符数（如 "1e+5" 的指数部分）
+	constexpr size_t SCAN_LOOKAHEAD = 3;
+
+	// 操作数：数字、常数或变量
+	constexpr bool is_operand(token_t type) noexcept {
+		return (token_t::number_token & type) || type == token_t::variable_token;
+	}
+
+	// 辅助判定函数（基于 token_type）
+	inline bool is_operator(const std::string& str) noexcept {
+		return token_t::operator_token & token_type(str);
+	}
+	inline bool is_function(const std::string& str) noexcept {
+		return token_t::function_operator == token_type(str);
+	}
+	inline bool is_constant(const std::string& str) noexcept {
+		return token_t::constant_number == token_type(str);
+	}
+	inline bool is_number(const std::string& str) noexcept {
+		return token_t::number_token & token_type(str);
+	}
+	inline bool is_variable(const std::string& str) noexcept {
+		return token_t::variable_token == token_type(str);
+	}
+
+	// 词法单元：分词器输出的带类型 token（类型 + 文本 + 源串偏移）
+	struct lexeme {
+		token_t type;     // 分词时即确定的 token 类型，后续检查不再重新分类
+		std::string text; // token 文本（一元 +/- 会被改写为 pos/neg）
+		size_t offset;    // 在源表达式中的起始位置
+		// 在源表达式中的长度（pos/neg 在源中是一个字符）
+		size_t length() const { return type == token_t::signal_operator ? 1 : text.size(); }
+	};
+
+	// 验证错误的种类，描述文字由 diagnostic_message 给出
+	// ends_with_operator ~ consecutive_binary 的顺序与 token_check::sequence_error 的编号 1 ~ 6 一致
+	enum class diagnostic_code : byte {
+		unrecognized_character,   // 无法识别的字符或符号
+		trailing_characters,      // 表达式末尾有无法识别的字符
+		extra_right_parenthesis,  // 存在多余的右括弧
+		extra_left_parenthesis,   // 存在多余的左括弧
+		ends_with_operator,       // 表达式以运算符结尾
+		consecutive_signs,        // 表达式含有连续符号运算符
+		starts_with_factorial,    // 表达式以阶乘运算符开头
+		factorial_operand,        // 阶乘前不是操作数或右括弧
+		starts_with_binary,       // 表达式以二元运算符开头
+		consecutive_binary,       // 表达式含有连续二元运算符
+		consecutive_digits,       // 表达式含有连续数字
+		consecutive_operands,     // 表达式含有连续操作数
+		function_without_call,    // 函数名未紧跟左括弧
+	};
+
+	// 验证错误记录：错误种类与出错内容在源表达式中的范围 [begin, end)，不含字符串，记录错误不分配内存
+	// 单个 token 的错误覆盖该 token；连续数字 / 连续操作数从前一个 token 开头到后一个 token 结尾；无法识别的内容覆盖其原文
+	struct diagnostic {
+		diagnostic_code code;
+		std::uint32_t begin;
+		std::uint32_t end;
+	};
+
+	const char* diagnostic_message(diagnostic_code code) noexcept;
+	// 错误的位置文字：括弧与运算符序列错误为 token 序号，连续数字为两个 token 的文本直接相连，
+	// 连续操作数以一个空格相连，其余为源文本原文；tokens 须是对 source 分词（并改写一元符号）的结果
+	std::string diagnostic_position(const diagnostic& error, std::string_view source, std::span<const lexeme> tokens);
+	// 逐行列出各 token 的类型编号与文本，再逐行列出错误的位置与描述（行间以换行分隔，末尾无换行）
+	std::string render_diagnostics(std::string_view source, std::span<const lexeme> tokens, std::span<const diagnostic> errors);
+
+	// 单个 token 的局部语法检查结果，规则与 parse_operator_sequence / parse_number_format / parse_function_usage 相同
+	struct token_check {
+		// 运算符序列错误编号，0 表示无：1 以运算符结尾，2 连续符号运算符，3 以阶乘运算符开头，
+		// 4 阶乘前不是操作数或右括弧，5 以二元运算符开头，6 连续二元运算符
+		byte sequence_error = 0;
+		byte number_error = 0;       // 1 连续数字，2 连续操作数，0 表示无
+		bool function_error = false; // 函数名未紧跟左括弧
+		constexpr size_t count() const { return (sequence_error != 0) + (number_error != 0) + function_error; }
+	};
+
+	// 检查 tokens[index]，只依赖相邻的 token；一元 +/- 须已改写为 pos/neg
+	// Lexeme 需有 type 与 text 成员（text 为 std::string 或 std::string_view），供整串验证与增量会话共用
+	template <typename Lexeme>
+	constexpr token_check check_token(std::span<const Lexeme> tokens, size_t index) {
+		token_check result;
+		const Lexeme& lx = tokens[index];
+		const Lexeme* prev = index > 0 ? &tokens[index - 1] : nullptr;
+		bool last = index + 1 == tokens.size();
+		if (lx.type == token_t::signal_operator) {
+			if (last) {
+				result.sequence_error = 1;
+			}
+			else if (prev != nullptr && prev->type == token_t::signal_operator) {
+				result.sequence_error = 2;
+			}
+		}
+		else if (lx.text == "!") {
+			if (prev == nullptr) {
+				result.sequence_error = 3;
+			}
+			else if (!(is_operand(prev->type) || prev->text == ")")) {
+				result.sequence_error = 4;
+			}
+		}
+		else if (lx.text != "(" && lx.text != ")" && lx.type == token_t::normal_operator) {
+			if (prev == nullptr) {
+				result.sequence_error = 5;
+			}
+			else if (last) {
+				result.sequence_error = 1;
+			}
+			else if (prev->type == token_t::signal_operator) {
+				result.sequence_error = 6;
+			}
+		}
+		if (prev != nullptr) {
+			if ((token_t::number_token & lx.type) && lx.type != token_t::constant_number && (token_t::number_token & prev->type)) {
+				result.number_error = 1;
+			}
+			else if (is_operand(lx.type) && is_operand(prev->type) &&
+				(lx.type == token_t::variable_token || prev->type == token_t::variable_token)) {
+				result.number_error = 2;
+			}
+		}
+		result.function_error = lx.type == token_t::function_operator && (last || tokens[index + 1].text != "(");
+		return result;
+	}
+
+	// 分词器：将表达式切分为 token 并做基础语法检查
+	class expression_tokenizer {
+	private:
+		std::string m_source;            // 最近一次分词的源表达式，错误记录按位置引用它
+		std::vector<lexeme> m_tokens;    // 切分出的 token 列表（带类型）
+		std::vector<diagnostic> m_errors; // 错误列表，只在 detailed_analysis 时格式化
+	private:
+		void parse_signal_operators();    // 解析一元 + / -（转为 pos/neg）
+		void parse_parenthese();          // 检查括弧配对
+		void parse_operator_sequence();   // 检查运算符序列合法性
+		void parse_number_format();       // 检查数字字面量格式（连续数字）
+		void parse_function_usage();      // 检查函数名是否紧随 '('
+		void add_error(diagnostic_code code, size_t begin, size_t end);
+		void add_error(diagnostic_code code, const lexeme& token) { add_error(code, token.offset, token.offset + token.length()); }
+	public:
+		bool tokenize(const std::string& expression); // 单遍扫描分词并检测无法识别字符
+		bool validate(const std::string& expression); // 完整验证（调用多种解析）
+		const std::vector<lexeme>& tokens() const { return m_tokens; }
+		const std::string& source() const { return m_source; }
+		const std::vector<diagnostic>& errors() const { return m_errors; }
+		std::string detailed_analysis() const; // 返回详细的 token 分析与错误信息（用于异常信息），见 render_diagnostics
+	};
+
+	// 常数定义
+	constexpr double CONSTANT_E = 2.718281828459045235360;
+	constexpr double CONSTANT_PI = 3.141592653589793238463;
+	constexpr double CONSTANT_PHI = 0.618033988749894848205;
+
+	// 函数优先级常量（函数优先级设置为最高）
+	constexpr byte PRIORITY_FUNCTION = 0xFF;
+
+	// 运算符表项：操作码、符号文本、操作数个数、优先级与求值函数
+	struct operator_info {
+		opcode code;
+		const char* symbol;                // 符号文本，例如 "+", "sin"
+		byte operand_num;                  // 操作数个数（1 或 2；括弧与逗号为 0）
+		byte priority;                     // 优先级（用于中缀转后缀 / 计算）
+		double(*apply)(double a, double b); // 执行函数（一元运算忽略 b）
+	};
+
+	// 静态运算符表：按 opcode 顺序排列，可直接以操作码为下标查表
+	// push_* / load_temp / store_temp 不是运算符，符号为空且没有执行函数
+	inline constexpr operator_info operator_table[] = {
+		{ opcode::push_number, "", 0, 0, nullptr },
+		{ opcode::push_variable, "", 0, 0, nullptr },
+		{ opcode::load_temp, "", 0, 0, nullptr },
+		{ opcode::store_temp, "", 0, 0, nullptr },
+		{ opcode::add, "+", 2, 1, [](double a, double b) { return a + b; } },
+		{ opcode::subtract, "-", 2, 1, [](double a, double b) { return a - b; } },
+		{ opcode::modulo, "%", 2, 2, [](double a, double b) { return static_cast<double>(fmodl(a, b)); } },
+		{ opcode::multiply, "*", 2, 3, [](double a, double b) { return a * b; } },
+		{ opcode::divide, "/", 2, 3, [](double a, double b) { return a / b; } },
+		{ opcode::posite, "pos", 1, 4, [](double a, double) { return a; } },
+		{ opcode::negate, "neg", 1, 4, [](double a, double) { return -a; } },
+		{ opcode::exponent, "^", 2, 5, [](double a, double b) { return pow(a, b); } },
+		// 使用 tgamma(n+1) 实现阶乘（兼容非整数）
+		{ opcode::factorial, "!", 1, 6, [](double a, double) { return tgamma(a + 1); } },
+		// 一组数学函数：优先级为 PRIORITY_FUNCTION（被视为高优先级一元运算符）
+		{ opcode::sine, "sin", 1, PRIORITY_FUNCTION, [](double a, double) { return sin(a); } },
+		{ opcode::cosine, "cos", 1, PRIORITY_FUNCTION, [](double a, double) { return cos(a); } },
+		{ opcode::tangent, "tan", 1, PRIORITY_FUNCTION, [](double a, double) { return tan(a); } },
+		{ opcode::cotangent, "cot", 1, PRIORITY_FUNCTION, [](double a, double) { return 1 / tan(a); } },
+		{ opcode::secant, "sec", 1, PRIORITY_FUNCTION, [](double a, double) { return 1 / cos(a); } },
+		{ opcode::cosecant, "csc", 1, PRIORITY_FUNCTION, [](double a, double) { return 1 / sin(a); } },
+		{ opcode::arcsine, "arcsin", 1, PRIORITY_FUNCTION, [](double a, double) { return asin(a); } },
+		{ opcode::arccosine, "arccos", 1, PRIORITY_FUNCTION, [](double a, double) { return acos(a); } },
+		{ opcode::arctangent, "arctan", 1, PRIORITY_FUNCTION, [](double a, double) { return atan(a); } },
+		{ opcode::arccotangent, "arccot", 1, PRIORITY_FUNCTION, [](double a, double) { return atan(1 / a); } },
+		{ opcode::arcsecant, "arcsec", 1, PRIORITY_FUNCTION, [](double a, double) { return acos(1 / a); } },
+		{ opcode::arccosecant, "arccsc", 1, PRIORITY_FUNCTION, [](double a, double) { return asin(1 / a); } },
+		{ opcode::common_logarithm, "lg", 1, PRIORITY_FUNCTION, [](double a, double) { return log10(a); } },
+		{ opcode::natural_logarithm, "ln", 1, PRIORITY_FUNCTION, [](double a, double) { return log(a); } },
+		{ opcode::square_root, "sqrt", 1, PRIORITY_FUNCTION, [](double a, double) { return sqrt(a); } },
+		{ opcode::cubic_root, "cbrt", 1, PRIORITY_FUNCTION, [](double a, double) { return cbrt(a); } },
+		// 角度/弧度转换函数（注意：degree / rad 用法将作为一元函数处理）
+		{ opcode::degree, "deg", 1, PRIORITY_FUNCTION, [](double a, double) { return a / CONSTANT_PI * 180; } },
+		{ opcode::radian, "rad", 1, PRIORITY_FUNCTION, [](double a, double) { return a / 180 * CONSTANT_PI; } },
+		// 多参数函数 min/max/hypot 在中缀序列中展开为 ((a1 min a2) min a3)... 的二元形式，sum 展开为加法
+		{ opcode::minimum, "min", 2, PRIORITY_FUNCTION, [](double a, double b) { return fmin(a, b); } },
+		{ opcode::maximum, "max", 2, PRIORITY_FUNCTION, [](double a, double b) { return fmax(a, b); } },
+		{ opcode::hypotenuse, "hypot", 2, PRIORITY_FUNCTION, [](double a, double b) { return hypot(a, b); } },
+		{ opcode::left_parenthesis, "(", 0, 0, nullptr },
+		{ opcode::right_parenthesis, ")", 0, 0, nullptr },
+		{ opcode::comma, ",", 0, 0, nullptr },
+	};
+
+	constexpr const operator_info& operator_lookup(opcode op) noexcept {
+		return operator_table[static_cast<size_t>(op)];
+	}
+
+	// token 类：定长 16 字节、可平凡复制，构造与复制均不分配内存；访问器与工厂方法可在编译期使用
+	// 运算符的符号与执行函数不随 token 存储，按操作码查 operator_table
+	class token {
+		token_t m_type = token_t::invalid_token;
+		opcode m_code;           // 运算符操作码（数字 / 变量为 push_number / push_variable）
+		byte m_operand_num;      // 操作数个数
+		byte m_priority;         // 优先级
+		std::uint32_t m_slot;    // 变量槽位（在 expression::variables() 中的下标）
+		double m_value;          // 数字的值
+	public:
+		token() = default;
+		constexpr explicit token(double val)
+			:m_type(token_t::number_token), m_code(opcode::push_number), m_operand_num(0), m_priority(0), m_slot(0), m_value(val) {}
+		constexpr explicit token(opcode op)
+			:m_type(token_t::operator_token), m_code(op), m_operand_num(operator_lookup(op).operand_num),
+			m_priority(operator_lookup(op).priority), m_slot(0), m_value(0.0) {}
+		constexpr token_t type() const { return m_type; }
+		constexpr bool is_number() const { return m_type == token_t::number_token; }
+		constexpr bool is_operator() const { return m_type == token_t::operator_token; }
+		constexpr bool is_variable() const { return m_type == token_t::variable_token; }
+		constexpr bool is_valid() const { return m_type != token_t::invalid_token; }
+		constexpr double number_value() const {
+			return m_value;
+		}
+		constexpr size_t variable_slot() const {
+			return m_slot;
+		}
+		constexpr opcode operator_code() const {
+			return m_code;
+		}
+		constexpr std::string_view operator_symbol() const {
+			return operator_lookup(m_code).symbol;
+		}
+		constexpr byte operator_operand_num() const {
+			return m_operand_num;
+		}
+		constexpr byte operator_prioriry() const {
+			return m_priority;
+		}
+		double apply_operator(double a, double b) const {
+			return operator_lookup(m_code).apply(a, b);
+		}
+	public:
+		// 工厂方法：构造各种类型的 token（数字 / 各种操作符 / 函数）
+		static constexpr token from_number(double val) {
+			return token(val);
+		}
+		static constexpr token from_variable(size_t slot) {
+			token tk(opcode::push_variable);
+			tk.m_type = token_t::variable_token;
+			tk.m_slot = static_cast<std::uint32_t>(slot);
+			return tk;
+		}
+		static constexpr token add() { return token(opcode::add); }
+		static constexpr token minus() { return token(opcode::subtract); }
+		static constexpr token modulo() { return token(opcode::modulo); }
+		static constexpr token multiply() { return token(opcode::multiply); }
+		static constexpr token divide() { return token(opcode::divide); }
+		static constexpr token posite() { return token(opcode::posite); }
+		static constexpr token negate() { return token(opcode::negate); }
+		static constexpr token exponent() { return token(opcode::exponent); }
+		static constexpr token left_parentheses() { return token(opcode::left_parenthesis); }
+		static constexpr token right_parentheses() { return token(opcode::right_parenthesis); }
+		static constexpr token factorial() { return token(opcode::factorial); }
+		static constexpr token sine() { return token(opcode::sine); }
+		static constexpr token cosine() { return token(opcode::cosine); }
+		static constexpr token tangent() { return token(opcode::tangent); }
+		static constexpr token cotangent() { return token(opcode::cotangent); }
+		static constexpr token secant() { return token(opcode::secant); }
+		static constexpr token cosecant() { return token(opcode::cosecant); }
+		static constexpr token arcsine() { return token(opcode::arcsine); }
+		static constexpr token arccosine() { return token(opcode::arccosine); }
+		static constexpr token arctangent() { return token(opcode::arctangent); }
+		static constexpr token arccotangent() { return token(opcode::arccotangent); }
+		static constexpr token arcsecant() { return token(opcode::arcsecant); }
+		static constexpr token arccosecant() { return token(opcode::arccosecant); }
+		static constexpr token common_logarithm() { return token(opcode::common_logarithm); }
+		static constexpr token natural_logarithm() { return token(opcode::natural_logarithm); }
+		static constexpr token square_root() { return token(opcode::square_root); }
+		static constexpr token cubic_root() { return token(opcode::cubic_root); }
+		static constexpr token degree() { return token(opcode::degree); }
+		static constexpr token radian() { return token(opcode::radian); }
+		static constexpr token minimum() { return token(opcode::minimum); }
+		static constexpr token maximum() { return token(opcode::maximum); }
+		static constexpr token hypotenuse() { return token(opcode::hypotenuse); }
+		static constexpr token comma() { return token(opcode::comma); }
+		static token from_string(const std::string& str);
+		static token from_lexeme(const lexeme& lx);
+		// 由分词时确定的类型与源文本构造
+		static token from_lexeme(std::string_view text, token_t type);
+		// 将操作符字符串映射为 token（在静态运算符表中按符号查找）
+		static constexpr std::optional<token> try_parse_operator(std::string_view str) {
+			for (const auto& info : operator_table) {
+				if (info.symbol[0] != '\0' && str == info.symbol) {
+					return token(info.code);
+				}
+			}
+			return std::nullopt;
+		}
+	private:
+		// 尝试将字符串解释为数字（数字按分词时确定的类型解析）
+		static std::optional<double> try_parse_number(std::string_view str, token_t type);
+	};
+	static_assert(sizeof(token) == 16 && std::is_trivially_copyable_v<token>);
+
+	// 求值栈的固定容量：字节码所需深度不超过此值时直接使用栈上数组，求值过程不分配内存
+	constexpr size_t EVALUATION_STACK_SIZE = 64;
+
+	// 用户自定义函数库（见 function_library.hpp）
+	class function_library;
+	// 纯函数调用记忆表（见 call_memo.hpp）
+	class call_memo;
+
+	// 自动微分时变量数不超过此值用前向模式，否则用反向模式
+	constexpr size_t FORWARD_MODE_VARIABLES = 3;
+
+	// 变量绑定：按槽位保存变量值，槽位由 expression::variable_slot 在求值前解析一次
+	class bindings {
+		std::vector<double> m_values;
+	public:
+		bindings() = default;
+		explicit bindings(size_t count, double value = 0.0) :m_values(count, value) {}
+		bindings(std::initializer_list<double> values) :m_values(values) {}
+		double& operator[](size_t slot) { return m_values[slot]; }
+		double operator[](size_t slot) const { return m_values[slot]; }
+		size_t size() const { return m_values.size(); }
+		const double* data() const { return m_values.data(); }
+	};
+
+	// 语法树优化统计：常量折叠与恒等式化简各消去了多少运算
+	struct optimization_report {
+		size_t nodes_before = 0;          // 优化前语法树节点数
+		size_t nodes_after = 0;           // 优化后语法树节点数
+		size_t folded_operations = 0;     // 折叠为常数的运算个数
+		size_t simplified_identities = 0; // 按恒等式消去的运算个数（x*1、x+0、neg(neg(x)) 等）
+		size_t dag_nodes = 0;             // 公共子表达式归并后的 DAG 节点数（归并前即 nodes_after）
+		size_t cached_nodes = 0;          // 需要缓存复用的 DAG 节点数
+	};
+
+	// 表达式类：保存语法树与字节码，提供计算接口
+	// 构造时一次性完成分词与验证，再单遍按优先级爬升建立语法树，之后各后端都从语法树或其编译出的字节码生成，
+	// 求值时不再处理运算符优先级；可用不同的变量绑定反复求值
+	// 所有容器（含构造期间的临时容器）都从构造时给定的内存资源分配
+	class expression {
+		std::pmr::vector<ast_node> m_tree;              // 未经优化的语法树，数字保留字面量编号
+		std::pmr::vector<instruction> m_program;        // 由优化后的语法树编译出的字节码
+		std::pmr::vector<std::pmr::string> m_variables; // 变量名，按首次出现顺序分配槽位
+		std::pmr::vector<std::pmr::string> m_literals;  // 数字字面量原文，按出现顺序编号
+		size_t m_max_depth = 0;               // 字节码执行所需的最大栈深度
+		size_t m_temp_count = 0;              // 公共子表达式缓存槽位数
+		optimization_report m_optimization;   // 后缀优化统计
+	private:
+		// functions 为空时只识别内置函数
+		expression(std::string_view infix_expression, const function_library* functions, std::pmr::memory_resource* arena);
+		void scan(std::string_view infix_expression, const function_library* functions);
+		std::pmr::vector<ast_node> optimize();
+		void compile(const std::pmr::vector<ast_node>& tree);
+	public:
+		expression(const std::string& infix_expression);
+		// 在调用方提供的内存资源中完成整个解析：token 以 string_view 指向源串，不复制文本
+		// 传入 std::pmr::monotonic_buffer_resource 时构造过程只有常数次上游分配；表达式不能比该资源活得更久
+		// 表达式非法时另行用 expression_tokenizer 生成错误信息，这部分不走 arena
+		expression(std::string_view infix_expression, std::pmr::memory_resource* arena);
+		// 可调用 functions 中的自定义函数：调用处直接展开为函数体，参数代入后与调用方一起编译为一个程序
+		expression(std::string_view infix_expression, const function_library& functions,
+			std::pmr::memory_resource* arena = std::pmr::get_default_resource());
+		// 按语法树输出的完全加括弧中缀形式
+		std::string infix_expression() const;
+		// 字节码的后缀形式，写入与读取公共子表达式缓存分别记为 =tk 与 tk
+		std::string postfix_expression() const;
+		const std::pmr::vector<std::pmr::string>& variables() const { return m_variables; }
+		const std::pmr::vector<ast_node>& tree() const { return m_tree; }
+		// 语法树中数字节点的字面量原文
+		std::string_view literal_text(const ast_node& node) const { return m_literals[node.index]; }
+		const std::pmr::vector<instruction>& program() const { return m_program; }
+		const optimization_report& optimization() const { return m_optimization; }
+		size_t max_depth() const { return m_max_depth; }
+		size_t temp_count() const { return m_temp_count; }
+		size_t variable_slot(std::string_view name) const;
+		double evaluate(const bindings& values) const;
+		double evaluate(std::span<const double> values) const;
+		// 代价高的纯函数调用（is_memoizable）先查 memo，参数重复时省去库函数调用；结果与不带 memo 时逐位相同
+		double evaluate(std::span<const double> values, call_memo& memo) const;
+		// 批量求值：columns[slot] 为第 slot 个变量的整列输入，按行写入 output（实现见 batch.cpp）
+		void evaluate_batch(std::span<const std::span<const double>> columns, std::span<double> output) const;
+		void evaluate_batch(std::span<const std::span<const double>> columns, std::span<double> output, call_memo& memo) const;
+		// 自动微分（实现见 derivative.cpp）：返回函数值，并把对各变量的偏导数按槽位写入 gradient
+		// 前向模式一遍执行携带全部变量的导数，代价随变量数线性增长；反向模式记录运算带后反向传播一次，代价与变量数无关
+		double gradient_forward(std::span<const double> values, std::span<double> gradient) const;
+		double gradient_reverse(std::span<const double> values, std::span<double> gradient) const;
+		// 按变量数在前向与反向模式之间自动选择
+		double gradient(std::span<const double> values, std::span<double> gradient) const;
+	};
+}
+
 #endif // CALCULATOR_HPP
\ No newline at end of file
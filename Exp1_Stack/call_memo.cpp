@@ -0,0 +1,50 @@
+#include "call_memo.hpp"
+
+namespace chr {
+	call_memo::call_memo(size_t capacity) {
+		capacity = std::bit_ceil(std::max<size_t>(capacity, MAX_PROBES));
+		m_entries.resize(capacity);
+		m_mask = capacity - 1;
+		m_statistics.capacity = capacity;
+	}
+
+	// 未命中：写入探测窗口内的第一个空槽位，窗口已满时覆盖起始槽位
+	double call_memo::insert(size_t home, opcode op, std::uint64_t a, std::uint64_t b, double result) {
+		m_statistics.misses++;
+		entry* target = &m_entries[home & m_mask];
+		for (size_t i = 0; i < MAX_PROBES; i++) {
+			entry& slot = m_entries[(home + i) & m_mask];
+			if (slot.op == opcode::push_number) {
+				target = &slot;
+				break;
+			}
+		}
+		if (target->op == opcode::push_number) {
+			m_statistics.entries++;
+		}
+		else {
+			m_statistics.evictions++;
+		}
+		*target = { a, b, result, op };
+		return result;
+	}
+
+	// 采样窗口结束：命中率低于一半时暂停查表（触发结算的这次查表计入下一个窗口）
+	void call_memo::end_window(sampler& state) {
+		if (state.hits < SAMPLE_WINDOW / 2) {
+			state.bypass = BYPASS_CALLS;
+		}
+		state.remaining = SAMPLE_WINDOW;
+		state.hits = 0;
+	}
+
+	void call_memo::clear() {
+		std::fill(m_entries.begin(), m_entries.end(), entry{});
+		std::fill(std::begin(m_samplers), std::end(m_samplers), sampler{});
+		m_statistics.entries = 0;
+	}
+
+	void call_memo::reset_statistics() {
+		m_statistics.hits = m_statistics.misses = m_statistics.evictions = m_statistics.bypassed = 0;
+	}
+}
@@ -0,0 +1,119 @@
+#ifndef CALL_MEMO_HPP
+#define CALL_MEMO_HPP
+
+#include "calculator.hpp"
+#include <bit>
+
+namespace chr {
+
+	// 纯且代价高的运算：结果只取决于操作数，且一次库函数调用明显慢于一次哈希探测
+	// sqrt 有对应的硬件指令，min/max/deg/rad 只是一两条算术指令，都不值得查表
+	constexpr bool is_memoizable(opcode op) noexcept {
+		switch (op) {
+		case opcode::modulo: case opcode::exponent: case opcode::factorial:
+		case opcode::sine: case opcode::cosine: case opcode::tangent:
+		case opcode::cotangent: case opcode::secant: case opcode::cosecant:
+		case opcode::arcsine: case opcode::arccosine: case opcode::arctangent:
+		case opcode::arccotangent: case opcode::arcsecant: case opcode::arccosecant:
+		case opcode::common_logarithm: case opcode::natural_logarithm:
+		case opcode::cubic_root: case opcode::hypotenuse:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// 记忆表统计
+	struct call_memo_statistics {
+		uint64_t hits = 0;      // 命中次数（省去一次库函数调用）
+		uint64_t misses = 0;    // 未命中次数（调用库函数并写入表中）
+		uint64_t evictions = 0; // 探测窗口已满、覆盖旧条目的次数
+		uint64_t bypassed = 0;  // 因该操作码近期命中率过低而直接调用、不查表的次数
+		size_t entries = 0;     // 当前条目数
+		size_t capacity = 0;    // 槽位总数
+		double hit_rate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses); }
+	};
+
+	// 纯函数调用记忆表：以 (操作码, 两个操作数的位模式) 为键的开放寻址哈希表，线性探测至多 MAX_PROBES 个槽位
+	// 批量求值时许多行以相同参数调用 tgamma / pow / 反三角函数等，命中时一次探测即可代替一次库函数调用
+	// 键按位比较，因此 0.0 与 -0.0、不同的 NaN 各自独立缓存，命中结果与直接调用逐位相同
+	// 未命中比直接调用多付出一次探测与写入，因此按操作码统计最近 SAMPLE_WINDOW 次查表的命中率，
+	// 低于一半时该操作码在之后 BYPASS_CALLS 次调用中不再查表，之后重新采样；参数几乎不重复时开销接近直接调用
+	// 每个求值上下文（线程）各用一张表，本身不加锁
+	class call_memo {
+		struct entry {
+			std::uint64_t a = 0;
+			std::uint64_t b = 0;
+			double result = 0.0;
+			opcode op = opcode::push_number; // push_number 表示空槽位
+		};
+		// 单个操作码的采样状态
+		struct sampler {
+			std::uint32_t remaining = SAMPLE_WINDOW; // 本采样窗口剩余的查表次数
+			std::uint32_t hits = 0;                  // 本采样窗口内的命中次数
+			std::uint32_t bypass = 0;                // 剩余的不查表调用次数
+		};
+		static constexpr size_t MAX_PROBES = 4;
+		static constexpr std::uint32_t SAMPLE_WINDOW = 256;
+		static constexpr std::uint32_t BYPASS_CALLS = 256 * SAMPLE_WINDOW;
+
+		std::vector<entry> m_entries;
+		size_t m_mask;
+		sampler m_samplers[std::size(operator_table)];
+		call_memo_statistics m_statistics;
+	private:
+		static size_t hash(opcode op, std::uint64_t a, std::uint64_t b) noexcept {
+			std::uint64_t h = a * 0x9E3779B97F4A7C15ull ^ (b + static_cast<std::uint64_t>(op)) * 0xC2B2AE3D27D4EB4Full;
+			h ^= h >> 29;
+			h *= 0xBF58476D1CE4E5B9ull;
+			return static_cast<size_t>(h ^ (h >> 32));
+		}
+		double insert(size_t home, opcode op, std::uint64_t a, std::uint64_t b, double result);
+		void end_window(sampler& state);
+	public:
+		// 槽位数向上取整为 2 的幂
+		explicit call_memo(size_t capacity = 4096);
+
+		// 返回 operator_lookup(op).apply(a, b)；op 须满足 is_memoizable，一元运算的 b 应传 0
+		double apply(opcode op, double a, double b) {
+			sampler& state = m_samplers[static_cast<size_t>(op)];
+			if (state.bypass != 0) {
+				state.bypass--;
+				m_statistics.bypassed++;
+				return operator_lookup(op).apply(a, b);
+			}
+			if (--state.remaining == 0) {
+				end_window(state);
+			}
+			std::uint64_t a_bits = std::bit_cast<std::uint64_t>(a), b_bits = std::bit_cast<std::uint64_t>(b);
+			size_t home = hash(op, a_bits, b_bits);
+			for (size_t i = 0; i < MAX_PROBES; i++) {
+				const entry& slot = m_entries[(home + i) & m_mask];
+				if (slot.op == op && slot.a == a_bits && slot.b == b_bits) {
+					m_statistics.hits++;
+					state.hits++;
+					return slot.result;
+				}
+				if (slot.op == opcode::push_number) {
+					break;
+				}
+			}
+			return insert(home, op, a_bits, b_bits, operator_lookup(op).apply(a, b));
+		}
+
+		// 批量求值用：接下来的 limit 次 op 调用中可以不查表直接计算的次数（已计入 bypassed），为 0 时应逐个调用 apply
+		size_t bypass(opcode op, size_t limit) {
+			sampler& state = m_samplers[static_cast<size_t>(op)];
+			size_t count = std::min<size_t>(state.bypass, limit);
+			state.bypass -= static_cast<std::uint32_t>(count);
+			m_statistics.bypassed += count;
+			return count;
+		}
+
+		void clear();
+		void reset_statistics();
+		const call_memo_statistics& statistics() const { return m_statistics; }
+	};
+}
+
+#endif // CALL_MEMO_HPP
@@ -0,0 +1,252 @@
+#include "calculator.hpp"
+
+namespace chr {
+	namespace {
+		// 反向模式中常数没有对应的节点
+		constexpr std::uint32_t NO_NODE = UINT32_MAX;
+
+		// 运算带上的一次运算：结果对左右操作数的偏导数（一元运算只用左边）与反向传播时累加的伴随值
+		struct tape_entry {
+			std::uint32_t left;
+			std::uint32_t right;
+			double d_left;
+			double d_right;
+			double adjoint;
+		};
+
+		// 反向模式的求值栈元素：值与其所在的运算带节点
+		struct tape_slot {
+			double value;
+			std::uint32_t node;
+		};
+
+		// 前向模式栈上缓冲区的容量（double 个数），超出时退回堆内存
+		constexpr size_t FORWARD_INLINE_SIZE = EVALUATION_STACK_SIZE * 8;
+
+		// 双伽马函数 ψ(x) = Γ'(x)/Γ(x)：先用递推 ψ(x) = ψ(x+1) - 1/x 把 x 移到 6 以上，再用渐近展开
+		double digamma(double x) {
+			if (x <= 0 && x == floor(x)) {
+				return NAN;
+			}
+			if (x < 0) {
+				// 反射公式：ψ(x) = ψ(1-x) - π·cot(πx)
+				return digamma(1 - x) - CONSTANT_PI / tan(CONSTANT_PI * x);
+			}
+			double result = 0;
+			while (x < 6) {
+				result -= 1 / x;
+				x += 1;
+			}
+			double f = 1 / (x * x);
+			return result + log(x) - 0.5 / x
+				- f * (1.0 / 12 - f * (1.0 / 120 - f * (1.0 / 252 - f * (1.0 / 240 - f * (1.0 / 132)))));
+		}
+
+		// 运算符的求导规则：r 为运算结果，da / db 输出结果对两个操作数的偏导数
+		// 新增运算符时必须在这里补上规则，否则求导时抛出异常
+		void operator_partials(opcode op, double a, double b, double r, double& da, double& db) {
+			db = 0;
+			switch (op) {
+			case opcode::add: da = 1; db = 1; break;
+			case opcode::subtract: da = 1; db = -1; break;
+			case opcode::multiply: da = b; db = a; break;
+			case opcode::divide: da = 1 / b; db = -a / (b * b); break;
+			// fmod(a, b) = a - trunc(a/b)·b，商在间断点之间为常数
+			case opcode::modulo: da = 1; db = -std::round((a - r) / b); break;
+			case opcode::posite: da = 1; break;
+			case opcode::negate: da = -1; break;
+			case opcode::exponent:
+				da = b == 0 ? 0 : b * pow(a, b - 1);
+				// 底数非正时对指数不可导（0 的正数次幂按右导数取 0）
+				db = a > 0 ? r * log(a) : (a == 0 && b > 0 ? 0 : NAN);
+				break;
+			// (a!)' = Γ(a+1)' = Γ(a+1)·ψ(a+1)
+			case opcode::factorial: da = r * digamma(a + 1); break;
+			case opcode::sine: da = cos(a); break;
+			case opcode::cosine: da = -sin(a); break;
+			case opcode::tangent: da = 1 + r * r; break;
+			case opcode::cotangent: da = -(1 + r * r); break;
+			case opcode::secant: da = r * tan(a); break;
+			case opcode::cosecant: da = -r / tan(a); break;
+			case opcode::arcsine: da = 1 / sqrt(1 - a * a); break;
+			case opcode::arccosine: da = -1 / sqrt(1 - a * a); break;
+			case opcode::arctangent: da = 1 / (1 + a * a); break;
+			case opcode::arccotangent: da = -1 / (1 + a * a); break;
+			case opcode::arcsecant: da = 1 / (fabs(a) * sqrt(a * a - 1)); break;
+			case opcode::arccosecant: da = -1 / (fabs(a) * sqrt(a * a - 1)); break;
+			case opcode::common_logarithm: da = 1 / (a * log(10.0)); break;
+			case opcode::natural_logarithm: da = 1 / a; break;
+			case opcode::square_root: da = 0.5 / r; break;
+			case opcode::cubic_root: da = 1 / (3 * r * r); break;
+			case opcode::degree: da = 180 / CONSTANT_PI; break;
+			case opcode::radian: da = CONSTANT_PI / 180; break;
+			// min/max 取被选中的一侧（相等时取左侧）；hypot(a, b) 的偏导数为 a/r 与 b/r
+			case opcode::minimum:
+			case opcode::maximum: da = r == a ? 1 : 0; db = 1 - da; break;
+			case opcode::hypotenuse: da = a / r; db = b / r; break;
+			default: throw std::runtime_error("运算符没有求导规则：" + std::string(operator_lookup(op).symbol));
+			}
+		}
+
+		// 链式法则的一项：操作数与变量无关（导数为 0）时不乘偏导数，避免 0·NaN 污染结果
+		inline double chain(double partial, double derivative) {
+			return derivative == 0 ? 0 : partial * derivative;
+		}
+	}
+
+	// 前向模式：每个栈元素携带值与对全部变量的导数，一遍执行同时得到整个梯度
+	double expression::gradient_forward(std::span<const double> values, std::span<double> gradient) const {
+		const size_t n = m_variables.size();
+		if (values.size() < n || gradient.size() < n) {
+			throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(n) + " 个");
+		}
+		const size_t width = n + 1; // 值 + n 个导数
+		const size_t size = (m_max_depth + m_temp_count) * width;
+		double inline_storage[FORWARD_INLINE_SIZE];
+		std::vector<double> heap_storage;
+		double* storage = inline_storage;
+		if (size > FORWARD_INLINE_SIZE) {
+			heap_storage.resize(size);
+			storage = heap_storage.data();
+		}
+		double* temps = storage + m_max_depth * width;
+		double* top = storage; // 指向下一个空位
+		for (const instruction& ins : m_program) {
+			switch (ins.op) {
+			case opcode::push_number:
+				top[0] = ins.value;
+				std::fill(top + 1, top + width, 0.0);
+				top += width;
+				break;
+			case opcode::push_variable:
+				top[0] = values[ins.slot];
+				std::fill(top + 1, top + width, 0.0);
+				top[1 + ins.slot] = 1;
+				top += width;
+				break;
+			case opcode::load_temp:
+				std::copy(temps + ins.slot * width, temps + (ins.slot + 1) * width, top);
+				top += width;
+				break;
+			case opcode::store_temp:
+				std::copy(top - width, top, temps + ins.slot * width);
+				break;
+			default: {
+				double da = 0, db = 0;
+				if (operator_arity(ins.op) == 1) {
+					double* a = top - width;
+					double r = operator_lookup(ins.op).apply(a[0], 0);
+					operator_partials(ins.op, a[0], 0, r, da, db);
+					a[0] = r;
+					for (size_t k = 1; k < width; k++) {
+						a[k] = chain(da, a[k]);
+					}
+				}
+				else {
+					top -= width;
+					double* a = top - width;
+					const double* b = top;
+					double r = operator_lookup(ins.op).apply(a[0], b[0]);
+					operator_partials(ins.op, a[0], b[0], r, da, db);
+					a[0] = r;
+					for (size_t k = 1; k < width; k++) {
+						a[k] = chain(da, a[k]) + chain(db, b[k]);
+					}
+				}
+				break;
+			}
+			}
+		}
+		std::copy(storage + 1, storage + width, gradient.begin());
+		return storage[0];
+	}
+
+	// 反向模式：正向执行字节码时把每次运算的局部偏导数记入运算带，再从结果反向累加伴随值
+	// 前 n 个节点是各变量，公共子表达式经 store_temp / load_temp 复用同一节点，伴随值自然累加
+	double expression::gradient_reverse(std::span<const double> values, std::span<double> gradient) const {
+		const size_t n = m_variables.size();
+		if (values.size() < n || gradient.size() < n) {
+			throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(n) + " 个");
+		}
+		// 运算带长度不超过变量数加指令数，预先一次分配
+		std::vector<tape_entry> tape(n + m_program.size());
+		for (size_t i = 0; i < n; i++) {
+			tape[i] = { NO_NODE, NO_NODE, 0, 0, 0 };
+		}
+		size_t length = n;
+		tape_slot inline_stack[EVALUATION_STACK_SIZE];
+		std::vector<tape_slot> heap_stack;
+		tape_slot* stack = inline_stack;
+		if (m_max_depth + m_temp_count > EVALUATION_STACK_SIZE) {
+			heap_stack.resize(m_max_depth + m_temp_count);
+			stack = heap_stack.data();
+		}
+		tape_slot* temps = stack + m_max_depth;
+		tape_slot* top = stack; // 指向下一个空位
+		for (const instruction& ins : m_program) {
+			switch (ins.op) {
+			case opcode::push_number: *top++ = { ins.value, NO_NODE }; break;
+			case opcode::push_variable: *top++ = { values[ins.slot], ins.slot }; break;
+			case opcode::load_temp: *top++ = temps[ins.slot]; break;
+			case opcode::store_temp: temps[ins.slot] = top[-1]; break;
+			default: {
+				double da = 0, db = 0, r = 0;
+				std::uint32_t left = NO_NODE, right = NO_NODE;
+				if (operator_arity(ins.op) == 1) {
+					double a = top[-1].value;
+					left = top[-1].node;
+					r = operator_lookup(ins.op).apply(a, 0);
+					if (left != NO_NODE) {
+						operator_partials(ins.op, a, 0, r, da, db);
+					}
+				}
+				else {
+					--top;
+					double a = top[-1].value, b = top[0].value;
+					left = top[-1].node;
+					right = top[0].node;
+					r = operator_lookup(ins.op).apply(a, b);
+					if (left != NO_NODE || right != NO_NODE) {
+						operator_partials(ins.op, a, b, r, da, db);
+					}
+				}
+				// 两个操作数都是常数时结果仍是常数，不进入运算带
+				if (left == NO_NODE && right == NO_NODE) {
+					top[-1] = { r, NO_NODE };
+				}
+				else {
+					top[-1] = { r, static_cast<std::uint32_t>(length) };
+					tape[length++] = { left, right, da, db, 0 };
+				}
+				break;
+			}
+			}
+		}
+		if (stack[0].node != NO_NODE) {
+			tape[stack[0].node].adjoint = 1;
+		}
+		for (size_t i = length; i-- > n;) {
+			const tape_entry& entry = tape[i];
+			if (entry.adjoint == 0) {
+				continue;
+			}
+			if (entry.left != NO_NODE) {
+				tape[entry.left].adjoint += entry.adjoint * entry.d_left;
+			}
+			if (entry.right != NO_NODE) {
+				tape[entry.right].adjoint += entry.adjoint * entry.d_right;
+			}
+		}
+		for (size_t i = 0; i < n; i++) {
+			gradient[i] = tape[i].adjoint;
+		}
+		return stack[0].value;
+	}
+
+	double expression::gradient(std::span<const double> values, std::span<double> gradient) const {
+		if (m_variables.size() <= FORWARD_MODE_VARIABLES) {
+			return gradient_forward(values, gradient);
+		}
+		return gradient_reverse(values, gradient);
+	}
+}
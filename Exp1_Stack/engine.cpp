@@ -0,0 +1,163 @@
+#include "engine.hpp"
+#include <atomic>
+#include <chrono>
+#include <random>
+
+namespace chr {
+	namespace {
+		// Chase-Lev 工作窃取双端队列（固定容量）：所有者在底部弹出，其他线程在顶部用 CAS 窃取
+		// 任务在工作线程启动前一次性压入，运行期间不再压入，因此缓冲区不需要扩容也不需要原子元素
+		class alignas(64) task_deque {
+			std::atomic<std::int64_t> m_top{ 0 };
+			std::atomic<std::int64_t> m_bottom{ 0 };
+			std::vector<size_t> m_tasks;
+		public:
+			// 只能在工作线程启动前调用
+			void push(size_t task) {
+				m_tasks.push_back(task);
+				m_bottom.store(static_cast<std::int64_t>(m_tasks.size()), std::memory_order_relaxed);
+			}
+			// 所有者取走底部任务；只剩一个任务时与窃取者竞争
+			bool pop(size_t& task) {
+				std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+				m_bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t t = m_top.load(std::memory_order_relaxed);
+				if (t > b) {
+					m_bottom.store(b + 1, std::memory_order_relaxed);
+					return false;
+				}
+				task = m_tasks[b];
+				if (t < b) {
+					return true;
+				}
+				bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				m_bottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+			// 其他线程取走顶部任务；与所有者或其他窃取者竞争失败时返回 false
+			bool steal(size_t& task) {
+				std::int64_t t = m_top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t b = m_bottom.load(std::memory_order_acquire);
+				if (t >= b) {
+					return false;
+				}
+				task = m_tasks[t];
+				return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			}
+		};
+
+		// 把异常信息写入结果，保持逐项对应
+		void record_failure(evaluation_result& result, worker_statistics& statistics, const std::exception& e) {
+			result.error = e.what();
+			statistics.failures++;
+		}
+	}
+
+	evaluation_engine::evaluation_engine(size_t threads, size_t grain)
+		:m_threads(std::max<size_t>(1, threads)), m_grain(std::max<size_t>(1, grain)) {}
+
+	template <typename Work>
+	void evaluation_engine::run(size_t count, Work&& work) {
+		const size_t task_count = (count + m_grain - 1) / m_grain;
+		const size_t threads = std::max<size_t>(1, std::min(m_threads, task_count));
+		m_statistics.assign(threads, worker_statistics{});
+		if (task_count == 0) {
+			return;
+		}
+		// 任务按连续区间均分：相邻表达式常来自同一来源，成本相近，先各自顺序处理，失衡时再窃取
+		std::vector<task_deque> deques(threads);
+		for (size_t w = 0; w < threads; w++) {
+			size_t first = task_count * w / threads, last = task_count * (w + 1) / threads;
+			// 所有者从底部取，倒序压入使其按原顺序处理
+			for (size_t task = last; task-- > first;) {
+				deques[w].push(task);
+			}
+		}
+		std::atomic<size_t> remaining{ task_count };
+
+		auto worker = [&](size_t self) {
+			worker_statistics statistics;
+			std::minstd_rand random(static_cast<unsigned>(self + 1));
+			auto execute = [&](size_t task) {
+				auto begin = std::chrono::steady_clock::now();
+				size_t first = task * m_grain, last = std::min(count, first + m_grain);
+				for (size_t index = first; index < last; index++) {
+					work(index, statistics);
+				}
+				statistics.expressions += last - first;
+				statistics.tasks++;
+				statistics.busy_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+				remaining.fetch_sub(1, std::memory_order_acq_rel);
+			};
+			size_t task = 0;
+			while (remaining.load(std::memory_order_acquire) > 0) {
+				if (deques[self].pop(task)) {
+					execute(task);
+					continue;
+				}
+				// 自己的队列已空：随机选一个起点依次尝试窃取其他线程的任务
+				bool stolen = false;
+				size_t start = random() % threads;
+				for (size_t k = 0; k < threads && !stolen; k++) {
+					size_t victim = (start + k) % threads;
+					if (victim == self) {
+						continue;
+					}
+					statistics.steal_attempts++;
+					stolen = deques[victim].steal(task);
+				}
+				if (stolen) {
+					statistics.steals++;
+					execute(task);
+				}
+				else {
+					std::this_thread::yield();
+				}
+			}
+			m_statistics[self] = statistics;
+		};
+
+		std::vector<std::thread> workers;
+		for (size_t w = 1; w < threads; w++) {
+			workers.emplace_back(worker, w);
+		}
+		worker(0);
+		for (auto& thread : workers) {
+			thread.join();
+		}
+	}
+
+	std::vector<evaluation_result> evaluation_engine::evaluate(const std::vector<std::string>& texts) {
+		std::vector<evaluation_result> results(texts.size());
+		run(texts.size(), [&](size_t index, worker_statistics& statistics) {
+			try {
+				expression expr(texts[index]);
+				results[index].value = expr.evaluate(std::span<const double>());
+			}
+			catch (const std::exception& e) {
+				record_failure(results[index], statistics, e);
+			}
+		});
+		return results;
+	}
+
+	std::vector<evaluation_result> evaluation_engine::evaluate(std::span<const std::shared_ptr<const expression>> programs,
+		std::span<const bindings> values) {
+		if (!values.empty() && values.size() != programs.size()) {
+			throw std::runtime_error("变量绑定组数与表达式数不一致");
+		}
+		std::vector<evaluation_result> results(programs.size());
+		run(programs.size(), [&](size_t index, worker_statistics& statistics) {
+			try {
+				results[index].value = values.empty() ? programs[index]->evaluate(std::span<const double>())
+					: programs[index]->evaluate(values[index]);
+			}
+			catch (const std::exception& e) {
+				record_failure(results[index], statistics, e);
+			}
+		});
+		return results;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include "calculator.hpp"
+#include <memory>
+#include <thread>
+
+namespace chr {
+
+	// 单个表达式的求值结果：成功时 error 为空
+	struct evaluation_result {
+		double value = 0.0;
+		std::string error;
+		bool ok() const { return error.empty(); }
+	};
+
+	// 单个工作线程在最近一次 evaluate 中的统计
+	struct worker_statistics {
+		size_t tasks = 0;          // 执行的任务数（每个任务是连续 grain 个表达式）
+		size_t expressions = 0;    // 求值的表达式数
+		size_t failures = 0;       // 出错的表达式数
+		size_t steals = 0;         // 从其他线程窃取到的任务数
+		size_t steal_attempts = 0; // 窃取尝试次数（含失败）
+		double busy_seconds = 0.0; // 执行任务的累计时间
+	};
+
+	// 并行求值引擎：把输入按 grain 个一组切成任务，预先均分到各线程的工作窃取双端队列；
+	// 线程先处理自己的队列（从底部取），取空后随机挑选其他线程从顶部窃取，直到全部任务完成
+	// 调用线程本身也作为 0 号工作线程参与计算
+	class evaluation_engine {
+		size_t m_threads;
+		size_t m_grain;
+		std::vector<worker_statistics> m_statistics;
+	private:
+		// 对 [0, count) 中的每个下标调用 work(index, statistics)，按工作窃取方式调度
+		template <typename Work>
+		void run(size_t count, Work&& work);
+	public:
+		explicit evaluation_engine(size_t threads = std::thread::hardware_concurrency(), size_t grain = 64);
+
+		// 解析并求值（表达式不能含变量）：第 i 个结果对应 texts[i]
+		std::vector<evaluation_result> evaluate(const std::vector<std::string>& texts);
+		// 求值已编译的表达式：values 为空时按无变量求值，否则 values[i] 是 programs[i] 的变量绑定
+		std::vector<evaluation_result> evaluate(std::span<const std::shared_ptr<const expression>> programs,
+			std::span<const bindings> values = {});
+
+		size_t threads() const { return m_threads; }
+		const std::vector<worker_statistics>& statistics() const { return m_statistics; }
+	};
+}
+
+#endif // ENGINE_HPP
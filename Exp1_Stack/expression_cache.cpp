@@ -0,0 +1,97 @@
+#include "expression_cache.hpp"
+
+namespace chr {
+	// 按 scan_token 重新分词，token 之间一律用一个空格分隔：
+	// 键相同当且仅当 token 序列相同，删去空白不会把 "1e +5" 并成 "1e+5"，也不会把 "1 2" 并成 "12"
+	std::string normalize_expression(const std::string& text) {
+		std::string key;
+		key.reserve(text.size() * 2);
+		size_t pos = 0;
+		while (pos < text.size()) {
+			if (std::isspace(static_cast<unsigned char>(text[pos]))) {
+				pos++;
+				continue;
+			}
+			token_t type = token_t::invalid_token;
+			// 无法识别的字符原样保留为单独一项，表达式仍然非法
+			size_t len = std::max<size_t>(scan_token(text, pos, type), 1);
+			if (!key.empty()) {
+				key.push_back(' ');
+			}
+			key.append(text, pos, len);
+			pos += len;
+		}
+		return key;
+	}
+
+	expression_cache::expression_cache(size_t capacity, size_t shard_count, const function_library* functions)
+		: m_shards(std::make_unique<shard[]>(shard_count == 0 ? 1 : shard_count)),
+		m_shard_count(shard_count == 0 ? 1 : shard_count),
+		m_shard_capacity(std::max<size_t>(1, (capacity + m_shard_count - 1) / m_shard_count)),
+		m_functions(functions) {}
+
+	expression_cache::shard& expression_cache::shard_for(const std::string& key) const {
+		return m_shards[std::hash<std::string>{}(key) % m_shard_count];
+	}
+
+	expression_cache::value_type expression_cache::lookup(shard& target, const std::string& key) {
+		auto found = target.index.find(key);
+		if (found == target.index.end()) {
+			return nullptr;
+		}
+		// 移到表头，标记为最近使用
+		target.entries.splice(target.entries.begin(), target.entries, found->second);
+		return found->second->second;
+	}
+
+	expression_cache::value_type expression_cache::get(const std::string& text) {
+		std::string key = normalize_expression(text);
+		shard& target = shard_for(key);
+		{
+			std::lock_guard<std::mutex> lock(target.mutex);
+			if (value_type cached = lookup(target, key)) {
+				m_hits.fetch_add(1, std::memory_order_relaxed);
+				return cached;
+			}
+		}
+
+		// 在锁外编译，避免慢速解析阻塞同一分片上的其他请求；使用原文以保留错误位置
+		m_misses.fetch_add(1, std::memory_order_relaxed);
+		value_type compiled = m_functions != nullptr ? std::make_shared<const expression>(text, *m_functions)
+			: std::make_shared<const expression>(text);
+
+		std::lock_guard<std::mutex> lock(target.mutex);
+		// 其他线程可能已抢先插入同一键，此时沿用已有对象
+		if (value_type cached = lookup(target, key)) {
+			return cached;
+		}
+		target.entries.emplace_front(key, compiled);
+		target.index.emplace(std::move(key), target.entries.begin());
+		if (target.entries.size() > m_shard_capacity) {
+			target.index.erase(target.entries.back().first);
+			target.entries.pop_back();
+			m_evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+		return compiled;
+	}
+
+	void expression_cache::clear() {
+		for (size_t i = 0; i < m_shard_count; i++) {
+			std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+			m_shards[i].index.clear();
+			m_shards[i].entries.clear();
+		}
+	}
+
+	cache_statistics expression_cache::statistics() const {
+		cache_statistics result;
+		result.hits = m_hits.load(std::memory_order_relaxed);
+		result.misses = m_misses.load(std::memory_order_relaxed);
+		result.evictions = m_evictions.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < m_shard_count; i++) {
+			std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+			result.entries += m_shards[i].entries.size();
+		}
+		return result;
+	}
+}
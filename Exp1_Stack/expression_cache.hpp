@@ -0,0 +1,59 @@
+#ifndef EXPRESSION_CACHE_HPP
+#define EXPRESSION_CACHE_HPP
+
+#include "calculator.hpp"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace chr {
+
+	// 缓存统计
+	struct cache_statistics {
+		uint64_t hits = 0;      // 命中次数
+		uint64_t misses = 0;    // 未命中（需要编译）次数
+		uint64_t evictions = 0; // 因容量不足淘汰的条目数
+		size_t entries = 0;     // 当前条目数
+	};
+
+	// 规范化表达式文本：重新分词后以单个空格连接各 token，
+	// 只有分词结果相同的文本才得到相同的键（"1 2" 与 "12"、"1e +5" 与 "1e+5" 的键不同）
+	std::string normalize_expression(const std::string& text);
+
+	// 线程安全的表达式缓存：规范化文本 -> 已编译的 expression
+	// 按键的哈希分为若干分片，每个分片各有一把锁与独立的 LRU 链表，
+	// 不同分片上的请求互不阻塞；编译在锁外进行，命中时跳过验证与中缀转后缀
+	class expression_cache {
+		using value_type = std::shared_ptr<const expression>;
+		struct shard {
+			std::mutex mutex;
+			std::list<std::pair<std::string, value_type>> entries; // 表头为最近使用
+			std::unordered_map<std::string, decltype(entries)::iterator> index;
+		};
+
+		std::unique_ptr<shard[]> m_shards;
+		size_t m_shard_count;
+		size_t m_shard_capacity; // 每个分片的容量
+		std::atomic<uint64_t> m_hits{ 0 };
+		std::atomic<uint64_t> m_misses{ 0 };
+		std::atomic<uint64_t> m_evictions{ 0 };
+		const function_library* m_functions; // 编译时可调用的自定义函数，可为空
+	private:
+		shard& shard_for(const std::string& key) const;
+		value_type lookup(shard& target, const std::string& key);
+	public:
+		// functions 中的定义改变后须调用 clear，否则已缓存的表达式仍使用旧定义
+		explicit expression_cache(size_t capacity = 1024, size_t shard_count = 16, const function_library* functions = nullptr);
+		expression_cache(const expression_cache&) = delete;
+		expression_cache& operator=(const expression_cache&) = delete;
+
+		// 返回已编译的表达式，未命中时编译并插入；表达式非法时抛出异常且不缓存
+		value_type get(const std::string& text);
+		void clear();
+		cache_statistics statistics() const;
+	};
+}
+
+#endif // EXPRESSION_CACHE_HPP
@@ -0,0 +1,82 @@
+#include "function_library.hpp"
+
+namespace chr {
+	std::string function_library::define(const std::string& definition) {
+		size_t equal = definition.find('=');
+		if (equal == std::string::npos) {
+			throw std::runtime_error("函数定义缺少 '='：" + definition);
+		}
+		// 函数头按表达式规则分词，应为 名字 ( [参数 {, 参数}] )
+		std::string_view head(definition.data(), equal);
+		std::vector<std::string_view> parts;
+		for (size_t pos = 0; pos < head.size();) {
+			token_t type = token_t::invalid_token;
+			size_t len = scan_token(head, pos, type);
+			if (len == 0) {
+				if (!std::isspace(static_cast<unsigned char>(head[pos]))) {
+					throw std::runtime_error("函数定义的函数头含有无法识别的字符：" + std::string(head));
+				}
+				pos++;
+				continue;
+			}
+			parts.push_back(head.substr(pos, len));
+			pos += len;
+		}
+		bool well_formed = parts.size() >= 3 && parts[1] == "(" && parts.back() == ")";
+		std::vector<std::string> parameters;
+		for (size_t i = 2; well_formed && i + 1 < parts.size(); i += 2) {
+			parameters.emplace_back(parts[i]);
+			// 参数之间以逗号分隔，最后一个参数后紧跟右括弧
+			well_formed = parts[i + 1] == "," ? i + 2 < parts.size() - 1 : i + 1 == parts.size() - 1;
+		}
+		if (!well_formed) {
+			throw std::runtime_error("函数定义的函数头格式应为 f(x, y)：" + std::string(head));
+		}
+		std::string name(parts[0]);
+		define(name, parameters, definition.substr(equal + 1));
+		return name;
+	}
+
+	// 函数体按参数顺序重新分配变量槽位，数字字面量的原文随函数体一起保存
+	void function_library::define(const std::string& name, const std::vector<std::string>& parameters, const std::string& body) {
+		if (token_type(name) != token_t::variable_token) {
+			throw std::runtime_error("函数名必须是普通标识符，不能与内置函数或常数重名：" + name);
+		}
+		for (size_t i = 0; i < parameters.size(); i++) {
+			if (token_type(parameters[i]) != token_t::variable_token) {
+				throw std::runtime_error("参数名必须是普通标识符，不能与内置函数或常数重名：" + parameters[i]);
+			}
+			if (std::find(parameters.begin(), parameters.begin() + i, parameters[i]) != parameters.begin() + i) {
+				throw std::runtime_error("函数 " + name + " 的参数名重复：" + parameters[i]);
+			}
+		}
+		// 函数体中调用的其他自定义函数在这里展开；被定义的函数此时尚不可见（或仍是旧定义），因此不会递归
+		expression expr(body, *this);
+		std::vector<size_t> slots;
+		for (std::string_view variable : expr.variables()) {
+			auto it = std::find(parameters.begin(), parameters.end(), variable);
+			if (it == parameters.end()) {
+				throw std::runtime_error("函数 " + name + " 的函数体中使用了不是参数的变量：" + std::string(variable));
+			}
+			slots.push_back(it - parameters.begin());
+		}
+		function_definition definition;
+		definition.parameters = parameters;
+		definition.body.assign(expr.tree().begin(), expr.tree().end());
+		for (ast_node& node : definition.body) {
+			if (node.op == opcode::push_variable) {
+				node.index = static_cast<std::uint32_t>(slots[node.index]);
+			}
+			else if (node.op == opcode::push_number) {
+				definition.literals.emplace_back(expr.literal_text(node));
+				node.index = static_cast<std::uint32_t>(definition.literals.size() - 1);
+			}
+		}
+		m_functions.insert_or_assign(name, std::move(definition));
+	}
+
+	const function_definition* function_library::find(std::string_view name) const {
+		auto it = m_functions.find(name);
+		return it == m_functions.end() ? nullptr : &it->second;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef FUNCTION_LIBRARY_HPP
+#define FUNCTION_LIBRARY_HPP
+
+#include "calculator.hpp"
+#include <map>
+
+namespace chr {
+
+	// 自定义函数：函数体保存为未经优化的语法树（后序，根在末尾），变量节点的槽位即参数下标
+	// 函数体中调用的其他自定义函数在定义时已经展开，之后重新定义被调函数不影响已有定义
+	struct function_definition {
+		std::vector<std::string> parameters;
+		std::vector<ast_node> body;
+		std::vector<std::string> literals; // 函数体中数字节点的字面量原文，按字面量编号排列
+	};
+
+	// 自定义函数库：按名字保存函数定义，供 expression 在构造时内联展开
+	// 函数名与参数名必须是普通标识符，不能与内置函数或常数重名；同名函数重新定义时替换旧定义
+	// 只在定义时修改，并发构造表达式期间不能再定义新函数
+	class function_library {
+		std::map<std::string, function_definition, std::less<>> m_functions;
+	public:
+		// 解析 "f(x, y) = x^2 + y" 形式的定义，返回函数名
+		std::string define(const std::string& definition);
+		void define(const std::string& name, const std::vector<std::string>& parameters, const std::string& body);
+		// 未定义时返回 nullptr
+		const function_definition* find(std::string_view name) const;
+		size_t size() const { return m_functions.size(); }
+	};
+}
+
+#endif // FUNCTION_LIBRARY_HPP
@@ -0,0 +1,119 @@
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace chr {
+	namespace {
+		const char* const probe_names[] = {
+			"tokenize",
+			"parse_signal_operators",
+			"parse_parenthese",
+			"parse_operator_sequence",
+			"parse_number_format",
+			"parse_function_usage",
+			"scan",
+			"parse",
+			"optimize",
+			"compile",
+			"evaluate",
+		};
+		static_assert(std::size(probe_names) == PROBE_COUNT);
+
+		// 仍在运行的线程的计数器，以及已退出线程的累计值
+		struct probe_registry {
+			std::mutex mutex;
+			std::vector<probe_counters*> live;
+			probe_counters retired;
+		};
+
+		// 函数内静态对象：保证在任何线程登记之前构造
+		probe_registry& registry() {
+			static probe_registry instance;
+			return instance;
+		}
+
+		void accumulate(probe_counters& target, const probe_counters& source) {
+			for (size_t i = 0; i < PROBE_COUNT; i++) {
+				target.calls[i].fetch_add(source.calls[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+				target.nanoseconds[i].fetch_add(source.nanoseconds[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+		}
+	}
+
+	probe_registration::probe_registration() {
+		probe_registry& target = registry();
+		std::lock_guard<std::mutex> lock(target.mutex);
+		target.live.push_back(&counters);
+	}
+
+	probe_registration::~probe_registration() {
+		probe_registry& target = registry();
+		std::lock_guard<std::mutex> lock(target.mutex);
+		accumulate(target.retired, counters);
+		target.live.erase(std::find(target.live.begin(), target.live.end(), &counters));
+	}
+
+	std::vector<probe_snapshot> instrumentation_snapshot() {
+		probe_registry& source = registry();
+		probe_counters total;
+		{
+			std::lock_guard<std::mutex> lock(source.mutex);
+			accumulate(total, source.retired);
+			for (const probe_counters* counters : source.live) {
+				accumulate(total, *counters);
+			}
+		}
+		std::vector<probe_snapshot> snapshot;
+		for (size_t i = 0; i < PROBE_COUNT; i++) {
+			snapshot.push_back({ probe_names[i], total.calls[i].load(), total.nanoseconds[i].load() });
+		}
+		return snapshot;
+	}
+
+	void reset_instrumentation() {
+		probe_registry& target = registry();
+		std::lock_guard<std::mutex> lock(target.mutex);
+		auto clear = [](probe_counters& counters) {
+			for (size_t i = 0; i < PROBE_COUNT; i++) {
+				counters.calls[i].store(0, std::memory_order_relaxed);
+				counters.nanoseconds[i].store(0, std::memory_order_relaxed);
+			}
+		};
+		clear(target.retired);
+		for (probe_counters* counters : target.live) {
+			clear(*counters);
+		}
+	}
+
+	// 每个探针一行：名字、调用次数、总耗时与平均耗时（只计次数的探针耗时列为 -）
+	std::string format_snapshot_text(const std::vector<probe_snapshot>& snapshot) {
+		std::ostringstream out;
+		out << std::left << std::setw(26) << "probe" << std::right << std::setw(14) << "calls"
+			<< std::setw(14) << "total(ms)" << std::setw(12) << "avg(ns)" << "\n";
+		for (const probe_snapshot& entry : snapshot) {
+			out << std::left << std::setw(26) << entry.name << std::right << std::setw(14) << entry.calls;
+			if (entry.nanoseconds == 0) {
+				out << std::setw(14) << "-" << std::setw(12) << "-";
+			}
+			else {
+				out << std::fixed << std::setprecision(3) << std::setw(14) << entry.nanoseconds / 1e6
+					<< std::setprecision(1) << std::setw(12) << static_cast<double>(entry.nanoseconds) / entry.calls;
+			}
+			out << "\n";
+		}
+		return out.str();
+	}
+
+	std::string format_snapshot_json(const std::vector<probe_snapshot>& snapshot) {
+		std::ostringstream out;
+		out << "{\"enabled\": " << (instrumentation_enabled ? "true" : "false") << ", \"probes\": [";
+		for (size_t i = 0; i < snapshot.size(); i++) {
+			out << (i == 0 ? "" : ", ") << "{\"name\": \"" << snapshot[i].name << "\", \"calls\": " << snapshot[i].calls
+				<< ", \"nanoseconds\": " << snapshot[i].nanoseconds << "}";
+		}
+		out << "]}";
+		return out.str();
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace chr {
+
+	// 探针编号：新增探针时同时在 instrumentation.cpp 的 probe_names 中补上名字
+	enum class probe : unsigned char {
+		tokenize,                // expression_tokenizer::tokenize
+		parse_signal_operators,  // expression_tokenizer 的各项检查
+		parse_parenthese,
+		parse_operator_sequence,
+		parse_number_format,
+		parse_function_usage,
+		scan,                    // expression 构造：分词与验证
+		parse,                   // expression 构造：按优先级爬升建立语法树
+		optimize,
+		compile,
+		evaluate,                // 字节码求值（只计次数）
+		count
+	};
+	constexpr size_t PROBE_COUNT = static_cast<size_t>(probe::count);
+
+	// 是否在编译时启用了探针（定义 CALCULATOR_INSTRUMENTATION）
+#ifdef CALCULATOR_INSTRUMENTATION
+	constexpr bool instrumentation_enabled = true;
+#else
+	constexpr bool instrumentation_enabled = false;
+#endif
+
+	// 单个线程的计数器：只由所属线程写入（relaxed 读改写，不加锁），快照时由其他线程读取
+	struct probe_counters {
+		std::array<std::atomic<std::uint64_t>, PROBE_COUNT> calls{};
+		std::array<std::atomic<std::uint64_t>, PROBE_COUNT> nanoseconds{};
+	};
+
+	// 线程首次记录时向全局登记自己的计数器，线程退出时把计数并入全局累计
+	struct probe_registration {
+		probe_counters counters;
+		probe_registration();
+		~probe_registration();
+	};
+
+	inline probe_counters& local_probe_counters() {
+		thread_local probe_registration registration;
+		return registration.counters;
+	}
+
+	inline void record_probe(probe id, std::uint64_t nanoseconds) {
+		probe_counters& counters = local_probe_counters();
+		size_t index = static_cast<size_t>(id);
+		counters.calls[index].store(counters.calls[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		counters.nanoseconds[index].store(counters.nanoseconds[index].load(std::memory_order_relaxed) + nanoseconds,
+			std::memory_order_relaxed);
+	}
+
+	// 作用域计时：析构时把经过的时间记入探针
+	class scoped_probe {
+		probe m_probe;
+		std::chrono::steady_clock::time_point m_begin;
+	public:
+		explicit scoped_probe(probe id) :m_probe(id), m_begin(std::chrono::steady_clock::now()) {}
+		~scoped_probe() {
+			auto elapsed = std::chrono::steady_clock::now() - m_begin;
+			record_probe(m_probe, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		}
+		scoped_probe(const scoped_probe&) = delete;
+		scoped_probe& operator=(const scoped_probe&) = delete;
+	};
+
+	// 探针快照：只计次数的探针 nanoseconds 为 0
+	struct probe_snapshot {
+		const char* name;
+		std::uint64_t calls;
+		std::uint64_t nanoseconds;
+	};
+
+	// 所有线程（含已退出的线程）的累计值
+	std::vector<probe_snapshot> instrumentation_snapshot();
+	// 清零全部计数；与其他线程正在进行的记录并发时，那一次记录可能覆盖清零
+	void reset_instrumentation();
+	std::string format_snapshot_text(const std::vector<probe_snapshot>& snapshot);
+	std::string format_snapshot_json(const std::vector<probe_snapshot>& snapshot);
+}
+
+// 探针宏：未定义 CALCULATOR_INSTRUMENTATION 时展开为空语句，热路径上不留下任何代码
+// CALCULATOR_TIMED_PROBE 对所在作用域计时；CALCULATOR_COUNT_PROBE 只计次数，用于单次只有几纳秒的运算
+#ifdef CALCULATOR_INSTRUMENTATION
+#define CALCULATOR_PROBE_CONCAT(a, b) a##b
+#define CALCULATOR_PROBE_VARIABLE(line) CALCULATOR_PROBE_CONCAT(calculator_probe_, line)
+#define CALCULATOR_TIMED_PROBE(name) ::chr::scoped_probe CALCULATOR_PROBE_VARIABLE(__LINE__)(::chr::probe::name)
+#define CALCULATOR_COUNT_PROBE(name) ::chr::record_probe(::chr::probe::name, 0)
+#else
+#define CALCULATOR_TIMED_PROBE(name) ((void)0)
+#define CALCULATOR_COUNT_PROBE(name) ((void)0)
+#endif
+
+#endif // INSTRUMENTATION_HPP
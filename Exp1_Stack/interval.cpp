@@ -0,0 +1,491 @@
+#include "interval.hpp"
+#include "numeric.hpp"
+#include <cfloat>
+
+namespace chr {
+	namespace {
+		// 库函数（sin、log、pow 等）的误差上限，端点结果向外放宽这么多个 ulp
+		constexpr int LIBM_ULPS = 4;
+		// tgamma 的误差明显大于其他库函数
+		constexpr int GAMMA_ULPS = 16;
+		// 三角函数参数绝对值超过此值时不再判断极值点与极点的位置，直接返回保守结果
+		constexpr double TRIG_ARGUMENT_LIMIT = 1 << 26;
+		// Γ(x) 在正半轴上的最小值点与最小值
+		constexpr double GAMMA_MIN_ARGUMENT = 1.4616321449683623;
+		constexpr double GAMMA_MIN_VALUE = 0.8856031944108887;
+
+		double step_down(double x, int ulps) {
+			for (int i = 0; i < ulps; i++) {
+				x = std::nextafter(x, -INFINITY);
+			}
+			return x;
+		}
+		double step_up(double x, int ulps) {
+			for (int i = 0; i < ulps; i++) {
+				x = std::nextafter(x, INFINITY);
+			}
+			return x;
+		}
+
+		// 有限操作数运算溢出为 ±inf 时，真值仍是有限数：下界取 DBL_MAX，上界取 -DBL_MAX
+		double overflow_down(double r) {
+			return r > 0 ? DBL_MAX : r;
+		}
+		double overflow_up(double r) {
+			return r < 0 ? -DBL_MAX : r;
+		}
+
+		// 四则与开方的定向舍入：先按最近舍入计算，再用 TwoSum / FMA 求出误差的符号决定是否后退一个 ulp
+		// 结果为 NaN（inf - inf 等）时下界取 -inf、上界取 +inf
+		double add_down(double a, double b) {
+			double s = a + b;
+			if (std::isnan(s)) {
+				return -INFINITY;
+			}
+			if (std::isinf(s)) {
+				return std::isinf(a) || std::isinf(b) ? s : overflow_down(s);
+			}
+			double bb = s - a;
+			double error = (a - (s - bb)) + (b - bb);
+			return error < 0 ? std::nextafter(s, -INFINITY) : s;
+		}
+		double add_up(double a, double b) {
+			double s = a + b;
+			if (std::isnan(s)) {
+				return INFINITY;
+			}
+			if (std::isinf(s)) {
+				return std::isinf(a) || std::isinf(b) ? s : overflow_up(s);
+			}
+			double bb = s - a;
+			double error = (a - (s - bb)) + (b - bb);
+			return error > 0 ? std::nextafter(s, INFINITY) : s;
+		}
+
+		// 乘法约定 0 · inf = 0：区间端点的无穷只是极限，不代表真的取到无穷
+		double multiply_down(double a, double b) {
+			if (a == 0 || b == 0) {
+				return 0;
+			}
+			double p = a * b;
+			if (std::isinf(p)) {
+				return std::isinf(a) || std::isinf(b) ? p : overflow_down(p);
+			}
+			if (std::fabs(p) < DBL_MIN) {
+				return std::nextafter(p, -INFINITY); // 下溢时 FMA 余项可能丢失符号
+			}
+			return std::fma(a, b, -p) < 0 ? std::nextafter(p, -INFINITY) : p;
+		}
+		double multiply_up(double a, double b) {
+			if (a == 0 || b == 0) {
+				return 0;
+			}
+			double p = a * b;
+			if (std::isinf(p)) {
+				return std::isinf(a) || std::isinf(b) ? p : overflow_up(p);
+			}
+			if (std::fabs(p) < DBL_MIN) {
+				return std::nextafter(p, INFINITY);
+			}
+			return std::fma(a, b, -p) > 0 ? std::nextafter(p, INFINITY) : p;
+		}
+
+		// 除数不为零；a / b 的真值与 q 之差的符号等于 (a - q·b) / b 的符号，a - q·b 可由 FMA 精确求得
+		double divide_down(double a, double b) {
+			double q = a / b;
+			if (std::isnan(q)) {
+				return -INFINITY;
+			}
+			if (std::isinf(q)) {
+				return std::isinf(a) ? q : overflow_down(q);
+			}
+			if (a == 0 || std::isinf(b)) {
+				return q;
+			}
+			if (std::fabs(q) < DBL_MIN) {
+				return std::nextafter(q, -INFINITY);
+			}
+			double residual = -std::fma(q, b, -a);
+			return (b > 0 ? residual : -residual) < 0 ? std::nextafter(q, -INFINITY) : q;
+		}
+		double divide_up(double a, double b) {
+			double q = a / b;
+			if (std::isnan(q)) {
+				return INFINITY;
+			}
+			if (std::isinf(q)) {
+				return std::isinf(a) ? q : overflow_up(q);
+			}
+			if (a == 0 || std::isinf(b)) {
+				return q;
+			}
+			if (std::fabs(q) < DBL_MIN) {
+				return std::nextafter(q, INFINITY);
+			}
+			double residual = -std::fma(q, b, -a);
+			return (b > 0 ? residual : -residual) > 0 ? std::nextafter(q, INFINITY) : q;
+		}
+
+		double sqrt_down(double x) {
+			double r = std::sqrt(x);
+			if (std::isinf(r) || r == 0) {
+				return r;
+			}
+			return std::fma(-r, r, x) < 0 ? std::nextafter(r, -INFINITY) : r;
+		}
+		double sqrt_up(double x) {
+			double r = std::sqrt(x);
+			if (std::isinf(r) || r == 0) {
+				return r;
+			}
+			return std::fma(-r, r, x) > 0 ? std::nextafter(r, INFINITY) : r;
+		}
+
+		// 库函数在 0 / 1 处给出的 0 / 1 是精确值（sin(0)、cos(0)、ln(1)、acos(1) 等），不需要放宽
+		bool exact_result(double x, double fx) {
+			return (x == 0 || x == 1) && (fx == 0 || fx == 1);
+		}
+		double libm_down(double x, double fx, int ulps = LIBM_ULPS) {
+			if (std::isnan(fx)) {
+				return -INFINITY;
+			}
+			return std::isinf(fx) || exact_result(x, fx) ? fx : step_down(fx, ulps);
+		}
+		double libm_up(double x, double fx, int ulps = LIBM_ULPS) {
+			if (std::isnan(fx)) {
+				return INFINITY;
+			}
+			return std::isinf(fx) || exact_result(x, fx) ? fx : step_up(fx, ulps);
+		}
+
+		// 以 double 运算符执行函数（与字节码解释器使用同一实现）
+		double apply(opcode op, double x) {
+			return operator_lookup(op).apply(x, 0);
+		}
+
+		// 单调函数：递增时 [f(lo), f(hi)]，递减时 [f(hi), f(lo)]
+		interval monotone(opcode op, interval a, bool increasing, int ulps = LIBM_ULPS) {
+			double first = increasing ? a.lower : a.upper;
+			double second = increasing ? a.upper : a.lower;
+			return { libm_down(first, apply(op, first), ulps), libm_up(second, apply(op, second), ulps) };
+		}
+
+		interval intersect(interval a, double lower, double upper) {
+			if (a.is_empty()) {
+				return a;
+			}
+			return { std::max(a.lower, lower), std::min(a.upper, upper) };
+		}
+
+		interval hull(interval a, interval b) {
+			if (a.is_empty()) {
+				return b;
+			}
+			if (b.is_empty()) {
+				return a;
+			}
+			return { std::min(a.lower, b.lower), std::max(a.upper, b.upper) };
+		}
+
+		// [lo, hi] 是否可能包含 phase + k·period（k 为整数）
+		// CONSTANT_PI 与真实 π 有舍入误差，判断时留出余量：只会多报，不会漏报
+		bool may_contain(interval a, double phase, double period) {
+			double k = std::ceil((a.lower - phase) / period);
+			for (double j = k - 1; j <= k + 1; j++) {
+				double c = phase + j * period;
+				double slack = (std::fabs(c) + 1) * 16 * DBL_EPSILON;
+				if (c + slack >= a.lower && c - slack <= a.upper) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// 参数范围过宽或过大时无法（也无必要）精确定位极点与极值点
+		bool trig_unbounded(interval a, double period) {
+			return !std::isfinite(a.lower) || !std::isfinite(a.upper) || a.upper - a.lower >= period
+				|| std::max(std::fabs(a.lower), std::fabs(a.upper)) > TRIG_ARGUMENT_LIMIT;
+		}
+
+		interval multiply(interval a, interval b) {
+			double lower = std::min({ multiply_down(a.lower, b.lower), multiply_down(a.lower, b.upper),
+				multiply_down(a.upper, b.lower), multiply_down(a.upper, b.upper) });
+			double upper = std::max({ multiply_up(a.lower, b.lower), multiply_up(a.lower, b.upper),
+				multiply_up(a.upper, b.lower), multiply_up(a.upper, b.upper) });
+			return { lower, upper };
+		}
+
+		// 除数含零：[0, c] 与 [c, 0] 取单侧倒数再相乘，零在内部时结果是整个实数轴，除数恰为 0 时无定义
+		interval divide(interval a, interval b) {
+			if (b.lower > 0 || b.upper < 0) {
+				double lower = std::min({ divide_down(a.lower, b.lower), divide_down(a.lower, b.upper),
+					divide_down(a.upper, b.lower), divide_down(a.upper, b.upper) });
+				double upper = std::max({ divide_up(a.lower, b.lower), divide_up(a.lower, b.upper),
+					divide_up(a.upper, b.lower), divide_up(a.upper, b.upper) });
+				return { lower, upper };
+			}
+			if (b.lower == 0 && b.upper == 0) {
+				return interval::empty();
+			}
+			if (b.lower == 0) {
+				return multiply(a, { divide_down(1, b.upper), INFINITY });
+			}
+			if (b.upper == 0) {
+				return multiply(a, { -INFINITY, divide_up(1, b.lower) });
+			}
+			return interval::entire();
+		}
+
+		// fmod 的结果是精确值：除数为单点且被除数落在同一个商区间内时 fmod 单调，直接取端点；
+		// 否则只利用 |fmod(a, b)| < |b|、|fmod(a, b)| <= |a| 且符号与 a 相同
+		interval modulo(interval a, interval b) {
+			if (b.lower == 0 && b.upper == 0) {
+				return interval::empty();
+			}
+			if (b.lower == b.upper && std::isfinite(a.lower) && std::isfinite(a.upper) && std::isfinite(b.lower)
+				&& (a.lower >= 0 || a.upper <= 0) && add_up(a.upper, -a.lower) < std::fabs(b.lower)) {
+				double lower = std::fmod(a.lower, b.lower), upper = std::fmod(a.upper, b.lower);
+				if (lower <= upper) {
+					return { lower, upper };
+				}
+			}
+			double bound = std::max(std::fabs(b.lower), std::fabs(b.upper));
+			return { a.lower >= 0 ? 0 : std::max(a.lower, -bound), a.upper <= 0 ? 0 : std::min(a.upper, bound) };
+		}
+
+		interval power(interval a, interval b) {
+			// 指数为单点整数：按奇偶性与符号讨论，负指数取正指数结果的倒数
+			if (b.lower == b.upper && b.lower == std::floor(b.lower) && std::fabs(b.lower) < 0x1p53) {
+				double n = b.lower;
+				if (n == 0) {
+					return interval::point(1);
+				}
+				double m = std::fabs(n);
+				auto pow_down = [&](double x) { return libm_down(x, std::pow(x, m)); };
+				auto pow_up = [&](double x) { return libm_up(x, std::pow(x, m)); };
+				interval p;
+				if (std::fmod(m, 2) == 1 || a.lower >= 0) {
+					p = { pow_down(a.lower), pow_up(a.upper) };
+				}
+				else if (a.upper <= 0) {
+					p = { pow_down(a.upper), pow_up(a.lower) };
+				}
+				else {
+					p = { 0, std::max(pow_up(a.lower), pow_up(a.upper)) };
+				}
+				if (std::fmod(m, 2) == 0) {
+					p.lower = std::max(p.lower, 0.0);
+				}
+				return n > 0 ? p : divide(interval::point(1), p);
+			}
+			// 负底数只对整数指数有定义：指数为区间时无法排除，保守返回整个实数轴
+			if (a.lower < 0 && b.lower != b.upper) {
+				return interval::entire();
+			}
+			// 非负底数上 x^y 对 x、y 分别单调，极值在四个角上取到
+			a = intersect(a, 0, INFINITY);
+			if (a.is_empty()) {
+				return a;
+			}
+			double corners[] = { std::pow(a.lower, b.lower), std::pow(a.lower, b.upper),
+				std::pow(a.upper, b.lower), std::pow(a.upper, b.upper) };
+			double lower = INFINITY, upper = -INFINITY;
+			for (double c : corners) {
+				lower = std::min(lower, std::isnan(c) ? -INFINITY : c);
+				upper = std::max(upper, std::isnan(c) ? INFINITY : c);
+			}
+			lower = lower == 0 || std::isinf(lower) ? lower : step_down(lower, LIBM_ULPS);
+			upper = std::isinf(upper) ? upper : step_up(upper, LIBM_ULPS);
+			return { std::max(lower, 0.0), upper };
+		}
+
+		// a! = Γ(a+1)：正半轴上 Γ 在 GAMMA_MIN_ARGUMENT 处取最小值，两侧单调；
+		// 非正半轴上极点密集，保守返回整个实数轴
+		interval factorial(interval a) {
+			interval t = { add_down(a.lower, 1), add_up(a.upper, 1) };
+			if (t.lower <= 0) {
+				return interval::entire();
+			}
+			auto gamma_down = [](double x) { return libm_down(x, std::tgamma(x), GAMMA_ULPS); };
+			auto gamma_up = [](double x) { return libm_up(x, std::tgamma(x), GAMMA_ULPS); };
+			double slack = GAMMA_MIN_ARGUMENT * 16 * DBL_EPSILON;
+			if (t.lower <= GAMMA_MIN_ARGUMENT + slack && t.upper >= GAMMA_MIN_ARGUMENT - slack) {
+				return { step_down(GAMMA_MIN_VALUE, GAMMA_ULPS), std::max(gamma_up(t.lower), gamma_up(t.upper)) };
+			}
+			if (t.upper < GAMMA_MIN_ARGUMENT) {
+				return { gamma_down(t.upper), gamma_up(t.lower) };
+			}
+			return { gamma_down(t.lower), gamma_up(t.upper) };
+		}
+
+		// sin / cos：值域 [-1, 1]，区间内含最大值点 / 最小值点时对应端点取 ±1
+		interval sine_like(opcode op, interval a, double max_phase, double min_phase) {
+			const double period = 2 * CONSTANT_PI;
+			if (trig_unbounded(a, period)) {
+				return { -1, 1 };
+			}
+			double x = apply(op, a.lower), y = apply(op, a.upper);
+			double lower = std::max(-1.0, std::min(libm_down(a.lower, x), libm_down(a.upper, y)));
+			double upper = std::min(1.0, std::max(libm_up(a.lower, x), libm_up(a.upper, y)));
+			if (may_contain(a, max_phase, period)) {
+				upper = 1;
+			}
+			if (may_contain(a, min_phase, period)) {
+				lower = -1;
+			}
+			return { lower, upper };
+		}
+
+		// tan / cot：每个周期 π 内单调，区间跨越极点时返回整个实数轴
+		interval tangent_like(opcode op, interval a, double pole, bool increasing) {
+			if (trig_unbounded(a, CONSTANT_PI) || may_contain(a, pole, CONSTANT_PI)) {
+				return interval::entire();
+			}
+			return monotone(op, a, increasing);
+		}
+
+		// sec / csc：极点之间的一支上至多有一个极值（±1），跨越极点时返回整个实数轴
+		interval secant_like(opcode op, interval a, double pole, double min_phase, double max_phase) {
+			if (trig_unbounded(a, CONSTANT_PI) || may_contain(a, pole, CONSTANT_PI)) {
+				return interval::entire();
+			}
+			double x = apply(op, a.lower), y = apply(op, a.upper);
+			double lower = std::min(libm_down(a.lower, x), libm_down(a.upper, y));
+			double upper = std::max(libm_up(a.lower, x), libm_up(a.upper, y));
+			if (may_contain(a, min_phase, 2 * CONSTANT_PI)) {
+				lower = 1; // 正的一支上的最小值
+			}
+			if (may_contain(a, max_phase, 2 * CONSTANT_PI)) {
+				upper = -1; // 负的一支上的最大值
+			}
+			return { lower, upper };
+		}
+
+		// arcsec / arccsc：定义域 |x| >= 1 分为两支，每支上单调，结果取两支的并
+		interval inverse_secant_like(opcode op, interval a, bool increasing) {
+			interval negative = intersect(a, -INFINITY, -1);
+			interval positive = intersect(a, 1, INFINITY);
+			return hull(negative.is_empty() ? negative : monotone(op, negative, increasing),
+				positive.is_empty() ? positive : monotone(op, positive, increasing));
+		}
+
+		// double 的精确有理数值
+		rational exact_rational(double value) {
+			int exponent = 0;
+			long long mantissa = static_cast<long long>(std::ldexp(std::frexp(value, &exponent), DBL_MANT_DIG));
+			exponent -= DBL_MANT_DIG;
+			if (exponent >= 0) {
+				return rational(big_integer(mantissa) * big_integer::power_of(2, exponent));
+			}
+			return rational(mantissa, big_integer::power_of(2, -exponent));
+		}
+
+		// 字面量的区间：value 为其最近舍入结果，能被 double 精确表示时为单点，否则取两侧相邻的浮点数
+		// 不含小数点与指数的整数字面量在 2^53 以内必然精确，其余（含 PI 等常数名）与精确有理数值比较
+		interval literal_interval(std::string_view text, double value) {
+			bool integer_literal = !text.empty() && std::isdigit(static_cast<unsigned char>(text[0]))
+				&& text.find('.') == std::string_view::npos
+				&& (text.starts_with("0x") || text.find_first_of("eE") == std::string_view::npos);
+			if ((integer_literal && std::fabs(value) < 0x1p53) || rational::parse(std::string(text)) == exact_rational(value)) {
+				return interval::point(value);
+			}
+			return { std::nextafter(value, -INFINITY), std::nextafter(value, INFINITY) };
+		}
+	}
+
+	interval interval_apply(opcode op, interval a, interval b) {
+		if (a.is_empty() || (operator_arity(op) == 2 && b.is_empty())) {
+			return interval::empty();
+		}
+		const double half_pi = CONSTANT_PI / 2;
+		switch (op) {
+		case opcode::add: return { add_down(a.lower, b.lower), add_up(a.upper, b.upper) };
+		case opcode::subtract: return { add_down(a.lower, -b.upper), add_up(a.upper, -b.lower) };
+		case opcode::multiply: return multiply(a, b);
+		case opcode::divide: return divide(a, b);
+		case opcode::modulo: return modulo(a, b);
+		case opcode::exponent: return power(a, b);
+		case opcode::posite: return a;
+		case opcode::negate: return { -a.upper, -a.lower };
+		case opcode::factorial: return factorial(a);
+		case opcode::sine: return sine_like(op, a, half_pi, -half_pi);
+		case opcode::cosine: return sine_like(op, a, 0, CONSTANT_PI);
+		case opcode::tangent: return tangent_like(op, a, half_pi, true);
+		case opcode::cotangent: return tangent_like(op, a, 0, false);
+		case opcode::secant: return secant_like(op, a, half_pi, 0, CONSTANT_PI);
+		case opcode::cosecant: return secant_like(op, a, 0, half_pi, -half_pi);
+		case opcode::arcsine: {
+			interval domain = intersect(a, -1, 1);
+			return domain.is_empty() ? domain : monotone(op, domain, true);
+		}
+		case opcode::arccosine: {
+			interval domain = intersect(a, -1, 1);
+			return domain.is_empty() ? domain : monotone(op, domain, false);
+		}
+		case opcode::arctangent: return monotone(op, a, true);
+		// atan(1/x) 在 0 处从 -π/2 跳到 π/2，两侧各自递减
+		case opcode::arccotangent:
+			if (a.lower > 0 || a.upper < 0) {
+				return monotone(op, a, false);
+			}
+			return { step_down(-half_pi, LIBM_ULPS), step_up(half_pi, LIBM_ULPS) };
+		case opcode::arcsecant: return inverse_secant_like(op, a, true);
+		case opcode::arccosecant: return inverse_secant_like(op, a, false);
+		case opcode::common_logarithm:
+		case opcode::natural_logarithm: {
+			interval domain = intersect(a, 0, INFINITY);
+			return domain.is_empty() ? domain : monotone(op, domain, true);
+		}
+		case opcode::square_root: {
+			interval domain = intersect(a, 0, INFINITY);
+			return domain.is_empty() ? domain : interval{ sqrt_down(domain.lower), sqrt_up(domain.upper) };
+		}
+		case opcode::cubic_root: return monotone(op, a, true);
+		case opcode::degree:
+		case opcode::radian: return monotone(op, a, true, 2);
+		// min/max 对两个参数都单调递增，端点直接取值，没有舍入
+		case opcode::minimum: return { std::fmin(a.lower, b.lower), std::fmin(a.upper, b.upper) };
+		case opcode::maximum: return { std::fmax(a.lower, b.lower), std::fmax(a.upper, b.upper) };
+		// hypot 只依赖 |a|、|b| 且对二者递增：由各自绝对值的最小、最大值得到上下界
+		case opcode::hypotenuse: {
+			auto magnitude_lower = [](interval x) { return x.contains(0) ? 0.0 : std::fmin(std::fabs(x.lower), std::fabs(x.upper)); };
+			auto magnitude_upper = [](interval x) { return std::fmax(std::fabs(x.lower), std::fabs(x.upper)); };
+			return { std::fmax(0.0, step_down(std::hypot(magnitude_lower(a), magnitude_lower(b)), LIBM_ULPS)),
+				step_up(std::hypot(magnitude_upper(a), magnitude_upper(b)), LIBM_ULPS) };
+		}
+		default: throw std::runtime_error("运算符没有区间实现：" + std::string(operator_lookup(op).symbol));
+		}
+	}
+
+	interval evaluate_interval(const expression& expr, std::span<const interval> boxes) {
+		if (boxes.size() < expr.variables().size()) {
+			throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(expr.variables().size()) + " 个");
+		}
+		// 按未经优化的语法树逐节点计算：常量折叠的结果已经舍入，不能当作精确值
+		// 语法树按后序存放，results[i] 为第 i 个节点的区间
+		const auto& tree = expr.tree();
+		interval inline_results[EVALUATION_STACK_SIZE]{};
+		std::vector<interval> heap_results;
+		interval* results = inline_results;
+		if (tree.size() > EVALUATION_STACK_SIZE) {
+			heap_results.resize(tree.size());
+			results = heap_results.data();
+		}
+		for (size_t i = 0; i < tree.size(); i++) {
+			const ast_node& node = tree[i];
+			if (node.op == opcode::push_number) {
+				results[i] = literal_interval(expr.literal_text(node), node.value);
+			}
+			else if (node.op == opcode::push_variable) {
+				results[i] = boxes[node.index];
+			}
+			else if (node.right == NO_INDEX) {
+				results[i] = interval_apply(node.op, results[node.left], interval::point(0));
+			}
+			else {
+				results[i] = interval_apply(node.op, results[node.left], results[node.right]);
+			}
+		}
+		return results[tree.size() - 1];
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include "calculator.hpp"
+
+namespace chr {
+
+	// 闭区间 [lower, upper]，端点可以是 ±inf；lower > upper 或端点为 NaN 表示空集
+	struct interval {
+		double lower;
+		double upper;
+
+		static interval point(double value) { return { value, value }; }
+		static interval entire() { return { -INFINITY, INFINITY }; }
+		static interval empty() { return { NAN, NAN }; }
+		bool is_empty() const { return !(lower <= upper); }
+		bool contains(double value) const { return lower <= value && value <= upper; }
+	};
+
+	// 区间版本的运算符：结果包含 a、b 中所有使运算有定义的取值组合的运算结果
+	// 四则与开方按真值的舍入方向向外取整；库函数结果向外放宽若干 ulp；
+	// 跨越 tan/cot/sec/csc 等的极点或除数含零（且不在端点）时返回整个实数轴
+	interval interval_apply(opcode op, interval a, interval b);
+
+	// 区间求值：boxes 按变量槽位给出各变量的取值范围，一遍遍历语法树即可得到输出值域的保证上下界
+	// 不经过常量折叠，字面量从原文判断能否被 double 精确表示，不能时按相邻两个浮点数的区间参与运算
+	interval evaluate_interval(const expression& expr, std::span<const interval> boxes);
+}
+
+#endif // INTERVAL_HPP
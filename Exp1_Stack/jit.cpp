@@ -0,0 +1,299 @@
+#include "jit.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHR_JIT_X86_64 1
+#endif
+
+namespace chr {
+	namespace {
+		// 机器码中调用的函数：与字节码解释器的实现保持一致
+		double call_modulo(double a, double b) { return static_cast<double>(fmodl(a, b)); }
+		double call_exponent(double a, double b) { return pow(a, b); }
+		double call_factorial(double a) { return tgamma(a + 1); }
+		double call_sine(double a) { return sin(a); }
+		double call_cosine(double a) { return cos(a); }
+		double call_tangent(double a) { return tan(a); }
+		double call_cotangent(double a) { return 1 / tan(a); }
+		double call_secant(double a) { return 1 / cos(a); }
+		double call_cosecant(double a) { return 1 / sin(a); }
+		double call_arcsine(double a) { return asin(a); }
+		double call_arccosine(double a) { return acos(a); }
+		double call_arctangent(double a) { return atan(a); }
+		double call_arccotangent(double a) { return atan(1 / a); }
+		double call_arcsecant(double a) { return acos(1 / a); }
+		double call_arccosecant(double a) { return asin(1 / a); }
+		double call_common_logarithm(double a) { return log10(a); }
+		double call_natural_logarithm(double a) { return log(a); }
+		double call_cubic_root(double a) { return cbrt(a); }
+		double call_degree(double a) { return a / CONSTANT_PI * 180; }
+		double call_radian(double a) { return a / 180 * CONSTANT_PI; }
+		double call_minimum(double a, double b) { return fmin(a, b); }
+		double call_maximum(double a, double b) { return fmax(a, b); }
+		double call_hypotenuse(double a, double b) { return hypot(a, b); }
+
+		// 需要通过函数调用实现的操作码，返回被调函数地址；不支持时返回 nullptr
+		const void* callee(opcode op) {
+			switch (op) {
+			case opcode::modulo: return reinterpret_cast<const void*>(&call_modulo);
+			case opcode::exponent: return reinterpret_cast<const void*>(&call_exponent);
+			case opcode::factorial: return reinterpret_cast<const void*>(&call_factorial);
+			case opcode::sine: return reinterpret_cast<const void*>(&call_sine);
+			case opcode::cosine: return reinterpret_cast<const void*>(&call_cosine);
+			case opcode::tangent: return reinterpret_cast<const void*>(&call_tangent);
+			case opcode::cotangent: return reinterpret_cast<const void*>(&call_cotangent);
+			case opcode::secant: return reinterpret_cast<const void*>(&call_secant);
+			case opcode::cosecant: return reinterpret_cast<const void*>(&call_cosecant);
+			case opcode::arcsine: return reinterpret_cast<const void*>(&call_arcsine);
+			case opcode::arccosine: return reinterpret_cast<const void*>(&call_arccosine);
+			case opcode::arctangent: return reinterpret_cast<const void*>(&call_arctangent);
+			case opcode::arccotangent: return reinterpret_cast<const void*>(&call_arccotangent);
+			case opcode::arcsecant: return reinterpret_cast<const void*>(&call_arcsecant);
+			case opcode::arccosecant: return reinterpret_cast<const void*>(&call_arccosecant);
+			case opcode::common_logarithm: return reinterpret_cast<const void*>(&call_common_logarithm);
+			case opcode::natural_logarithm: return reinterpret_cast<const void*>(&call_natural_logarithm);
+			case opcode::cubic_root: return reinterpret_cast<const void*>(&call_cubic_root);
+			case opcode::degree: return reinterpret_cast<const void*>(&call_degree);
+			case opcode::radian: return reinterpret_cast<const void*>(&call_radian);
+			case opcode::minimum: return reinterpret_cast<const void*>(&call_minimum);
+			case opcode::maximum: return reinterpret_cast<const void*>(&call_maximum);
+			case opcode::hypotenuse: return reinterpret_cast<const void*>(&call_hypotenuse);
+			default: return nullptr;
+			}
+		}
+
+		// x86-64 机器码生成器
+		// 栈顶值始终保存在 xmm0，其余栈元素与缓存槽位位于栈帧 [rsp + 32 + 8 * i]；
+		// 前 32 字节是 Windows x64 调用约定要求的影子空间，rbx 保存变量数组指针
+		class assembler {
+			std::vector<byte> m_code;
+		public:
+			const std::vector<byte>& code() const { return m_code; }
+			void emit(std::initializer_list<byte> bytes) {
+				m_code.insert(m_code.end(), bytes);
+			}
+			void emit_u32(std::uint32_t value) {
+				for (int i = 0; i < 4; i++) {
+					m_code.push_back(static_cast<byte>(value >> (8 * i)));
+				}
+			}
+			void emit_u64(std::uint64_t value) {
+				for (int i = 0; i < 8; i++) {
+					m_code.push_back(static_cast<byte>(value >> (8 * i)));
+				}
+			}
+			// movsd xmm0, [rsp + disp32]
+			void load_frame(std::uint32_t offset) {
+				emit({ 0xF2, 0x0F, 0x10, 0x84, 0x24 });
+				emit_u32(offset);
+			}
+			// movsd [rsp + disp32], xmm0
+			void store_frame(std::uint32_t offset) {
+				emit({ 0xF2, 0x0F, 0x11, 0x84, 0x24 });
+				emit_u32(offset);
+			}
+			// movsd xmm0, [rbx + disp32]
+			void load_variable(std::uint32_t offset) {
+				emit({ 0xF2, 0x0F, 0x10, 0x83 });
+				emit_u32(offset);
+			}
+			// mov rax, imm64
+			void move_rax(std::uint64_t value) {
+				emit({ 0x48, 0xB8 });
+				emit_u64(value);
+			}
+			// movq xmm0, rax / movq xmm1, rax
+			void move_xmm0_rax() { emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 }); }
+			void move_xmm1_rax() { emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC8 }); }
+			// movapd xmm1, xmm0
+			void move_xmm1_xmm0() { emit({ 0x66, 0x0F, 0x28, 0xC8 }); }
+			// addsd/subsd/mulsd/divsd xmm0, xmm1
+			void arithmetic(byte opcode_byte) { emit({ 0xF2, 0x0F, opcode_byte, 0xC1 }); }
+			// sqrtsd xmm0, xmm0
+			void square_root() { emit({ 0xF2, 0x0F, 0x51, 0xC0 }); }
+			// xorpd xmm0, xmm1
+			void xor_xmm0_xmm1() { emit({ 0x66, 0x0F, 0x57, 0xC1 }); }
+			// mov rax, imm64; call rax
+			void call(const void* function) {
+				move_rax(reinterpret_cast<std::uint64_t>(function));
+				emit({ 0xFF, 0xD0 });
+			}
+		};
+
+		// 把字节码翻译为机器码；遇到无法翻译的操作码返回空
+		std::vector<byte> translate(std::span<const instruction> program, size_t max_depth, size_t temp_count) {
+			constexpr std::uint32_t shadow_space = 32;
+			std::uint32_t frame = static_cast<std::uint32_t>(shadow_space + 8 * (max_depth + temp_count));
+			frame = (frame + 15) / 16 * 16;
+			// 不做栈探测：帧超过一页时一次 sub rsp 可能越过保护页（Windows 上首次写入即访问违例），交给解释器执行
+			constexpr std::uint32_t page_size = 4096;
+			if (frame > page_size) {
+				return {};
+			}
+			auto slot = [&](size_t index) { return static_cast<std::uint32_t>(shadow_space + 8 * index); };
+			auto temp = [&](size_t index) { return slot(max_depth + index); };
+
+			assembler as;
+			// 序言：push rbx 之后 rsp 16 字节对齐，帧大小为 16 的倍数，保证调用 libm 时对齐
+			as.emit({ 0x53 });
+#if defined(_WIN32)
+			as.emit({ 0x48, 0x89, 0xCB });           // mov rbx, rcx
+#else
+			as.emit({ 0x48, 0x89, 0xFB });           // mov rbx, rdi
+#endif
+			as.emit({ 0x48, 0x81, 0xEC });           // sub rsp, imm32
+			as.emit_u32(frame);
+
+			size_t depth = 0;
+			// 压入新值前把原栈顶写回它在栈帧中的位置
+			auto spill = [&]() {
+				if (depth > 0) {
+					as.store_frame(slot(depth - 1));
+				}
+			};
+			for (const auto& ins : program) {
+				switch (ins.op) {
+				case opcode::push_number: {
+					std::uint64_t bits;
+					std::memcpy(&bits, &ins.value, sizeof(bits));
+					spill();
+					as.move_rax(bits);
+					as.move_xmm0_rax();
+					depth++;
+					break;
+				}
+				case opcode::push_variable:
+					spill();
+					as.load_variable(8 * ins.slot);
+					depth++;
+					break;
+				case opcode::load_temp:
+					spill();
+					as.load_frame(temp(ins.slot));
+					depth++;
+					break;
+				case opcode::store_temp:
+					as.store_frame(temp(ins.slot));
+					break;
+				case opcode::posite:
+					break;
+				case opcode::negate:
+					as.move_rax(0x8000000000000000ull);
+					as.move_xmm1_rax();
+					as.xor_xmm0_xmm1();
+					break;
+				case opcode::square_root:
+					as.square_root();
+					break;
+				case opcode::add: case opcode::subtract: case opcode::multiply: case opcode::divide: {
+					static const byte codes[] = { 0x58, 0x5C, 0x59, 0x5E };
+					byte code = ins.op == opcode::add ? codes[0] : ins.op == opcode::subtract ? codes[1] :
+						ins.op == opcode::multiply ? codes[2] : codes[3];
+					as.move_xmm1_xmm0();
+					as.load_frame(slot(depth - 2));
+					as.arithmetic(code);
+					depth--;
+					break;
+				}
+				default: {
+					const void* function = callee(ins.op);
+					if (function == nullptr) {
+						return {};
+					}
+					if (operator_arity(ins.op) == 2) {
+						as.move_xmm1_xmm0();
+						as.load_frame(slot(depth - 2));
+						depth--;
+					}
+					as.call(function);
+					break;
+				}
+				}
+			}
+			// 尾声：结果已在 xmm0
+			as.emit({ 0x48, 0x81, 0xC4 });           // add rsp, imm32
+			as.emit_u32(frame);
+			as.emit({ 0x5B, 0xC3 });                 // pop rbx; ret
+			return as.code();
+		}
+	}
+
+	executable_memory::executable_memory(const std::vector<byte>& code) {
+#if defined(_WIN32)
+		void* address = VirtualAlloc(nullptr, code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (address == nullptr) {
+			throw std::runtime_error("无法分配可执行内存");
+		}
+		std::memcpy(address, code.data(), code.size());
+		DWORD old_protect;
+		if (!VirtualProtect(address, code.size(), PAGE_EXECUTE_READ, &old_protect)) {
+			VirtualFree(address, 0, MEM_RELEASE);
+			throw std::runtime_error("无法设置可执行内存权限");
+		}
+		FlushInstructionCache(GetCurrentProcess(), address, code.size());
+#else
+		void* address = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (address == MAP_FAILED) {
+			throw std::runtime_error("无法分配可执行内存");
+		}
+		std::memcpy(address, code.data(), code.size());
+		if (mprotect(address, code.size(), PROT_READ | PROT_EXEC) != 0) {
+			munmap(address, code.size());
+			throw std::runtime_error("无法设置可执行内存权限");
+		}
+#endif
+		m_address = address;
+		m_size = code.size();
+	}
+
+	executable_memory::executable_memory(executable_memory&& other) noexcept
+		:m_address(other.m_address), m_size(other.m_size) {
+		other.m_address = nullptr;
+		other.m_size = 0;
+	}
+
+	executable_memory& executable_memory::operator=(executable_memory&& other) noexcept {
+		std::swap(m_address, other.m_address);
+		std::swap(m_size, other.m_size);
+		return *this;
+	}
+
+	executable_memory::~executable_memory() {
+		if (m_address == nullptr) {
+			return;
+		}
+#if defined(_WIN32)
+		VirtualFree(m_address, 0, MEM_RELEASE);
+#else
+		munmap(m_address, m_size);
+#endif
+		m_address = nullptr;
+	}
+
+	// 翻译失败（平台或操作码不支持、栈帧超过一页）时保持 m_function 为空，求值走解释器
+	native_expression::native_expression(expression expr)
+		:m_expression(std::move(expr)) {
+#if defined(CHR_JIT_X86_64)
+		std::vector<byte> code = translate(m_expression.program(), m_expression.max_depth(), m_expression.temp_count());
+		if (!code.empty()) {
+			m_memory = executable_memory(code);
+			m_function = reinterpret_cast<native_function>(m_memory.address());
+		}
+#endif
+	}
+
+	double native_expression::evaluate(const bindings& values) const {
+		if (m_function == nullptr) {
+			return m_expression.evaluate(values);
+		}
+		if (values.size() < m_expression.variables().size()) {
+			throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(m_expression.variables().size()) + " 个");
+		}
+		return m_function(values.data());
+	}
+}
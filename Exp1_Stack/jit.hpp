@@ -0,0 +1,42 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "calculator.hpp"
+
+namespace chr {
+
+	// 本机代码函数：参数为按槽位排列的变量值（即 bindings::data()）
+	using native_function = double(*)(const double* variables);
+
+	// 可执行内存页：写入机器码后改为只读可执行，析构时释放
+	class executable_memory {
+		void* m_address = nullptr;
+		size_t m_size = 0;
+	public:
+		executable_memory() = default;
+		executable_memory(const std::vector<byte>& code);
+		executable_memory(const executable_memory&) = delete;
+		executable_memory& operator=(const executable_memory&) = delete;
+		executable_memory(executable_memory&& other) noexcept;
+		executable_memory& operator=(executable_memory&& other) noexcept;
+		~executable_memory();
+		void* address() const { return m_address; }
+	};
+
+	// 本机代码表达式：把字节码翻译为 x86-64 SSE2 机器码
+	// 加减乘除、正负号与开方直接生成指令，其余函数调用 libm；
+	// 非 x86-64 平台、遇到无法翻译的操作码或栈帧超过一页时退回字节码解释器
+	class native_expression {
+		expression m_expression;           // 解释器回退与变量信息
+		executable_memory m_memory;
+		native_function m_function = nullptr;
+	public:
+		explicit native_expression(expression expr);
+		bool is_native() const { return m_function != nullptr; }
+		native_function function() const { return m_function; }
+		const expression& source() const { return m_expression; }
+		double evaluate(const bindings& values) const;
+	};
+}
+
+#endif // JIT_HPP
@@ -1,158 +1,526 @@
-﻿#include "calculator.hpp"
-
-void print_help() {
-    std::cout << "========== 科学计算器命令行模式 ==========\n";
-    std::cout << "命令格式: -command [参数]\n";
-    std::cout << "可用命令:\n";
-    std::cout << "  -calc <expression>                   计算表达式\n";
-    std::cout << "  -infix <expression>                  显示中缀表达式解析结果\n";
-    std::cout << "  -postfix <expression>                显示后缀表达式解析结果\n";
-    std::cout << "  -valid <expression>               验证表达式语法\n";
-    std::cout << "  -clear                               清空屏幕\n";
-    std::cout << "  -help                                显示帮助\n";
-    std::cout << "  -exit                                退出程序\n";
-    std::cout << "支持的运算符和函数:\n";
-    std::cout << "  算术: + - * / % ^ !\n";
-    std::cout << "  函数: sin cos tan cot sec csc arcsin arccos arctan arccot arcsec arccsc\n";
-    std::cout << "        ln lg sqrt cbrt deg rad\n";
-    std::cout << "  常数: PI E PHI\n";
-    std::cout << "  进制: 0b(二进制) 0o(八进制) 0x(十六进制)\n";
-    std::cout << "示例:\n";
-    std::cout << "  -calc \"2 + 3 * 4\"\n";
-    std::cout << "  -calc \"sin(PI/2)\"\n";
-    std::cout << "  -calc \"0b1010 + 0x1F\"\n";
-    std::cout << "  -validate \"2 * (3 + 4)\"\n";
-}
-
-bool parse_command(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cout << "错误: 缺少命令参数\n";
-        print_help();
-        return false;
-    }
-
-    std::string command = argv[1];
-
-    if (command == "-help") {
-        print_help();
-        return true;
-    }
-    else if (command == "-clear") {
-        system("cls");
-        return true;
-    }
-    else if (command == "-exit") {
-        std::cout << "感谢使用，再见!\n";
-        return false;
-    }
-    else if (command == "-calc" || command == "-infix" || command == "-postfix" || command == "-validate") {
-        if (argc < 3) {
-            std::cout << "错误: 缺少表达式参数\n";
-            std::cout << "用法: " << command << " <expression>\n";
-            return false;
-        }
-
-        std::string expression = argv[2];
-
-        try {
-            if (command == "-calc") {
-                chr::expression expr(expression);
-                std::cout << "计算结果: " << expr.evaluate_from_infix() << "\n";
-            }
-            else if (command == "-infix") {
-                chr::expression expr(expression);
-                std::cout << "中缀解析: " << expr.infix_expression() << "\n";
-            }
-            else if (command == "-postfix") {
-                chr::expression expr(expression);
-                std::cout << "后缀解析: " << expr.postfix_expression() << "\n";
-            }
-            else if (command == "-valid") {
-                chr::expression_tokenizer tokenizer;
-                if (tokenizer.validate(expression)) {
-                    std::cout << "表达式语法正确!\n";
-                }
-                else {
-                    std::cout << "表达式语法错误!\n";
-                    std::cout << tokenizer.detailed_analysis() << "\n";
-                    return false;
-                }
-            }
-        }
-        catch (const std::exception& e) {
-            std::cout << "错误: " << e.what() << std::endl;
-            return false;
-        }
-    }
-    else {
-        std::cout << "错误: 未知命令: " << command << "\n";
-        print_help();
-        return false;
-    }
-
-    return true;
-}
-
-int main(int argc, char* argv[]) {
-    // 如果有命令行参数，则解析并执行相应命令
-    if (argc > 1) {
-        if (!parse_command(argc, argv)) {
-            return 1; // 如果命令执行失败，返回错误码
-        }
-        // 命令执行成功后，继续进入交互模式
-        std::cout << "命令执行完成，进入交互模式...\n";
-    }
-
-    // 交互模式
-    std::cout << "欢迎使用科学计算器!\n";
-    std::cout << "输入 -help 查看可用命令\n";
-
-    std::string input;
-    while (true) {
-        std::cout << "\n> ";
-        std::getline(std::cin, input);
-
-        if (input.empty()) continue;
-
-        // 解析输入为命令行参数
-        std::vector<std::string> args;
-        std::istringstream iss(input);
-        std::string token;
-
-        while (iss >> token) {
-            // 处理引号包围的参数
-            if (token.front() == '"') {
-                std::string quoted_arg = token;
-                while (quoted_arg.back() != '"' && iss >> token) {
-                    quoted_arg += " " + token;
-                }
-                if (quoted_arg.back() == '"') {
-                    args.push_back(quoted_arg.substr(1, quoted_arg.length() - 2));
-                }
-                else {
-                    args.push_back(quoted_arg.substr(1));
-                }
-            }
-            else {
-                args.push_back(token);
-            }
-        }
-
-        if (args.empty()) continue;
-
-        // 转换为char*数组格式
-        std::vector<char*> cargs;
-        cargs.push_back(argv[0]); // 程序名
-        for (auto& arg : args) {
-            cargs.push_back(&arg[0]);
-        }
-
-        if (!parse_command(cargs.size(), cargs.data())) {
-            if (args[0] == "-exit") {
-                break;
-            }
-        }
-    }
-
-    return 0;
+#include "calculator.hpp"
+#include "expression_cache.hpp"
+#include "function_library.hpp"
+#include "stream.hpp"
+#include "server.hpp"
+#include "numeric.hpp"
+#include "interval.hpp"
+#include "instrumentation.hpp"
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+// 交互模式下用 -define 定义的函数，之后的表达式都可以调用
+chr::function_library user_functions;
+// 交互模式下重复出现的表达式直接复用已编译结果
+chr::expression_cache compiled_expressions(1024, 16, &user_functions);
+
+void print_help() {
+    std::cout << "========== 科学计算器命令行模式 ==========\n";
+    std::cout << "命令格式: -command [参数]\n";
+    std::cout << "可用命令:\n";
+    std::cout << "  -calc <expression> [name=value ...]  计算表达式（可为变量赋值）\n";
+    std::cout << "  -infix <expression>                  显示语法树（完全加括弧的中缀形式）\n";
+    std::cout << "  -postfix <expression>                显示编译出的字节码（后缀形式）与优化统计\n";
+    std::cout << "  -numeric <type> <expression> [name=value ...]  以指定数值类型计算\n";
+    std::cout << "                                       type: double long rational decimal\n";
+    std::cout << "                                       表达式中的数字须在 double 范围内，更大或更小的值请用 name=value 传入\n";
+    std::cout << "  -gradient <expression> name=value ...  计算函数值与对各变量的偏导数\n";
+    std::cout << "  -range <expression> name=lo:hi ...   计算各变量在给定范围内时表达式值域的保证上下界\n";
+    std::cout << "  -valid <expression>               验证表达式语法\n";
+    std::cout << "  -define \"<f(x, y) = expression>\"     定义函数，之后的表达式可以调用\n";
+    std::cout << "  -cache                               显示表达式缓存统计\n";
+    std::cout << "  -stats [json|reset]                  显示（或清零）各处理阶段的探针统计\n";
+    std::cout << "  -stream [threads] [memo]             从标准输入逐行读取表达式并求值\n";
+    std::cout << "  -file <path> [threads] [memo]        从文件逐行读取表达式并求值\n";
+    std::cout << "                                       memo: 每线程函数调用记忆表的条目数（默认 0 不启用）\n";
+    std::cout << "  -serve <socket> [threads] [memo]     在 Unix 域套接字上常驻提供求值服务（Ctrl+C 退出）\n";
+    std::cout << "  -load <socket> <file> [connections] [requests] [depth]\n";
+    std::cout << "                                       以文件中的各行为请求向服务端施加负载，报告吞吐与尾延迟\n";
+    std::cout << "  -clear                               清空屏幕\n";
+    std::cout << "  -help                                显示帮助\n";
+    std::cout << "  -exit                                退出程序\n";
+    std::cout << "支持的运算符和函数:\n";
+    std::cout << "  算术: + - * / % ^ !\n";
+    std::cout << "  函数: sin cos tan cot sec csc arcsin arccos arctan arccot arcsec arccsc\n";
+    std::cout << "        ln lg sqrt cbrt deg rad\n";
+    std::cout << "  常数: PI E PHI\n";
+    std::cout << "  变量: 其余标识符（如 x, rate），在 -calc 后以 name=value 赋值\n";
+    std::cout << "  进制: 0b(二进制) 0o(八进制) 0x(十六进制)\n";
+    std::cout << "示例:\n";
+    std::cout << "  -calc \"2 + 3 * 4\"\n";
+    std::cout << "  -calc \"sin(PI/2)\"\n";
+    std::cout << "  -calc \"0b1010 + 0x1F\"\n";
+    std::cout << "  -calc \"rate * x ^ 2\" x=3 rate=0.5\n";
+    std::cout << "  -define \"f(x, y) = x ^ 2 + y\"\n";
+    std::cout << "  -calc \"max(f(1, 2), hypot(3, 4), sum(1, 2, 3))\"\n";
+    std::cout << "  -numeric rational \"0.1 + 0.2\"\n";
+    std::cout << "  -gradient \"x * y + sin(x)\" x=1 y=2\n";
+    std::cout << "  -range \"x ^ 2 - sin(x)\" x=-1:2\n";
+    std::cout << "  -validate \"2 * (3 + 4)\"\n";
+    std::cout << "流式模式每行一个表达式，变量写在分号之后: rate * x ^ 2; x=3 rate=0.5\n";
+}
+
+// argv[first] 起为 name=value 形式的变量赋值，数值按 Number 类型的字面量规则精确解析，结果按槽位排列
+template <typename Number>
+std::vector<Number> parse_assignments(const chr::expression& expr, int argc, char* argv[], int first) {
+    std::vector<Number> values(expr.variables().size());
+    std::vector<bool> bound(expr.variables().size(), false);
+    for (int i = first; i < argc; i++) {
+        std::string assignment = argv[i];
+        size_t eq = assignment.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error("变量赋值格式应为 name=value: " + assignment);
+        }
+        size_t slot = expr.variable_slot(assignment.substr(0, eq));
+        // 字面量不带符号，负值先解析绝对值再取负
+        std::string text = assignment.substr(eq + 1);
+        bool negative = !text.empty() && text[0] == '-';
+        values[slot] = chr::number_traits<Number>::literal(negative ? text.substr(1) : text);
+        if (negative) {
+            values[slot] = -values[slot];
+        }
+        bound[slot] = true;
+    }
+    for (size_t slot = 0; slot < bound.size(); slot++) {
+        if (!bound[slot]) {
+            throw std::runtime_error("变量未赋值: " + std::string(expr.variables()[slot]));
+        }
+    }
+    return values;
+}
+
+// 以 Number 类型计算
+template <typename Number>
+std::string evaluate_numeric(const chr::expression& expr, int argc, char* argv[], int first) {
+    std::vector<Number> values = parse_assignments<Number>(expr, argc, argv, first);
+    return chr::number_traits<Number>::to_string(chr::evaluate_as<Number>(expr, values));
+}
+
+// -stream / -file：结果按行写到标准输出，汇总写到标准错误以免混入结果
+bool run_stream(std::FILE* input, const char* threads_argument, const char* memo_argument) {
+    chr::stream_summary summary;
+    try {
+        size_t threads = threads_argument != nullptr ? std::stoul(threads_argument) : std::thread::hardware_concurrency();
+        size_t memo_capacity = memo_argument != nullptr ? std::stoul(memo_argument) : 0;
+        summary = chr::evaluate_stream(input, stdout, compiled_expressions, threads, memo_capacity);
+    }
+    catch (const std::exception& e) {
+        std::cout << "错误: " << e.what() << "\n";
+        return false;
+    }
+    std::fflush(stdout);
+    std::cerr << "共 " << summary.expressions << " 个表达式, 失败 " << summary.failures << " 个, 耗时 "
+        << summary.seconds << " s, " << summary.expressions / summary.seconds << " expr/s, p50 "
+        << summary.p50_ns / 1000 << " us, p99 " << summary.p99_ns / 1000 << " us\n";
+    if (summary.memo.capacity != 0) {
+        std::cerr << "记忆表: 命中 " << summary.memo.hits << " 次, 未命中 " << summary.memo.misses << " 次, 命中率 "
+            << std::fixed << std::setprecision(1) << summary.memo.hit_rate() * 100 << "%, 淘汰 "
+            << summary.memo.evictions << " 次, 低命中率跳过 " << summary.memo.bypassed << " 次, 条目 " << summary.memo.entries << "/" << summary.memo.capacity << "\n";
+    }
+    return summary.failures == 0;
+}
+
+// -serve 期间收到 SIGINT/SIGTERM 时让接受循环退出（stop 只写一个原子标志）
+chr::calculator_server* active_server = nullptr;
+
+bool run_server(const std::string& path, const char* threads_argument, const char* memo_argument) {
+    try {
+        size_t threads = threads_argument != nullptr ? std::stoul(threads_argument) : std::thread::hardware_concurrency();
+        size_t memo_capacity = memo_argument != nullptr ? std::stoul(memo_argument) : 0;
+        chr::calculator_server server(path, compiled_expressions, threads, memo_capacity);
+        active_server = &server;
+        std::signal(SIGINT, [](int) { active_server->stop(); });
+        std::signal(SIGTERM, [](int) { active_server->stop(); });
+        std::cerr << "正在监听 " << path << "（" << threads << " 个工作线程）\n";
+        server.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        active_server = nullptr;
+        chr::server_statistics stats = server.statistics();
+        std::cerr << "共接受 " << stats.connections << " 个连接, 响应 " << stats.requests << " 个请求, 失败 "
+            << stats.failures << " 个, 协议错误 " << stats.protocol_errors << " 次\n";
+    }
+    catch (const std::exception& e) {
+        std::cout << "错误: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// -load：每行一个请求（格式同流式模式），空行跳过
+bool run_load(int argc, char* argv[]) {
+    std::ifstream input(argv[3]);
+    if (!input) {
+        std::cout << "错误: 无法打开文件: " << argv[3] << "\n";
+        return false;
+    }
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(input, line);) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+    try {
+        size_t connections = argc > 4 ? std::stoul(argv[4]) : 4;
+        size_t requests = argc > 5 ? std::stoul(argv[5]) : 100000;
+        size_t depth = argc > 6 ? std::stoul(argv[6]) : 32;
+        chr::load_summary summary = chr::generate_load(argv[2], lines, connections, requests, depth);
+        std::cout << "共 " << summary.requests << " 个请求, 失败 " << summary.failures << " 个, 耗时 "
+            << summary.seconds << " s, " << summary.qps << " req/s\n"
+            << "延迟: p50 " << summary.p50_us << " us, p99 " << summary.p99_us << " us, p99.9 "
+            << summary.p999_us << " us, 最大 " << summary.max_us << " us\n";
+    }
+    catch (const std::exception& e) {
+        std::cout << "错误: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool parse_command(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "错误: 缺少命令参数\n";
+        print_help();
+        return false;
+    }
+
+    std::string command = argv[1];
+
+    if (command == "-help") {
+        print_help();
+        return true;
+    }
+    else if (command == "-clear") {
+        system("cls");
+        return true;
+    }
+    else if (command == "-define") {
+        if (argc < 3) {
+            std::cout << "错误: 缺少函数定义\n";
+            std::cout << "用法: -define \"f(x, y) = x ^ 2 + y\"\n";
+            return false;
+        }
+        try {
+            std::string name = user_functions.define(argv[2]);
+            // 已缓存的表达式按旧定义展开，重新定义后全部作废
+            compiled_expressions.clear();
+            std::cout << "已定义函数: " << name << "\n";
+        }
+        catch (const std::exception& e) {
+            std::cout << "错误: " << e.what() << "\n";
+            return false;
+        }
+        return true;
+    }
+    else if (command == "-cache") {
+        chr::cache_statistics stats = compiled_expressions.statistics();
+        std::cout << "缓存统计: 命中 " << stats.hits << " 次, 未命中 " << stats.misses << " 次, 淘汰 "
+            << stats.evictions << " 次, 当前条目 " << stats.entries << "\n";
+        return true;
+    }
+    else if (command == "-stats") {
+        if (!chr::instrumentation_enabled) {
+            std::cout << "探针统计未启用: 编译时定义 CALCULATOR_INSTRUMENTATION 后可用"
+                "（CMake: -DCALCULATOR_INSTRUMENTATION=ON）\n";
+            return true;
+        }
+        std::string format = argc > 2 ? argv[2] : "text";
+        if (format == "reset") {
+            chr::reset_instrumentation();
+            std::cout << "探针统计已清零\n";
+        }
+        else if (format == "json") {
+            std::cout << chr::format_snapshot_json(chr::instrumentation_snapshot()) << "\n";
+        }
+        else if (format == "text") {
+            std::cout << chr::format_snapshot_text(chr::instrumentation_snapshot());
+        }
+        else {
+            std::cout << "错误: 未知的统计格式: " << format << "\n";
+            std::cout << "用法: -stats [json|reset]\n";
+            return false;
+        }
+        return true;
+    }
+    else if (command == "-numeric") {
+        if (argc < 4) {
+            std::cout << "错误: 缺少参数\n";
+            std::cout << "用法: -numeric <double|long|rational|decimal> <expression> [name=value ...]\n";
+            std::cout << "      表达式中的数字须在 double 范围内，超出时用变量传入，如 -numeric rational \"x * 2\" x=1e400\n";
+            return false;
+        }
+        std::string type = argv[2];
+        try {
+            std::shared_ptr<const chr::expression> compiled = compiled_expressions.get(argv[3]);
+            std::string result;
+            if (type == "double") {
+                result = evaluate_numeric<double>(*compiled, argc, argv, 4);
+            }
+            else if (type == "long") {
+                result = evaluate_numeric<long double>(*compiled, argc, argv, 4);
+            }
+            else if (type == "rational") {
+                result = evaluate_numeric<chr::rational>(*compiled, argc, argv, 4);
+            }
+            else if (type == "decimal") {
+                result = evaluate_numeric<chr::decimal>(*compiled, argc, argv, 4);
+            }
+            else {
+                throw std::runtime_error("未知数值类型: " + type);
+            }
+            std::cout << "计算结果: " << result << "\n";
+        }
+        catch (const std::exception& e) {
+            std::cout << "错误: " << e.what() << "\n";
+            return false;
+        }
+        return true;
+    }
+    else if (command == "-gradient") {
+        if (argc < 3) {
+            std::cout << "错误: 缺少表达式参数\n";
+            std::cout << "用法: -gradient <expression> name=value ...\n";
+            return false;
+        }
+        try {
+            std::shared_ptr<const chr::expression> compiled = compiled_expressions.get(argv[2]);
+            std::vector<double> values = parse_assignments<double>(*compiled, argc, argv, 3);
+            std::vector<double> gradient(values.size());
+            double result = compiled->gradient(values, gradient);
+            std::cout << "计算结果: " << result << "\n";
+            for (size_t slot = 0; slot < gradient.size(); slot++) {
+                std::cout << "  d/d" << compiled->variables()[slot] << " = " << gradient[slot] << "\n";
+            }
+        }
+        catch (const std::exception& e) {
+            std::cout << "错误: " << e.what() << "\n";
+            return false;
+        }
+        return true;
+    }
+    else if (command == "-range") {
+        if (argc < 3) {
+            std::cout << "错误: 缺少表达式参数\n";
+            std::cout << "用法: -range <expression> name=lo:hi ...\n";
+            return false;
+        }
+        try {
+            std::shared_ptr<const chr::expression> compiled = compiled_expressions.get(argv[2]);
+            std::vector<chr::interval> boxes(compiled->variables().size(), chr::interval::empty());
+            for (int i = 3; i < argc; i++) {
+                std::string assignment = argv[i];
+                size_t eq = assignment.find('=');
+                if (eq == std::string::npos) {
+                    throw std::runtime_error("变量范围格式应为 name=lo:hi: " + assignment);
+                }
+                std::string range = assignment.substr(eq + 1);
+                size_t colon = range.find(':');
+                double lower = std::stod(range.substr(0, colon));
+                double upper = colon == std::string::npos ? lower : std::stod(range.substr(colon + 1));
+                boxes[compiled->variable_slot(assignment.substr(0, eq))] = { lower, upper };
+            }
+            for (size_t slot = 0; slot < boxes.size(); slot++) {
+                if (boxes[slot].is_empty()) {
+                    throw std::runtime_error("变量范围未给出或为空: " + std::string(compiled->variables()[slot]));
+                }
+            }
+            chr::interval result = chr::evaluate_interval(*compiled, boxes);
+            if (result.is_empty()) {
+                std::cout << "值域: 空（给定范围内表达式处处无定义）\n";
+            }
+            else {
+                std::cout << std::setprecision(17) << "值域: [" << result.lower << ", " << result.upper << "]\n"
+                    << std::setprecision(6);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cout << "错误: " << e.what() << "\n";
+            return false;
+        }
+        return true;
+    }
+    else if (command == "-stream") {
+        return run_stream(stdin, argc > 2 ? argv[2] : nullptr, argc > 3 ? argv[3] : nullptr);
+    }
+    else if (command == "-file") {
+        if (argc < 3) {
+            std::cout << "错误: 缺少文件路径\n";
+            std::cout << "用法: -file <path> [threads] [memo]\n";
+            return false;
+        }
+        std::FILE* input = std::fopen(argv[2], "rb");
+        if (input == nullptr) {
+            std::cout << "错误: 无法打开文件: " << argv[2] << "\n";
+            return false;
+        }
+        bool succeeded = run_stream(input, argc > 3 ? argv[3] : nullptr, argc > 4 ? argv[4] : nullptr);
+        std::fclose(input);
+        return succeeded;
+    }
+    else if (command == "-serve") {
+        if (argc < 3) {
+            std::cout << "错误: 缺少套接字路径\n";
+            std::cout << "用法: -serve <socket> [threads] [memo]\n";
+            return false;
+        }
+        return run_server(argv[2], argc > 3 ? argv[3] : nullptr, argc > 4 ? argv[4] : nullptr);
+    }
+    else if (command == "-load") {
+        if (argc < 4) {
+            std::cout << "错误: 缺少套接字路径或请求文件\n";
+            std::cout << "用法: -load <socket> <file> [connections] [requests] [depth]\n";
+            return false;
+        }
+        return run_load(argc, argv);
+    }
+    else if (command == "-exit") {
+        std::cout << "感谢使用，再见!\n";
+        return false;
+    }
+    else if (command == "-calc" || command == "-infix" || command == "-postfix" || command == "-validate") {
+        if (argc < 3) {
+            std::cout << "错误: 缺少表达式参数\n";
+            std::cout << "用法: " << command << " <expression>\n";
+            return false;
+        }
+
+        std::string expression = argv[2];
+
+        try {
+            if (command == "-calc") {
+                std::shared_ptr<const chr::expression> compiled = compiled_expressions.get(expression);
+                const chr::expression& expr = *compiled;
+                // 其余参数形如 name=value，按变量槽位写入绑定
+                chr::bindings values(expr.variables().size());
+                std::vector<bool> bound(expr.variables().size(), false);
+                for (int i = 3; i < argc; i++) {
+                    std::string assignment = argv[i];
+                    size_t eq = assignment.find('=');
+                    if (eq == std::string::npos) {
+                        throw std::runtime_error("变量赋值格式应为 name=value: " + assignment);
+                    }
+                    size_t slot = expr.variable_slot(assignment.substr(0, eq));
+                    values[slot] = std::stod(assignment.substr(eq + 1));
+                    bound[slot] = true;
+                }
+                for (size_t slot = 0; slot < bound.size(); slot++) {
+                    if (!bound[slot]) {
+                        throw std::runtime_error("变量未赋值: " + std::string(expr.variables()[slot]));
+                    }
+                }
+                std::cout << "计算结果: " << expr.evaluate(values) << "\n";
+            }
+            else if (command == "-infix") {
+                std::shared_ptr<const chr::expression> compiled = compiled_expressions.get(expression);
+                const chr::expression& expr = *compiled;
+                std::cout << "中缀解析: " << expr.infix_expression() << "\n";
+            }
+            else if (command == "-postfix") {
+                std::shared_ptr<const chr::expression> compiled = compiled_expressions.get(expression);
+                const chr::expression& expr = *compiled;
+                const auto& report = expr.optimization();
+                std::cout << "后缀解析: " << expr.postfix_expression() << "\n";
+                std::cout << "优化统计: 常量折叠 " << report.folded_operations << " 处, 恒等式化简 "
+                    << report.simplified_identities << " 处, 语法树节点数 " << report.nodes_before
+                    << " -> " << report.nodes_after << ", 公共子表达式归并后节点数 " << report.dag_nodes
+                    << "（缓存 " << report.cached_nodes << " 个）\n";
+            }
+            else if (command == "-valid") {
+                chr::expression_tokenizer tokenizer;
+                if (tokenizer.validate(expression)) {
+                    std::cout << "表达式语法正确!\n";
+                }
+                else {
+                    std::cout << "表达式语法错误!\n";
+                    std::cout << tokenizer.detailed_analysis() << "\n";
+                    return false;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            std::cout << "错误: " << e.what() << "\n";
+            return false;
+        }
+    }
+    else {
+        std::cout << "错误: 未知命令: " << command << "\n";
+        print_help();
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // 如果有命令行参数，则解析并执行相应命令
+    if (argc > 1) {
+        // 流式、服务与负载模式结束后即退出，不进入交互模式
+        std::string command = argv[1];
+        if (command == "-stream" || command == "-file" || command == "-serve" || command == "-load") {
+            return parse_command(argc, argv) ? 0 : 1;
+        }
+        if (!parse_command(argc, argv)) {
+            return 1; // 如果命令执行失败，返回错误码
+        }
+        // 命令执行成功后，继续进入交互模式
+        std::cout << "命令执行完成，进入交互模式...\n";
+    }
+
+    // 交互模式
+    std::cout << "欢迎使用科学计算器!\n";
+    std::cout << "输入 -help 查看可用命令\n";
+
+    std::string input;
+    while (true) {
+        std::cout << "\n> ";
+        if (!std::getline(std::cin, input)) break; // 输入结束
+
+        if (input.empty()) continue;
+
+        // 解析输入为命令行参数
+        std::vector<std::string> args;
+        std::istringstream iss(input);
+        std::string token;
+
+        while (iss >> token) {
+            // 处理引号包围的参数
+            if (token.front() == '"') {
+                std::string quoted_arg = token;
+                while (quoted_arg.back() != '"' && iss >> token) {
+                    quoted_arg += " " + token;
+                }
+                if (quoted_arg.back() == '"') {
+                    args.push_back(quoted_arg.substr(1, quoted_arg.length() - 2));
+                }
+                else {
+                    args.push_back(quoted_arg.substr(1));
+                }
+            }
+            else {
+                args.push_back(token);
+            }
+        }
+
+        if (args.empty()) continue;
+
+        // 转换为char*数组格式
+        std::vector<char*> cargs;
+        cargs.push_back(argv[0]); // 程序名
+        for (auto& arg : args) {
+            cargs.push_back(&arg[0]);
+        }
+
+        if (!parse_command(cargs.size(), cargs.data())) {
+            if (args[0] == "-exit") {
+                break;
+            }
+        }
+    }
+
+    return 0;
 }
\ No newline at end of file
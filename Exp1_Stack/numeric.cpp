@@ -0,0 +1,831 @@
+#include "numeric.hpp"
+#include <bit>
+#include <cfloat>
+#include <iomanip>
+
+namespace chr {
+	namespace {
+		using limbs = std::vector<std::uint32_t>;
+
+		// 常数的 50 位十进制近似，供有理数与十进制模式使用
+		const char* const PI_DIGITS = "3.14159265358979323846264338327950288419716939937510";
+		const char* const E_DIGITS = "2.71828182845904523536028747135266249775724709369995";
+		const char* const PHI_DIGITS = "0.61803398874989484820458683436563811772030917980576";
+		constexpr long double LONG_DOUBLE_PI = 3.141592653589793238462643383279502884L;
+		constexpr long double LONG_DOUBLE_E = 2.718281828459045235360287471352662498L;
+		constexpr long double LONG_DOUBLE_PHI = 0.618033988749894848204586834365638118L;
+
+		// 精确运算中允许的最大整数次幂与阶乘，防止结果无节制地膨胀
+		constexpr unsigned long long MAX_EXACT_EXPONENT = 4096;
+		constexpr unsigned long long MAX_EXACT_FACTORIAL = 1000;
+		// 精确整数次幂结果的位数上限（约 8 万位十进制），按 底数位数 × 次数 预先估计，(1000!)^4096 之类直接报错
+		constexpr size_t MAX_EXACT_BITS = 1 << 18;
+		// 字面量科学计数法指数的绝对值上限，超过 long double 的范围（十进制模式经 long double 计算的结果也由此解析），
+		// 避免解析时构造巨大的 10 的幂
+		constexpr long long MAX_LITERAL_EXPONENT = 5000;
+
+		void trim_limbs(limbs& value) {
+			while (!value.empty() && value.back() == 0) {
+				value.pop_back();
+			}
+		}
+
+		int compare_magnitude(const limbs& a, const limbs& b) {
+			if (a.size() != b.size()) {
+				return a.size() < b.size() ? -1 : 1;
+			}
+			for (size_t i = a.size(); i-- > 0;) {
+				if (a[i] != b[i]) {
+					return a[i] < b[i] ? -1 : 1;
+				}
+			}
+			return 0;
+		}
+
+		limbs add_magnitude(const limbs& a, const limbs& b) {
+			const limbs& longer = a.size() >= b.size() ? a : b;
+			const limbs& shorter = a.size() >= b.size() ? b : a;
+			limbs result(longer.size() + 1);
+			std::uint64_t carry = 0;
+			for (size_t i = 0; i < longer.size(); i++) {
+				std::uint64_t sum = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+				result[i] = static_cast<std::uint32_t>(sum);
+				carry = sum >> 32;
+			}
+			result[longer.size()] = static_cast<std::uint32_t>(carry);
+			trim_limbs(result);
+			return result;
+		}
+
+		// 要求 |a| >= |b|
+		limbs subtract_magnitude(const limbs& a, const limbs& b) {
+			limbs result(a.size());
+			std::int64_t borrow = 0;
+			for (size_t i = 0; i < a.size(); i++) {
+				std::int64_t difference = static_cast<std::int64_t>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+				borrow = difference < 0 ? 1 : 0;
+				result[i] = static_cast<std::uint32_t>(difference + (borrow << 32));
+			}
+			trim_limbs(result);
+			return result;
+		}
+
+		limbs multiply_magnitude(const limbs& a, const limbs& b) {
+			if (a.empty() || b.empty()) {
+				return {};
+			}
+			limbs result(a.size() + b.size());
+			for (size_t i = 0; i < a.size(); i++) {
+				std::uint64_t carry = 0;
+				for (size_t j = 0; j < b.size(); j++) {
+					std::uint64_t product = static_cast<std::uint64_t>(a[i]) * b[j] + result[i + j] + carry;
+					result[i + j] = static_cast<std::uint32_t>(product);
+					carry = product >> 32;
+				}
+				result[i + b.size()] = static_cast<std::uint32_t>(carry);
+			}
+			trim_limbs(result);
+			return result;
+		}
+
+		// value = value * factor + addend
+		void multiply_add_small(limbs& value, std::uint32_t factor, std::uint32_t addend) {
+			std::uint64_t carry = addend;
+			for (auto& limb : value) {
+				std::uint64_t product = static_cast<std::uint64_t>(limb) * factor + carry;
+				limb = static_cast<std::uint32_t>(product);
+				carry = product >> 32;
+			}
+			if (carry != 0) {
+				value.push_back(static_cast<std::uint32_t>(carry));
+			}
+		}
+
+		// 原地除以单个分段，返回余数
+		std::uint32_t divide_small(limbs& value, std::uint32_t divisor) {
+			std::uint64_t remainder = 0;
+			for (size_t i = value.size(); i-- > 0;) {
+				std::uint64_t current = (remainder << 32) | value[i];
+				value[i] = static_cast<std::uint32_t>(current / divisor);
+				remainder = current % divisor;
+			}
+			trim_limbs(value);
+			return static_cast<std::uint32_t>(remainder);
+		}
+
+		// 多分段除法（Knuth 算法 D），要求除数至少两段且被除数不小于除数
+		void divide_magnitude(const limbs& u, const limbs& v, limbs& quotient, limbs& remainder) {
+			const size_t n = v.size(), m = u.size() - v.size();
+			const int shift = std::countl_zero(v.back());
+			limbs vn(n), un(u.size() + 1);
+			// 规格化：左移使除数最高段的最高位为 1
+			for (size_t i = n - 1; i > 0; i--) {
+				vn[i] = (v[i] << shift) | (shift == 0 ? 0 : v[i - 1] >> (32 - shift));
+			}
+			vn[0] = v[0] << shift;
+			un[u.size()] = shift == 0 ? 0 : u.back() >> (32 - shift);
+			for (size_t i = u.size() - 1; i > 0; i--) {
+				un[i] = (u[i] << shift) | (shift == 0 ? 0 : u[i - 1] >> (32 - shift));
+			}
+			un[0] = u[0] << shift;
+
+			const std::uint64_t base = 1ull << 32;
+			quotient.assign(m + 1, 0);
+			for (size_t j = m + 1; j-- > 0;) {
+				std::uint64_t numerator = (static_cast<std::uint64_t>(un[j + n]) << 32) | un[j + n - 1];
+				std::uint64_t qhat = numerator / vn[n - 1];
+				std::uint64_t rhat = numerator % vn[n - 1];
+				while (qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+					qhat--;
+					rhat += vn[n - 1];
+					if (rhat >= base) {
+						break;
+					}
+				}
+				// 乘并减：un[j..j+n] -= qhat * vn
+				std::int64_t borrow = 0, t = 0;
+				for (size_t i = 0; i < n; i++) {
+					std::uint64_t product = qhat * vn[i];
+					t = static_cast<std::int64_t>(un[i + j]) - borrow - static_cast<std::int64_t>(product & 0xFFFFFFFF);
+					un[i + j] = static_cast<std::uint32_t>(t);
+					borrow = static_cast<std::int64_t>(product >> 32) - (t >> 32);
+				}
+				t = static_cast<std::int64_t>(un[j + n]) - borrow;
+				un[j + n] = static_cast<std::uint32_t>(t);
+				quotient[j] = static_cast<std::uint32_t>(qhat);
+				// 估商大了 1：加回一个除数
+				if (t < 0) {
+					quotient[j]--;
+					std::uint64_t carry = 0;
+					for (size_t i = 0; i < n; i++) {
+						std::uint64_t sum = static_cast<std::uint64_t>(un[i + j]) + vn[i] + carry;
+						un[i + j] = static_cast<std::uint32_t>(sum);
+						carry = sum >> 32;
+					}
+					un[j + n] = static_cast<std::uint32_t>(un[j + n] + carry);
+				}
+			}
+			// 余数反规格化
+			remainder.assign(n, 0);
+			for (size_t i = 0; i < n; i++) {
+				remainder[i] = (un[i] >> shift) | (shift == 0 ? 0 : static_cast<std::uint32_t>(static_cast<std::uint64_t>(un[i + 1]) << (32 - shift)));
+			}
+			trim_limbs(quotient);
+			trim_limbs(remainder);
+		}
+
+		std::uint32_t digit_value(char ch) {
+			return ch <= '9' ? ch - '0' : ch <= 'Z' ? ch - 'A' + 10 : ch - 'a' + 10;
+		}
+
+		// a / b 舍入到整数：四舍六入五成双
+		big_integer divide_round_half_even(const big_integer& a, const big_integer& b) {
+			big_integer quotient, remainder;
+			big_integer::divide(a, b, quotient, remainder);
+			if (remainder.is_zero()) {
+				return quotient;
+			}
+			auto twice = (remainder.abs() + remainder.abs()) <=> b.abs();
+			if (twice > 0 || (twice == 0 && quotient.is_odd())) {
+				quotient = a.is_negative() != b.is_negative() ? quotient - 1 : quotient + 1;
+			}
+			return quotient;
+		}
+
+		const big_integer& decimal_scale() {
+			static const big_integer scale = big_integer::power_of(10, DECIMAL_FRACTION_DIGITS);
+			return scale;
+		}
+
+		// 把非负整数有理数转为 unsigned long long，超出 limit 时抛出异常
+		unsigned long long small_integer(const rational& value, unsigned long long limit, const char* what) {
+			unsigned long long result = 0;
+			if (!value.is_integer() || value.numerator().is_negative() || !value.numerator().fits_unsigned(result) || result > limit) {
+				throw std::runtime_error(std::string(what) + "必须是不超过 " + std::to_string(limit) + " 的非负整数");
+			}
+			return result;
+		}
+
+		// 数值的位数估计：有理数为分子与分母的位数之和
+		size_t magnitude_bits(const rational& value) {
+			return value.numerator().bit_length() + value.denominator().bit_length();
+		}
+		size_t magnitude_bits(const decimal& value) {
+			return magnitude_bits(value.to_rational());
+		}
+
+		// base 的 count 次幂的位数不超过 底数位数 × count，据此判断结果是否在 MAX_EXACT_BITS 以内
+		template <typename Number>
+		bool power_fits(const Number& base, unsigned long long count) {
+			return count == 0 || magnitude_bits(base) <= MAX_EXACT_BITS / count;
+		}
+
+		// 精确模式下的整数次幂：负指数取倒数
+		template <typename Number>
+		Number exact_power(const Number& base, const rational& exponent) {
+			if (!exponent.is_integer()) {
+				throw std::runtime_error("精确模式下指数必须是整数");
+			}
+			unsigned long long count = small_integer(exponent.is_zero() || !exponent.numerator().is_negative() ? exponent : -exponent,
+				MAX_EXACT_EXPONENT, "指数绝对值");
+			if (!power_fits(base, count)) {
+				throw std::runtime_error("乘幂结果超过 " + std::to_string(MAX_EXACT_BITS) + " 位，超出精确模式的范围");
+			}
+			Number result = number_traits<Number>::literal("1"), factor = base;
+			for (; count != 0; count >>= 1) {
+				if (count & 1) {
+					result = result * factor;
+				}
+				if (count > 1) {
+					factor = factor * factor;
+				}
+			}
+			return exponent.numerator().is_negative() ? number_traits<Number>::literal("1") / result : result;
+		}
+
+		// 精确模式下的非负整数阶乘
+		big_integer exact_factorial(const rational& value) {
+			unsigned long long n = small_integer(value, MAX_EXACT_FACTORIAL, "阶乘的参数");
+			big_integer result = 1;
+			for (unsigned long long i = 2; i <= n; i++) {
+				result = result * big_integer(static_cast<long long>(i));
+			}
+			return result;
+		}
+	}
+
+	// ---------------- big_integer ----------------
+
+	big_integer::big_integer(long long value) {
+		m_negative = value < 0;
+		unsigned long long magnitude = m_negative ? 0ull - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+		while (magnitude != 0) {
+			m_limbs.push_back(static_cast<std::uint32_t>(magnitude));
+			magnitude >>= 32;
+		}
+	}
+
+	void big_integer::trim() {
+		trim_limbs(m_limbs);
+		if (m_limbs.empty()) {
+			m_negative = false;
+		}
+	}
+
+	big_integer big_integer::from_string(std::string_view digits) {
+		big_integer result;
+		bool negative = !digits.empty() && digits.front() == '-';
+		if (negative) {
+			digits.remove_prefix(1);
+		}
+		if (digits.empty()) {
+			throw std::runtime_error("无效整数");
+		}
+		for (char ch : digits) {
+			if (ch < '0' || ch > '9') {
+				throw std::runtime_error("无效整数：" + std::string(digits));
+			}
+			multiply_add_small(result.m_limbs, 10, ch - '0');
+		}
+		result.m_negative = negative;
+		result.trim();
+		return result;
+	}
+
+	size_t big_integer::bit_length() const {
+		return m_limbs.empty() ? 0 : (m_limbs.size() - 1) * 32 + std::bit_width(m_limbs.back());
+	}
+
+	// 平方求幂：大整数乘法只需 O(log exponent) 次
+	big_integer big_integer::power_of(std::uint32_t base, size_t exponent) {
+		big_integer result = 1;
+		big_integer square = static_cast<long long>(base);
+		while (exponent != 0) {
+			if (exponent & 1) {
+				result = result * square;
+			}
+			exponent >>= 1;
+			if (exponent != 0) {
+				square = square * square;
+			}
+		}
+		return result;
+	}
+
+	std::string big_integer::to_string() const {
+		if (is_zero()) {
+			return "0";
+		}
+		// 每次除以 10^9 取出 9 位十进制
+		limbs value = m_limbs;
+		std::string digits;
+		while (!value.empty()) {
+			std::uint32_t chunk = divide_small(value, 1000000000);
+			for (int i = 0; i < 9 && (chunk != 0 || !value.empty()); i++) {
+				digits.push_back(static_cast<char>('0' + chunk % 10));
+				chunk /= 10;
+			}
+		}
+		if (m_negative) {
+			digits.push_back('-');
+		}
+		std::reverse(digits.begin(), digits.end());
+		return digits;
+	}
+
+	long double big_integer::to_long_double() const {
+		long double value = 0;
+		for (size_t i = m_limbs.size(); i-- > 0;) {
+			value = value * 4294967296.0L + m_limbs[i];
+		}
+		return m_negative ? -value : value;
+	}
+
+	bool big_integer::fits_unsigned(unsigned long long& value) const {
+		if (m_limbs.size() > 2) {
+			return false;
+		}
+		value = 0;
+		for (size_t i = m_limbs.size(); i-- > 0;) {
+			value = (value << 32) | m_limbs[i];
+		}
+		return true;
+	}
+
+	big_integer big_integer::abs() const {
+		big_integer result = *this;
+		result.m_negative = false;
+		return result;
+	}
+
+	big_integer big_integer::operator-() const {
+		big_integer result = *this;
+		result.m_negative = !m_negative;
+		result.trim();
+		return result;
+	}
+
+	big_integer operator+(const big_integer& a, const big_integer& b) {
+		big_integer result;
+		if (a.m_negative == b.m_negative) {
+			result.m_limbs = add_magnitude(a.m_limbs, b.m_limbs);
+			result.m_negative = a.m_negative;
+		}
+		else if (compare_magnitude(a.m_limbs, b.m_limbs) >= 0) {
+			result.m_limbs = subtract_magnitude(a.m_limbs, b.m_limbs);
+			result.m_negative = a.m_negative;
+		}
+		else {
+			result.m_limbs = subtract_magnitude(b.m_limbs, a.m_limbs);
+			result.m_negative = b.m_negative;
+		}
+		result.trim();
+		return result;
+	}
+
+	big_integer operator-(const big_integer& a, const big_integer& b) {
+		return a + -b;
+	}
+
+	big_integer operator*(const big_integer& a, const big_integer& b) {
+		big_integer result;
+		result.m_limbs = multiply_magnitude(a.m_limbs, b.m_limbs);
+		result.m_negative = a.m_negative != b.m_negative;
+		result.trim();
+		return result;
+	}
+
+	void big_integer::divide(const big_integer& a, const big_integer& b, big_integer& quotient, big_integer& remainder) {
+		if (b.is_zero()) {
+			throw std::runtime_error("除数为零");
+		}
+		// 先算到局部变量，允许 quotient / remainder 与 a / b 是同一对象
+		big_integer q, r;
+		if (compare_magnitude(a.m_limbs, b.m_limbs) < 0) {
+			r = a;
+		}
+		else if (b.m_limbs.size() == 1) {
+			q.m_limbs = a.m_limbs;
+			std::uint32_t rest = divide_small(q.m_limbs, b.m_limbs[0]);
+			if (rest != 0) {
+				r.m_limbs.push_back(rest);
+			}
+		}
+		else {
+			divide_magnitude(a.m_limbs, b.m_limbs, q.m_limbs, r.m_limbs);
+		}
+		// 截断除法：商的符号为两者异号，余数与被除数同号
+		q.m_negative = a.m_negative != b.m_negative;
+		r.m_negative = a.m_negative;
+		q.trim();
+		r.trim();
+		quotient = std::move(q);
+		remainder = std::move(r);
+	}
+
+	big_integer big_integer::gcd(big_integer a, big_integer b) {
+		a.m_negative = b.m_negative = false;
+		while (!b.is_zero()) {
+			big_integer quotient, remainder;
+			divide(a, b, quotient, remainder);
+			a = std::move(b);
+			b = std::move(remainder);
+		}
+		return a;
+	}
+
+	std::strong_ordering operator<=>(const big_integer& a, const big_integer& b) {
+		if (a.m_negative != b.m_negative) {
+			return a.m_negative ? std::strong_ordering::less : std::strong_ordering::greater;
+		}
+		int magnitude = compare_magnitude(a.m_limbs, b.m_limbs);
+		if (a.m_negative) {
+			magnitude = -magnitude;
+		}
+		return magnitude <=> 0;
+	}
+
+	// ---------------- rational ----------------
+
+	rational::rational(big_integer numerator, big_integer denominator)
+		: m_numerator(std::move(numerator)), m_denominator(std::move(denominator)) {
+		normalize();
+	}
+
+	void rational::normalize() {
+		if (m_denominator.is_zero()) {
+			throw std::runtime_error("除数为零");
+		}
+		if (m_denominator.is_negative()) {
+			m_numerator = -m_numerator;
+			m_denominator = -m_denominator;
+		}
+		big_integer divisor = big_integer::gcd(m_numerator, m_denominator);
+		if (!(divisor == 1)) {
+			big_integer rest;
+			big_integer::divide(m_numerator, divisor, m_numerator, rest);
+			big_integer::divide(m_denominator, divisor, m_denominator, rest);
+		}
+	}
+
+	rational rational::parse(const std::string& text) {
+		if (text == "PI") {
+			return parse(PI_DIGITS);
+		}
+		if (text == "E") {
+			return parse(E_DIGITS);
+		}
+		if (text == "PHI") {
+			return parse(PHI_DIGITS);
+		}
+		std::string_view body = text;
+		bool negative = !body.empty() && body.front() == '-';
+		if (!body.empty() && (body.front() == '-' || body.front() == '+')) {
+			body.remove_prefix(1);
+		}
+		// 0b / 0o / 0x 进制：整数部分按进制逐位累加，小数部分除以进制的幂
+		std::uint32_t radix = 10;
+		if (body.size() > 2 && body[0] == '0' && (body[1] == 'b' || body[1] == 'o' || body[1] == 'x')) {
+			radix = body[1] == 'b' ? 2 : body[1] == 'o' ? 8 : 16;
+			body.remove_prefix(2);
+		}
+		limbs mantissa;
+		size_t fraction_digits = 0;
+		long long exponent = 0;
+		bool seen_dot = false, seen_digit = false;
+		for (size_t i = 0; i < body.size(); i++) {
+			char ch = body[i];
+			if (ch == '.' && !seen_dot) {
+				seen_dot = true;
+				continue;
+			}
+			if (radix == 10 && (ch == 'e' || ch == 'E') && seen_digit) {
+				std::string_view rest = body.substr(i + 1);
+				bool exponent_negative = !rest.empty() && rest.front() == '-';
+				if (!rest.empty() && (rest.front() == '-' || rest.front() == '+')) {
+					rest.remove_prefix(1);
+				}
+				if (rest.empty() || !std::all_of(rest.begin(), rest.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+					throw std::runtime_error("无效数字：" + text);
+				}
+				rest.remove_prefix(std::min(rest.find_first_not_of('0'), rest.size()));
+				if (rest.size() > 4 || (!rest.empty() && std::stoll(std::string(rest)) > MAX_LITERAL_EXPONENT)) {
+					throw std::runtime_error("数字的指数超出范围（绝对值不超过 " + std::to_string(MAX_LITERAL_EXPONENT) + "）：" + text);
+				}
+				exponent = rest.empty() ? 0 : std::stoll(std::string(rest));
+				exponent = exponent_negative ? -exponent : exponent;
+				break;
+			}
+			if (!std::isxdigit(static_cast<unsigned char>(ch)) || digit_value(ch) >= radix) {
+				throw std::runtime_error("无效数字：" + text);
+			}
+			multiply_add_small(mantissa, radix, digit_value(ch));
+			seen_digit = true;
+			fraction_digits += seen_dot ? 1 : 0;
+		}
+		if (!seen_digit) {
+			throw std::runtime_error("无效数字：" + text);
+		}
+		trim_limbs(mantissa);
+		big_integer numerator;
+		for (size_t i = mantissa.size(); i-- > 0;) {
+			numerator = numerator * big_integer(1ll << 32) + big_integer(static_cast<long long>(mantissa[i]));
+		}
+		big_integer denominator = big_integer::power_of(radix, fraction_digits);
+		if (exponent > 0) {
+			numerator = numerator * big_integer::power_of(10, static_cast<size_t>(exponent));
+		}
+		else if (exponent < 0) {
+			denominator = denominator * big_integer::power_of(10, static_cast<size_t>(-exponent));
+		}
+		return rational(negative ? -numerator : numerator, denominator);
+	}
+
+	big_integer rational::truncate() const {
+		big_integer quotient, remainder;
+		big_integer::divide(m_numerator, m_denominator, quotient, remainder);
+		return quotient;
+	}
+
+	std::string rational::to_string() const {
+		if (is_integer()) {
+			return m_numerator.to_string();
+		}
+		return m_numerator.to_string() + "/" + m_denominator.to_string();
+	}
+
+	long double rational::to_long_double() const {
+		return m_numerator.to_long_double() / m_denominator.to_long_double();
+	}
+
+	rational rational::operator-() const {
+		rational result = *this;
+		result.m_numerator = -result.m_numerator;
+		return result;
+	}
+
+	rational operator+(const rational& a, const rational& b) {
+		return rational(a.m_numerator * b.m_denominator + b.m_numerator * a.m_denominator, a.m_denominator * b.m_denominator);
+	}
+
+	rational operator-(const rational& a, const rational& b) {
+		return a + -b;
+	}
+
+	rational operator*(const rational& a, const rational& b) {
+		return rational(a.m_numerator * b.m_numerator, a.m_denominator * b.m_denominator);
+	}
+
+	rational operator/(const rational& a, const rational& b) {
+		if (b.is_zero()) {
+			throw std::runtime_error("除数为零");
+		}
+		return rational(a.m_numerator * b.m_denominator, a.m_denominator * b.m_numerator);
+	}
+
+	// ---------------- decimal ----------------
+
+	decimal decimal::from_rational(const rational& value) {
+		decimal result;
+		result.m_units = divide_round_half_even(value.numerator() * decimal_scale(), value.denominator());
+		return result;
+	}
+
+	decimal decimal::from_long_double(long double value) {
+		if (!std::isfinite(value)) {
+			throw std::runtime_error("十进制模式下结果不是有限数");
+		}
+		std::ostringstream stream;
+		stream << std::setprecision(LDBL_DECIMAL_DIG) << std::scientific << value;
+		return from_rational(rational::parse(stream.str()));
+	}
+
+	rational decimal::to_rational() const {
+		return rational(m_units, decimal_scale());
+	}
+
+	std::string decimal::to_string() const {
+		std::string digits = m_units.abs().to_string();
+		if (digits.size() <= DECIMAL_FRACTION_DIGITS) {
+			digits.insert(0, DECIMAL_FRACTION_DIGITS + 1 - digits.size(), '0');
+		}
+		digits.insert(digits.size() - DECIMAL_FRACTION_DIGITS, 1, '.');
+		while (digits.back() == '0') {
+			digits.pop_back();
+		}
+		if (digits.back() == '.') {
+			digits.pop_back();
+		}
+		return m_units.is_negative() ? "-" + digits : digits;
+	}
+
+	long double decimal::to_long_double() const {
+		return to_rational().to_long_double();
+	}
+
+	decimal decimal::operator-() const {
+		decimal result;
+		result.m_units = -m_units;
+		return result;
+	}
+
+	decimal operator+(const decimal& a, const decimal& b) {
+		decimal result;
+		result.m_units = a.m_units + b.m_units;
+		return result;
+	}
+
+	decimal operator-(const decimal& a, const decimal& b) {
+		decimal result;
+		result.m_units = a.m_units - b.m_units;
+		return result;
+	}
+
+	decimal operator*(const decimal& a, const decimal& b) {
+		decimal result;
+		result.m_units = divide_round_half_even(a.m_units * b.m_units, decimal_scale());
+		return result;
+	}
+
+	decimal operator/(const decimal& a, const decimal& b) {
+		if (b.is_zero()) {
+			throw std::runtime_error("除数为零");
+		}
+		decimal result;
+		result.m_units = divide_round_half_even(a.m_units * decimal_scale(), b.m_units);
+		return result;
+	}
+
+	// ---------------- number_traits ----------------
+
+	double number_traits<double>::literal(const std::string& text) {
+		token tk = token::from_string(text);
+		if (!tk.is_number()) {
+			throw std::runtime_error("无效数字：" + text);
+		}
+		return tk.number_value();
+	}
+
+	std::string number_traits<double>::to_string(double value) {
+		std::ostringstream stream;
+		stream << value;
+		return stream.str();
+	}
+
+	long double number_traits<long double>::literal(const std::string& text) {
+		if (text == "PI") {
+			return LONG_DOUBLE_PI;
+		}
+		if (text == "E") {
+			return LONG_DOUBLE_E;
+		}
+		if (text == "PHI") {
+			return LONG_DOUBLE_PHI;
+		}
+		// 十进制交给 strtold 正确舍入，进制字面量先精确解析再转换
+		if (text.find_first_of("box") == std::string::npos) {
+			size_t used = 0;
+			long double value = std::stold(text, &used);
+			if (used != text.size()) {
+				throw std::runtime_error("无效数字：" + text);
+			}
+			return value;
+		}
+		return rational::parse(text).to_long_double();
+	}
+
+	long double number_traits<long double>::apply(opcode op, long double a, long double b) {
+		switch (op) {
+		case opcode::add: return a + b;
+		case opcode::subtract: return a - b;
+		case opcode::modulo: return std::fmod(a, b);
+		case opcode::multiply: return a * b;
+		case opcode::divide: return a / b;
+		case opcode::posite: return a;
+		case opcode::negate: return -a;
+		case opcode::exponent: return std::pow(a, b);
+		case opcode::factorial: {
+			// 整数阶乘逐项相乘：tgammal 在整数点上并不精确，会让后续取模等运算出现跳变
+			if (a >= 0 && a <= MAX_EXACT_FACTORIAL && a == std::floor(a)) {
+				long double result = 1;
+				for (long double i = 2; i <= a; i++) {
+					result *= i;
+				}
+				return result;
+			}
+			return std::tgamma(a + 1);
+		}
+		case opcode::sine: return std::sin(a);
+		case opcode::cosine: return std::cos(a);
+		case opcode::tangent: return std::tan(a);
+		case opcode::cotangent: return 1 / std::tan(a);
+		case opcode::secant: return 1 / std::cos(a);
+		case opcode::cosecant: return 1 / std::sin(a);
+		case opcode::arcsine: return std::asin(a);
+		case opcode::arccosine: return std::acos(a);
+		case opcode::arctangent: return std::atan(a);
+		case opcode::arccotangent: return std::atan(1 / a);
+		case opcode::arcsecant: return std::acos(1 / a);
+		case opcode::arccosecant: return std::asin(1 / a);
+		case opcode::common_logarithm: return std::log10(a);
+		case opcode::natural_logarithm: return std::log(a);
+		case opcode::square_root: return std::sqrt(a);
+		case opcode::cubic_root: return std::cbrt(a);
+		case opcode::degree: return a / LONG_DOUBLE_PI * 180;
+		case opcode::radian: return a / 180 * LONG_DOUBLE_PI;
+		case opcode::minimum: return std::fmin(a, b);
+		case opcode::maximum: return std::fmax(a, b);
+		case opcode::hypotenuse: return std::hypot(a, b);
+		default: throw std::runtime_error("出现无法执行的运算符");
+		}
+	}
+
+	std::string number_traits<long double>::to_string(long double value) {
+		std::ostringstream stream;
+		stream << std::setprecision(LDBL_DIG) << value;
+		return stream.str();
+	}
+
+	rational number_traits<rational>::literal(const std::string& text) {
+		return rational::parse(text);
+	}
+
+	rational number_traits<rational>::apply(opcode op, const rational& a, const rational& b) {
+		switch (op) {
+		case opcode::add: return a + b;
+		case opcode::subtract: return a - b;
+		case opcode::multiply: return a * b;
+		case opcode::divide: return a / b;
+		case opcode::modulo: {
+			// 与 fmod 一致：结果与被除数同号
+			if (b.is_zero()) {
+				throw std::runtime_error("除数为零");
+			}
+			return a - b * rational((a / b).truncate());
+		}
+		case opcode::posite: return a;
+		case opcode::negate: return -a;
+		case opcode::exponent: return exact_power(a, b);
+		case opcode::factorial: return rational(exact_factorial(a));
+		case opcode::degree: return a / literal("PI") * rational(180);
+		case opcode::radian: return a / rational(180) * literal("PI");
+		case opcode::minimum: return (a - b).numerator().is_negative() ? a : b;
+		case opcode::maximum: return (b - a).numerator().is_negative() ? a : b;
+		default:
+			throw std::runtime_error("精确有理数模式不支持运算：" + std::string(operator_lookup(op).symbol));
+		}
+	}
+
+	std::string number_traits<rational>::to_string(const rational& value) {
+		return value.to_string();
+	}
+
+	decimal number_traits<decimal>::literal(const std::string& text) {
+		return decimal::from_rational(rational::parse(text));
+	}
+
+	decimal number_traits<decimal>::apply(opcode op, const decimal& a, const decimal& b) {
+		switch (op) {
+		case opcode::add: return a + b;
+		case opcode::subtract: return a - b;
+		case opcode::multiply: return a * b;
+		case opcode::divide: return a / b;
+		case opcode::modulo: {
+			if (b.is_zero()) {
+				throw std::runtime_error("除数为零");
+			}
+			return decimal::from_rational(a.to_rational() - b.to_rational() * rational((a.to_rational() / b.to_rational()).truncate()));
+		}
+		case opcode::posite: return a;
+		case opcode::negate: return -a;
+		// 整数次幂与阶乘在精确运算的限制以内时精确计算，否则与超越函数一样经 long double 计算
+		case opcode::exponent: {
+			rational exponent = b.to_rational();
+			unsigned long long count = 0;
+			if (exponent.is_integer() && exponent.numerator().fits_unsigned(count) && count <= MAX_EXACT_EXPONENT && power_fits(a, count)) {
+				return exact_power(a, exponent);
+			}
+			return decimal::from_long_double(std::pow(a.to_long_double(), b.to_long_double()));
+		}
+		case opcode::factorial: {
+			rational value = a.to_rational();
+			unsigned long long n = 0;
+			if (value.is_integer() && !value.numerator().is_negative() && value.numerator().fits_unsigned(n) && n <= MAX_EXACT_FACTORIAL) {
+				return decimal::from_rational(rational(exact_factorial(value)));
+			}
+			return decimal::from_long_double(std::tgamma(a.to_long_double() + 1));
+		}
+		case opcode::degree: return a / literal("PI") * literal("180");
+		case opcode::radian: return a / literal("180") * literal("PI");
+		case opcode::minimum: return (a - b).to_rational().numerator().is_negative() ? a : b;
+		case opcode::maximum: return (b - a).to_rational().numerator().is_negative() ? a : b;
+		default:
+			// 超越函数经 long double 计算后舍入到定点小数
+			return decimal::from_long_double(number_traits<long double>::apply(op, a.to_long_double(), b.to_long_double()));
+		}
+	}
+
+	std::string number_traits<decimal>::to_string(const decimal& value) {
+		return value.to_string();
+	}
+}
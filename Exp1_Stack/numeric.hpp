@@ -0,0 +1,172 @@
+#ifndef NUMERIC_HPP
+#define NUMERIC_HPP
+
+#include "calculator.hpp"
+#include <compare>
+#include <type_traits>
+
+namespace chr {
+
+	// 任意精度整数：符号 + 绝对值（小端序 32 位分段，无前导零；零为空）
+	class big_integer {
+		std::vector<std::uint32_t> m_limbs;
+		bool m_negative = false;
+	private:
+		void trim();
+	public:
+		big_integer() = default;
+		big_integer(long long value);
+		static big_integer from_string(std::string_view digits); // 十进制数字串，可带负号
+		static big_integer power_of(std::uint32_t base, size_t exponent);
+		std::string to_string() const;
+		long double to_long_double() const;
+		bool is_zero() const { return m_limbs.empty(); }
+		bool is_negative() const { return m_negative; }
+		bool is_odd() const { return !m_limbs.empty() && (m_limbs[0] & 1) != 0; }
+		size_t bit_length() const; // 绝对值的二进制位数，零为 0
+		// 绝对值能否放入 unsigned long long，能则写入 value
+		bool fits_unsigned(unsigned long long& value) const;
+		big_integer abs() const;
+		big_integer operator-() const;
+		friend big_integer operator+(const big_integer& a, const big_integer& b);
+		friend big_integer operator-(const big_integer& a, const big_integer& b);
+		friend big_integer operator*(const big_integer& a, const big_integer& b);
+		// 截断除法（向零取整），同时给出余数；除数为零时抛出异常
+		static void divide(const big_integer& a, const big_integer& b, big_integer& quotient, big_integer& remainder);
+		static big_integer gcd(big_integer a, big_integer b);
+		friend std::strong_ordering operator<=>(const big_integer& a, const big_integer& b);
+		friend bool operator==(const big_integer& a, const big_integer& b) = default;
+	};
+	big_integer operator+(const big_integer& a, const big_integer& b);
+	big_integer operator-(const big_integer& a, const big_integer& b);
+	big_integer operator*(const big_integer& a, const big_integer& b);
+	std::strong_ordering operator<=>(const big_integer& a, const big_integer& b);
+
+	// 精确有理数：分母恒为正且与分子互素
+	class rational {
+		big_integer m_numerator;
+		big_integer m_denominator = 1;
+	private:
+		void normalize();
+	public:
+		rational() = default;
+		rational(big_integer numerator, big_integer denominator = 1);
+		// 精确解析字面量：十进制（含科学计数法）、0b/0o/0x 进制与 PI/E/PHI（常数取 50 位近似）
+		static rational parse(const std::string& text);
+		const big_integer& numerator() const { return m_numerator; }
+		const big_integer& denominator() const { return m_denominator; }
+		bool is_zero() const { return m_numerator.is_zero(); }
+		bool is_integer() const { return m_denominator == 1; }
+		big_integer truncate() const; // 向零取整
+		std::string to_string() const; // "p/q"，整数只输出 "p"
+		long double to_long_double() const;
+		rational operator-() const;
+		friend rational operator+(const rational& a, const rational& b);
+		friend rational operator-(const rational& a, const rational& b);
+		friend rational operator*(const rational& a, const rational& b);
+		friend rational operator/(const rational& a, const rational& b);
+		friend bool operator==(const rational& a, const rational& b) = default;
+	};
+	rational operator+(const rational& a, const rational& b);
+	rational operator-(const rational& a, const rational& b);
+	rational operator*(const rational& a, const rational& b);
+	rational operator/(const rational& a, const rational& b);
+
+	// 定点十进制的小数位数
+	constexpr size_t DECIMAL_FRACTION_DIGITS = 30;
+
+	// 定点十进制数：以 10^-DECIMAL_FRACTION_DIGITS 为单位的整数，
+	// 乘除结果按四舍六入五成双舍入到固定小数位
+	class decimal {
+		big_integer m_units;
+	public:
+		decimal() = default;
+		static decimal from_rational(const rational& value);
+		static decimal from_long_double(long double value);
+		rational to_rational() const;
+		std::string to_string() const; // 去掉末尾多余的 0
+		long double to_long_double() const;
+		bool is_zero() const { return m_units.is_zero(); }
+		decimal operator-() const;
+		friend decimal operator+(const decimal& a, const decimal& b);
+		friend decimal operator-(const decimal& a, const decimal& b);
+		friend decimal operator*(const decimal& a, const decimal& b);
+		friend decimal operator/(const decimal& a, const decimal& b);
+	};
+	decimal operator+(const decimal& a, const decimal& b);
+	decimal operator-(const decimal& a, const decimal& b);
+	decimal operator*(const decimal& a, const decimal& b);
+	decimal operator/(const decimal& a, const decimal& b);
+
+	// 数值后端特性：literal 解析字面量或变量赋值文本，apply 执行一个运算符，to_string 输出结果
+	// 未特化的类型没有定义，选择不支持的数值类型会在编译期报错
+	template <typename Number>
+	struct number_traits;
+
+	template <>
+	struct number_traits<double> {
+		static double literal(const std::string& text);
+		static std::string to_string(double value);
+	};
+
+	template <>
+	struct number_traits<long double> {
+		static long double literal(const std::string& text);
+		static long double apply(opcode op, long double a, long double b);
+		static std::string to_string(long double value);
+	};
+
+	// 有理数模式只支持精确运算：四则、取模、整数次幂、非负整数阶乘与 min/max，其余函数抛出异常
+	template <>
+	struct number_traits<rational> {
+		static rational literal(const std::string& text);
+		static rational apply(opcode op, const rational& a, const rational& b);
+		static std::string to_string(const rational& value);
+	};
+
+	// 十进制模式的四则与整数次幂按定点规则舍入，超越函数经 long double 计算后再舍入；
+	// 超出精确运算限制的整数次幂与阶乘（如 2^5000、1001!）同样经 long double 计算
+	template <>
+	struct number_traits<decimal> {
+		static decimal literal(const std::string& text);
+		static decimal apply(opcode op, const decimal& a, const decimal& b);
+		static std::string to_string(const decimal& value);
+	};
+
+	// 以指定数值类型求值：values 按变量槽位排列
+	// double 在编译期直接转到字节码解释器；其他类型按未经优化的语法树逐个节点运算，
+	// 数字从字面量原文解析（不经过 double），因此不受常量折叠的舍入影响
+	// 限制：构造 expression 时字面量仍按 double 解析一次，超出 double 范围的十进制字面量（如 1e400）在构造时即报错，
+	// 其他类型也无法使用；这样的值应作为变量传入，变量值由各类型的 literal 直接解析
+	template <typename Number>
+	Number evaluate_as(const expression& expr, std::span<const Number> values) {
+		if constexpr (std::is_same_v<Number, double>) {
+			return expr.evaluate(values);
+		}
+		else {
+			if (values.size() < expr.variables().size()) {
+				throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(expr.variables().size()) + " 个");
+			}
+			// 语法树按后序存放，逐节点计算即可，results[i] 为第 i 个节点的值
+			std::vector<Number> results;
+			results.reserve(expr.tree().size());
+			for (const ast_node& node : expr.tree()) {
+				if (node.op == opcode::push_number) {
+					results.push_back(number_traits<Number>::literal(std::string(expr.literal_text(node))));
+				}
+				else if (node.op == opcode::push_variable) {
+					results.push_back(values[node.index]);
+				}
+				else if (node.right == NO_INDEX) {
+					results.push_back(number_traits<Number>::apply(node.op, results[node.left], Number()));
+				}
+				else {
+					results.push_back(number_traits<Number>::apply(node.op, results[node.left], results[node.right]));
+				}
+			}
+			return results.back();
+		}
+	}
+}
+
+#endif // NUMERIC_HPP
@@ -0,0 +1,399 @@
+#include "server.hpp"
+#include <chrono>
+#include <climits>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace chr {
+	namespace {
+		// 套接字接口在 Windows（Winsock 的 AF_UNIX）与 POSIX 之间的差异集中在这里
+#if defined(_WIN32)
+		using socket_handle = SOCKET;
+		const socket_handle INVALID_HANDLE = INVALID_SOCKET;
+		constexpr int SHUTDOWN_BOTH = SD_BOTH;
+		void close_socket(socket_handle s) { closesocket(s); }
+		int poll_socket(pollfd* target, int timeout_ms) { return WSAPoll(target, 1, timeout_ms); }
+		// 首次创建套接字前初始化一次 Winsock
+		void start_sockets() {
+			static const bool started = []() { WSADATA data; return WSAStartup(MAKEWORD(2, 2), &data) == 0; }();
+			if (!started) {
+				throw std::runtime_error("Winsock 初始化失败");
+			}
+		}
+		// AF_UNIX 套接字文件是重解析点
+		bool is_socket_file(const std::string& path, bool& exists) {
+			DWORD attributes = GetFileAttributesA(path.c_str());
+			exists = attributes != INVALID_FILE_ATTRIBUTES;
+			return exists && (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+		}
+#else
+		using socket_handle = int;
+		constexpr socket_handle INVALID_HANDLE = -1;
+		constexpr int SHUTDOWN_BOTH = SHUT_RDWR;
+		void close_socket(socket_handle s) { ::close(s); }
+		int poll_socket(pollfd* target, int timeout_ms) { return ::poll(target, 1, timeout_ms); }
+		void start_sockets() {}
+		bool is_socket_file(const std::string& path, bool& exists) {
+			struct stat info;
+			exists = ::lstat(path.c_str(), &info) == 0;
+			return exists && S_ISSOCK(info.st_mode);
+		}
+#endif
+#if defined(MSG_NOSIGNAL)
+		constexpr int SEND_FLAGS = MSG_NOSIGNAL; // 对端已关闭时返回错误而不是触发 SIGPIPE
+#else
+		constexpr int SEND_FLAGS = 0;
+#endif
+
+		constexpr size_t RECEIVE_BUFFER_SIZE = 64 * 1024;
+		constexpr int ACCEPT_POLL_MS = 100; // 接受循环检查停止标志的间隔
+
+		sockaddr_un socket_address(const std::string& path) {
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+				throw std::runtime_error("套接字路径为空或过长：" + path);
+			}
+			std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+			return address;
+		}
+
+		// 删除上次运行遗留的套接字文件；路径已存在但不是套接字时报错，不删除普通文件
+		void remove_stale_socket(const std::string& path) {
+			bool exists = false;
+			if (is_socket_file(path, exists)) {
+				std::remove(path.c_str());
+			}
+			else if (exists) {
+				throw std::runtime_error("路径已存在且不是套接字：" + path);
+			}
+		}
+
+		socket_handle open_socket() {
+			start_sockets();
+			socket_handle s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (s == INVALID_HANDLE) {
+				throw std::runtime_error("无法创建套接字");
+			}
+			return s;
+		}
+
+		// 发送整段数据；对端断开时返回 false
+		bool send_all(socket_handle s, const char* data, size_t size) {
+			while (size > 0) {
+				auto sent = ::send(s, data, static_cast<int>(std::min<size_t>(size, INT_MAX)), SEND_FLAGS);
+				if (sent <= 0) {
+					return false;
+				}
+				data += sent;
+				size -= static_cast<size_t>(sent);
+			}
+			return true;
+		}
+
+		// 读取到 buffer 末尾；返回读到的字节数，连接关闭或出错时为 0
+		size_t receive_some(socket_handle s, std::vector<char>& buffer) {
+			size_t used = buffer.size();
+			buffer.resize(used + RECEIVE_BUFFER_SIZE);
+			auto received = ::recv(s, buffer.data() + used, static_cast<int>(RECEIVE_BUFFER_SIZE), 0);
+			buffer.resize(used + (received > 0 ? static_cast<size_t>(received) : 0));
+			return received > 0 ? static_cast<size_t>(received) : 0;
+		}
+
+		void put_u32(std::string& out, std::uint32_t value) {
+			for (int i = 0; i < 4; i++) {
+				out.push_back(static_cast<char>(value >> (8 * i)));
+			}
+		}
+		void put_u64(std::string& out, std::uint64_t value) {
+			for (int i = 0; i < 8; i++) {
+				out.push_back(static_cast<char>(value >> (8 * i)));
+			}
+		}
+		std::uint64_t get_le(const char* data, int bytes) {
+			std::uint64_t value = 0;
+			for (int i = bytes - 1; i >= 0; i--) {
+				value = value << 8 | static_cast<unsigned char>(data[i]);
+			}
+			return value;
+		}
+	}
+
+	struct calculator_server::connection {
+		socket_handle socket;
+		std::mutex write_mutex; // 多个工作线程的响应不能交错写入
+		bool broken = false;    // 写失败后不再发送
+		explicit connection(socket_handle s) :socket(s) {}
+		~connection() { close_socket(socket); }
+	};
+
+	calculator_server::calculator_server(const std::string& path, expression_cache& cache, size_t threads, size_t memo_capacity)
+		:m_path(path), m_cache(cache) {
+		sockaddr_un address = socket_address(path);
+		remove_stale_socket(path);
+		socket_handle listener = open_socket();
+		if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, SOMAXCONN) != 0) {
+			close_socket(listener);
+			throw std::runtime_error("无法监听套接字：" + path);
+		}
+		m_listener = static_cast<std::intptr_t>(listener);
+		threads = std::max<size_t>(1, threads);
+		for (size_t t = 0; t < threads; t++) {
+			m_workers.emplace_back([this, memo_capacity]() { work(memo_capacity); });
+		}
+	}
+
+	calculator_server::~calculator_server() {
+		stop();
+		// 断开所有连接使读线程退出，再让工作线程处理完已入队的请求后退出
+		{
+			std::unique_lock<std::mutex> lock(m_clients_mutex);
+			for (const auto& weak : m_clients) {
+				if (auto client = weak.lock()) {
+					::shutdown(client->socket, SHUTDOWN_BOTH);
+				}
+			}
+			m_readers_done.wait(lock, [this]() { return m_active_readers == 0; });
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_queue_mutex);
+			m_workers_exit = true;
+		}
+		m_queue_ready.notify_all();
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+		close_socket(static_cast<socket_handle>(m_listener));
+		std::remove(m_path.c_str());
+	}
+
+	void calculator_server::stop() {
+		m_stopping = true;
+	}
+
+	// 接受循环：定期醒来检查停止标志；每个连接一个读线程，读线程结束时自行注销
+	void calculator_server::run() {
+		pollfd target{};
+		target.fd = static_cast<socket_handle>(m_listener);
+		target.events = POLLIN;
+		while (!m_stopping) {
+			if (poll_socket(&target, ACCEPT_POLL_MS) <= 0) {
+				continue;
+			}
+			socket_handle s = ::accept(static_cast<socket_handle>(m_listener), nullptr, nullptr);
+			if (s == INVALID_HANDLE) {
+				continue;
+			}
+			auto client = std::make_shared<connection>(s);
+			m_connections++;
+			{
+				std::lock_guard<std::mutex> lock(m_clients_mutex);
+				std::erase_if(m_clients, [](const std::weak_ptr<connection>& weak) { return weak.expired(); });
+				m_clients.push_back(client);
+				m_active_readers++;
+			}
+			std::thread(&calculator_server::read, this, std::move(client)).detach();
+		}
+	}
+
+	// 读线程：按帧格式拆出请求，一次读到的所有完整请求一起入队
+	void calculator_server::read(std::shared_ptr<connection> client) {
+		std::vector<char> buffer;
+		std::vector<request> batch;
+		size_t consumed = 0;
+		bool valid = true;
+		while (valid && receive_some(client->socket, buffer) > 0) {
+			while (buffer.size() - consumed >= REQUEST_HEADER_SIZE) {
+				const char* header = buffer.data() + consumed;
+				size_t length = static_cast<size_t>(get_le(header, 4));
+				if (length > MAX_REQUEST_SIZE) {
+					m_protocol_errors++;
+					valid = false;
+					break;
+				}
+				if (buffer.size() - consumed < REQUEST_HEADER_SIZE + length) {
+					break;
+				}
+				batch.push_back({ client, get_le(header + 4, 8), std::string(header + REQUEST_HEADER_SIZE, length) });
+				consumed += REQUEST_HEADER_SIZE + length;
+			}
+			buffer.erase(buffer.begin(), buffer.begin() + consumed);
+			consumed = 0;
+			if (!batch.empty()) {
+				{
+					std::lock_guard<std::mutex> lock(m_queue_mutex);
+					for (auto& item : batch) {
+						m_queue.push_back(std::move(item));
+					}
+				}
+				batch.size() == 1 ? m_queue_ready.notify_one() : m_queue_ready.notify_all();
+				batch.clear();
+			}
+		}
+		// 连接由最后一个持有它的请求释放，未完成的请求仍能写回响应
+		client.reset();
+		std::lock_guard<std::mutex> lock(m_clients_mutex);
+		m_active_readers--;
+		m_readers_done.notify_all();
+	}
+
+	// 工作线程：取出请求求值后直接写回所属连接，完成顺序即响应顺序
+	void calculator_server::work(size_t memo_capacity) {
+		std::unique_ptr<call_memo> memo = memo_capacity != 0 ? std::make_unique<call_memo>(memo_capacity) : nullptr;
+		std::string result, frame;
+		while (true) {
+			request next;
+			{
+				std::unique_lock<std::mutex> lock(m_queue_mutex);
+				m_queue_ready.wait(lock, [this]() { return !m_queue.empty() || m_workers_exit; });
+				if (m_queue.empty()) {
+					return;
+				}
+				next = std::move(m_queue.front());
+				m_queue.pop_front();
+			}
+			bool ok = evaluate_line(next.text, m_cache, memo.get(), result);
+			frame.clear();
+			put_u32(frame, static_cast<std::uint32_t>(result.size()));
+			put_u64(frame, next.id);
+			frame.push_back(ok ? 1 : 0);
+			frame.append(result);
+			m_requests++;
+			m_failures += !ok;
+			std::lock_guard<std::mutex> lock(next.client->write_mutex);
+			if (!next.client->broken) {
+				next.client->broken = !send_all(next.client->socket, frame.data(), frame.size());
+			}
+		}
+	}
+
+	server_statistics calculator_server::statistics() const {
+		server_statistics stats;
+		stats.connections = m_connections;
+		stats.requests = m_requests;
+		stats.failures = m_failures;
+		stats.protocol_errors = m_protocol_errors;
+		return stats;
+	}
+
+	// 每个连接一个线程，发送与接收交替进行：先补足 depth 个未响应请求一次发出，再读取已到达的响应
+	// 请求编号即该连接内的发送序号，用来查发送时刻
+	load_summary generate_load(const std::string& path, const std::vector<std::string>& lines,
+		size_t connections, size_t total, size_t depth) {
+		if (lines.empty()) {
+			throw std::runtime_error("负载生成没有可发送的请求");
+		}
+		connections = std::max<size_t>(1, connections);
+		depth = std::max<size_t>(1, depth);
+		sockaddr_un address = socket_address(path);
+		using clock = std::chrono::steady_clock;
+		std::vector<std::vector<double>> latencies(connections);
+		std::vector<size_t> failures(connections, 0);
+		std::vector<std::string> errors(connections);
+
+		auto drive = [&](size_t index) {
+			size_t quota = total / connections + (index < total % connections ? 1 : 0);
+			std::vector<clock::time_point> sent_at(quota);
+			std::vector<double>& samples = latencies[index];
+			samples.reserve(quota);
+			socket_handle s = INVALID_HANDLE;
+			try {
+				s = open_socket();
+				if (::connect(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+					throw std::runtime_error("无法连接到 " + path);
+				}
+				std::string out;
+				std::vector<char> buffer;
+				size_t sent = 0, received = 0, consumed = 0;
+				while (received < quota) {
+					out.clear();
+					for (; sent < quota && sent - received < depth; sent++) {
+						const std::string& text = lines[(index + sent * connections) % lines.size()];
+						put_u32(out, static_cast<std::uint32_t>(text.size()));
+						put_u64(out, sent);
+						out.append(text);
+						sent_at[sent] = clock::now();
+					}
+					if (!out.empty() && !send_all(s, out.data(), out.size())) {
+						throw std::runtime_error("发送请求失败");
+					}
+					if (receive_some(s, buffer) == 0) {
+						throw std::runtime_error("服务端关闭了连接");
+					}
+					clock::time_point now = clock::now();
+					while (buffer.size() - consumed >= RESPONSE_HEADER_SIZE) {
+						const char* header = buffer.data() + consumed;
+						size_t length = static_cast<size_t>(get_le(header, 4));
+						if (buffer.size() - consumed < RESPONSE_HEADER_SIZE + length) {
+							break;
+						}
+						std::uint64_t id = get_le(header + 4, 8);
+						if (id >= quota) {
+							throw std::runtime_error("响应的请求编号无效");
+						}
+						samples.push_back(std::chrono::duration<double, std::micro>(now - sent_at[id]).count());
+						failures[index] += header[12] == 0;
+						consumed += RESPONSE_HEADER_SIZE + length;
+						received++;
+					}
+					buffer.erase(buffer.begin(), buffer.begin() + consumed);
+					consumed = 0;
+				}
+			}
+			catch (const std::exception& e) {
+				errors[index] = e.what();
+			}
+			if (s != INVALID_HANDLE) {
+				close_socket(s);
+			}
+		};
+
+		auto begin = clock::now();
+		std::vector<std::thread> clients;
+		for (size_t i = 1; i < connections; i++) {
+			clients.emplace_back(drive, i);
+		}
+		drive(0);
+		for (auto& client : clients) {
+			client.join();
+		}
+		auto end = clock::now();
+		for (const auto& error : errors) {
+			if (!error.empty()) {
+				throw std::runtime_error(error);
+			}
+		}
+
+		load_summary summary;
+		std::vector<double> all;
+		for (const auto& samples : latencies) {
+			all.insert(all.end(), samples.begin(), samples.end());
+		}
+		std::sort(all.begin(), all.end());
+		auto percentile = [&](double fraction) {
+			return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(fraction * all.size()))];
+		};
+		summary.requests = all.size();
+		for (size_t count : failures) {
+			summary.failures += count;
+		}
+		summary.seconds = std::chrono::duration<double>(end - begin).count();
+		summary.qps = summary.requests / summary.seconds;
+		summary.p50_us = percentile(0.50);
+		summary.p99_us = percentile(0.99);
+		summary.p999_us = percentile(0.999);
+		summary.max_us = all.empty() ? 0.0 : all.back();
+		return summary;
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "stream.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace chr {
+
+	// 服务模式的帧格式（整数均为小端）：
+	//   请求: u32 正文长度 | u64 请求编号 | 正文（与流式模式的一行相同: <expression> [; name=value ...]）
+	//   响应: u32 正文长度 | u64 请求编号 | u8 状态（1 成功, 0 出错）| 正文（结果或错误信息）
+	// 同一连接上可以连续发送多个请求而不等待响应；响应按求值完成的先后返回，由请求编号对应
+	constexpr size_t REQUEST_HEADER_SIZE = 12;
+	constexpr size_t RESPONSE_HEADER_SIZE = 13;
+	constexpr size_t MAX_REQUEST_SIZE = 1 << 20; // 正文超过此长度视为协议错误并断开连接
+
+	// 服务统计
+	struct server_statistics {
+		uint64_t connections = 0; // 累计接受的连接数
+		uint64_t requests = 0;    // 已响应的请求数
+		uint64_t failures = 0;    // 出错的请求数
+		uint64_t protocol_errors = 0; // 因帧格式错误断开的连接数
+	};
+
+	// 常驻计算服务：在 Unix 域套接字上接受连接，每个连接一个读线程负责拆帧，
+	// 请求放入共享队列由 threads 个工作线程求值（已编译表达式经 cache 复用），工作线程直接写回响应
+	// memo_capacity 非 0 时每个工作线程各带一张纯函数调用记忆表
+	class calculator_server {
+		struct connection;
+		struct request {
+			std::shared_ptr<connection> client;
+			std::uint64_t id;
+			std::string text;
+		};
+
+		std::string m_path;
+		expression_cache& m_cache;
+		std::intptr_t m_listener;
+		std::atomic<bool> m_stopping{ false };
+
+		std::mutex m_queue_mutex;
+		std::condition_variable m_queue_ready;
+		std::deque<request> m_queue;
+		std::vector<std::thread> m_workers;
+		bool m_workers_exit = false; // 队列取空后退出（受 m_queue_mutex 保护）
+
+		// 读线程各自分离运行，析构时断开 m_clients 中仍存活的连接并等待 m_active_readers 归零
+		std::mutex m_clients_mutex;
+		std::condition_variable m_readers_done;
+		std::vector<std::weak_ptr<connection>> m_clients;
+		size_t m_active_readers = 0;
+
+		std::atomic<uint64_t> m_connections{ 0 };
+		std::atomic<uint64_t> m_requests{ 0 };
+		std::atomic<uint64_t> m_failures{ 0 };
+		std::atomic<uint64_t> m_protocol_errors{ 0 };
+	private:
+		void work(size_t memo_capacity);
+		void read(std::shared_ptr<connection> client);
+	public:
+		// 绑定并监听 path（上次运行遗留的同名套接字文件先删除），path 已存在且不是套接字或监听失败时抛出异常
+		calculator_server(const std::string& path, expression_cache& cache, size_t threads, size_t memo_capacity = 0);
+		calculator_server(const calculator_server&) = delete;
+		calculator_server& operator=(const calculator_server&) = delete;
+		~calculator_server();
+
+		// 在调用线程中接受连接，直到 stop 被调用
+		void run();
+		// 可从其他线程调用：run 至多在 100ms 后返回；析构时再断开现有连接，已入队的请求处理完毕后才退出
+		void stop();
+		server_statistics statistics() const;
+	};
+
+	// 负载生成汇总
+	struct load_summary {
+		size_t requests = 0;  // 收到响应的请求数
+		size_t failures = 0;  // 响应状态为出错的请求数
+		double seconds = 0.0; // 总耗时
+		double qps = 0.0;     // 每秒完成的请求数
+		double p50_us = 0.0;  // 从发出请求到收到响应的延迟分位数
+		double p99_us = 0.0;
+		double p999_us = 0.0;
+		double max_us = 0.0;
+	};
+
+	// 本地负载生成器：建立 connections 个连接，每个连接保持至多 depth 个未响应的请求，
+	// 循环发送 lines 中的请求，共发送 total 个，统计持续吞吐与尾延迟
+	load_summary generate_load(const std::string& path, const std::vector<std::string>& lines,
+		size_t connections, size_t total, size_t depth);
+}
+
+#endif // SERVER_HPP
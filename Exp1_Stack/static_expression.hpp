@@ -0,0 +1,503 @@
+#ifndef STATIC_EXPRESSION_HPP
+#define STATIC_EXPRESSION_HPP
+
+#include "calculator.hpp"
+#include <array>
+#include <bit>
+#include <utility>
+
+namespace chr {
+
+	// 编译期字面量转换：结果与运行时按最近舍入解析的结果相同（含次正规数）
+	// 与运行时一样，十进制字面量舍入为 0 或溢出时视为错误，进制字面量下溢得到 0、溢出得到 inf
+	namespace compile_time {
+		// 十进制字面量最多的有效数字个数，限制大整数的位数
+		constexpr size_t MAX_DECIMAL_DIGITS = 200;
+
+		// 定长无符号大整数：32 位一节、低位在前，只提供字面量转换所需的运算
+		class big_unsigned {
+			static constexpr size_t LIMBS = 128;
+			std::uint32_t m_limbs[LIMBS] = {};
+			size_t m_size = 0; // 有效节数（最高节非零）
+		private:
+			constexpr void trim() {
+				while (m_size > 0 && m_limbs[m_size - 1] == 0) {
+					m_size--;
+				}
+			}
+		public:
+			constexpr big_unsigned() = default;
+			constexpr explicit big_unsigned(std::uint32_t value) {
+				m_limbs[0] = value;
+				m_size = value != 0;
+			}
+			constexpr bool is_zero() const { return m_size == 0; }
+			constexpr size_t bit_length() const {
+				return m_size == 0 ? 0 : (m_size - 1) * 32 + std::bit_width(m_limbs[m_size - 1]);
+			}
+			// this = this * factor + addend
+			constexpr void multiply_add(std::uint32_t factor, std::uint32_t addend) {
+				std::uint64_t carry = addend;
+				for (size_t i = 0; i < m_size; i++) {
+					std::uint64_t product = std::uint64_t(m_limbs[i]) * factor + carry;
+					m_limbs[i] = static_cast<std::uint32_t>(product);
+					carry = product >> 32;
+				}
+				if (carry != 0) {
+					if (m_size == LIMBS) {
+						throw std::overflow_error("编译期解析的字面量过长");
+					}
+					m_limbs[m_size++] = static_cast<std::uint32_t>(carry);
+				}
+			}
+			constexpr void shift_left(size_t bits) {
+				if (m_size == 0) {
+					return;
+				}
+				const size_t words = bits / 32, rest = bits % 32;
+				if (m_size + words + 1 > LIMBS) {
+					throw std::overflow_error("编译期解析的字面量过长");
+				}
+				// 从高位向低位写，读到的低位节尚未被覆盖
+				for (size_t i = m_size + words + 1; i-- > 0;) {
+					std::uint64_t high = i >= words && i - words < m_size ? m_limbs[i - words] : 0;
+					std::uint64_t low = rest != 0 && i >= words + 1 && i - words - 1 < m_size ? m_limbs[i - words - 1] : 0;
+					m_limbs[i] = static_cast<std::uint32_t>(rest == 0 ? high : (high << rest) | (low >> (32 - rest)));
+				}
+				m_size += words + 1;
+				trim();
+			}
+			// 要求 this >= other
+			constexpr void subtract(const big_unsigned& other) {
+				std::int64_t borrow = 0;
+				for (size_t i = 0; i < m_size; i++) {
+					std::int64_t difference = std::int64_t(m_limbs[i]) - (i < other.m_size ? other.m_limbs[i] : 0) - borrow;
+					borrow = difference < 0;
+					m_limbs[i] = static_cast<std::uint32_t>(difference + (borrow << 32));
+				}
+				trim();
+			}
+			friend constexpr bool operator>=(const big_unsigned& a, const big_unsigned& b) {
+				if (a.m_size != b.m_size) {
+					return a.m_size > b.m_size;
+				}
+				for (size_t i = a.m_size; i-- > 0;) {
+					if (a.m_limbs[i] != b.m_limbs[i]) {
+						return a.m_limbs[i] > b.m_limbs[i];
+					}
+				}
+				return true;
+			}
+		};
+
+		// 2^exponent，exponent 在 [-1074, 1023] 内时结果精确
+		constexpr double power_of_two(int exponent) {
+			double result = 1;
+			for (; exponent > 0; exponent--) {
+				result *= 2;
+			}
+			for (; exponent < 0; exponent++) {
+				result *= 0.5;
+			}
+			return result;
+		}
+
+		// 把 numerator / denominator · 2^exponent 舍入为 double（最近舍入，平局取偶）
+		// 先缩放使商有 63~64 位，商的低位与余数决定舍入方向；次正规数的最低位固定为 2^-1074，
+		// 保留的位数相应减少，全部舍去时得到 0，超出最大有限值时得到 inf
+		constexpr double round_quotient(big_unsigned numerator, big_unsigned denominator, int exponent) {
+			int shift = 63 - (static_cast<int>(numerator.bit_length()) - static_cast<int>(denominator.bit_length()));
+			if (shift >= 0) {
+				numerator.shift_left(shift);
+			}
+			else {
+				denominator.shift_left(-shift);
+			}
+			std::uint64_t quotient = 0;
+			for (int bit = 63; bit >= 0; bit--) {
+				big_unsigned divisor = denominator;
+				divisor.shift_left(bit);
+				if (numerator >= divisor) {
+					numerator.subtract(divisor);
+					quotient |= std::uint64_t(1) << bit;
+				}
+			}
+			const int low = exponent - shift; // 商最低位的权 2^low
+			const int top = static_cast<int>(std::bit_width(quotient)) - 1 + low;
+			int dropped = std::bit_width(quotient) - 53;
+			if (top < -1022) {
+				dropped += -1022 - top;
+			}
+			if (dropped > 64) {
+				return 0;
+			}
+			std::uint64_t mantissa = dropped == 64 ? 0 : quotient >> dropped;
+			std::uint64_t rest = dropped == 64 ? quotient : quotient & ((std::uint64_t(1) << dropped) - 1);
+			std::uint64_t half = std::uint64_t(1) << (dropped - 1);
+			if (rest > half || (rest == half && (!numerator.is_zero() || (mantissa & 1)))) {
+				mantissa++;
+				if (mantissa >> 53) {
+					mantissa >>= 1;
+					dropped++;
+				}
+			}
+			if (mantissa == 0) {
+				return 0;
+			}
+			int scale = dropped + low;
+			if (scale + static_cast<int>(std::bit_width(mantissa)) - 1 > 1023) {
+				return INFINITY;
+			}
+			return static_cast<double>(mantissa) * power_of_two(scale);
+		}
+
+		// 十进制字面量 (\d+\.?\d*|\.\d+)([eE][-+]?\d+)?
+		constexpr double decimal_value(std::string_view text) {
+			big_unsigned digits;
+			size_t significant = 0;
+			int exponent = 0;
+			bool fraction = false;
+			size_t i = 0;
+			for (; i < text.size() && (lexer::is_digit(text[i]) || text[i] == '.'); i++) {
+				if (text[i] == '.') {
+					fraction = true;
+					continue;
+				}
+				exponent -= fraction;
+				// 前导零不计入有效数字
+				if (significant == 0 && text[i] == '0') {
+					continue;
+				}
+				if (++significant > MAX_DECIMAL_DIGITS) {
+					throw std::out_of_range("编译期解析的十进制字面量有效数字过多");
+				}
+				digits.multiply_add(10, text[i] - '0');
+			}
+			if (i < text.size()) {
+				bool negative = text[++i] == '-';
+				i += text[i] == '-' || text[i] == '+';
+				int value = 0;
+				for (; i < text.size(); i++) {
+					value = std::min(value * 10 + (text[i] - '0'), 100000);
+				}
+				exponent += negative ? -value : value;
+			}
+			if (digits.is_zero()) {
+				return 0;
+			}
+			// 值位于 [10^(magnitude-1), 10^magnitude)，明显超出范围时直接报错，避免构造过大的 10 的幂
+			// （10^-324 小于最小次正规数的一半，必然舍入为 0）
+			int magnitude = static_cast<int>(significant) + exponent;
+			if (magnitude > 309 || magnitude < -323) {
+				throw std::out_of_range("编译期解析的字面量超出 double 范围");
+			}
+			// 正指数乘入分子，负指数作为分母 10^-exponent
+			big_unsigned power(1);
+			for (int k = 0; k < (exponent < 0 ? -exponent : exponent); k++) {
+				(exponent > 0 ? digits : power).multiply_add(10, 0);
+			}
+			double value = round_quotient(digits, power, 0);
+			if (value == 0 || value == INFINITY) {
+				throw std::out_of_range("编译期解析的字面量超出 double 范围");
+			}
+			return value;
+		}
+
+		// 进制字面量 0b/0o/0x：整数与小数部分拼成一个整数，再按每位的比特数整体缩放，没有中间舍入
+		constexpr double radix_value(std::string_view text, int bits_per_digit) {
+			big_unsigned digits;
+			int exponent = 0;
+			bool fraction = false;
+			for (size_t i = 2; i < text.size(); i++) {
+				char c = text[i];
+				if (c == '.') {
+					fraction = true;
+					continue;
+				}
+				int digit = c <= '9' ? c - '0' : c <= 'Z' ? c - 'A' + 10 : c - 'a' + 10;
+				digits.multiply_add(std::uint32_t(1) << bits_per_digit, digit);
+				exponent -= fraction ? bits_per_digit : 0;
+			}
+			return digits.is_zero() ? 0 : round_quotient(digits, big_unsigned(1), exponent);
+		}
+
+		constexpr double literal_value(std::string_view text, token_t type) {
+			switch (type) {
+			case token_t::decimal_number: return decimal_value(text);
+			case token_t::binary_number: return radix_value(text, 1);
+			case token_t::octal_number: return radix_value(text, 3);
+			case token_t::hexadecimal_number: return radix_value(text, 4);
+			default: break;
+			}
+			if (text == "PI") {
+				return CONSTANT_PI;
+			}
+			if (text == "E") {
+				return CONSTANT_E;
+			}
+			if (text == "PHI") {
+				return CONSTANT_PHI;
+			}
+			throw std::runtime_error("出现无效常数");
+		}
+
+		// 编译期分词结果，供 check_token 检查
+		struct static_lexeme {
+			token_t type;
+			std::string_view text;
+		};
+	}
+
+	// 可作为模板实参的字符串字面量
+	template <size_t N>
+	struct fixed_string {
+		char data[N] = {};
+		constexpr fixed_string(const char(&text)[N]) {
+			for (size_t i = 0; i < N; i++) {
+				data[i] = text[i];
+			}
+		}
+		constexpr std::string_view view() const { return { data, N - 1 }; }
+	};
+
+	// 编译期解析结果：字节码与每条指令执行前的栈深度
+	// 指令数不超过源串长度，Capacity 取源串长度即可
+	template <size_t Capacity>
+	struct static_program {
+		std::array<instruction, Capacity> code{};
+		std::array<size_t, Capacity> depth{};
+		size_t length = 0;
+		size_t max_depth = 0;
+		std::array<std::string_view, Capacity> variables{}; // 变量名，按首次出现顺序分配槽位
+		size_t variable_count = 0;
+	};
+
+	// 在编译期完成分词、验证与中缀转后缀，语法与 expression 相同（不支持自定义函数）：
+	// 分词与局部检查直接调用 scan_token / check_token，运算符的优先级与操作数个数取自 operator_table；
+	// 函数调用在转后缀时处理，多参数函数的参数依次折叠为二元运算，与 expression::scan 的展开结果一致
+	// 表达式非法时抛出异常，在常量求值中即为编译错误
+	template <size_t Capacity>
+	constexpr static_program<Capacity> parse_static(std::string_view source) {
+		using compile_time::static_lexeme;
+		std::array<static_lexeme, Capacity> lexemes{};
+		size_t count = 0;
+		for (size_t pos = 0; pos < source.size();) {
+			token_t type = token_t::invalid_token;
+			size_t len = scan_token(source, pos, type);
+			if (len == 0) {
+				char c = source[pos];
+				if (c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '\v' && c != '\f') {
+					throw std::runtime_error("表达式含有无法识别的字符");
+				}
+				pos++;
+				continue;
+			}
+			std::string_view text = source.substr(pos, len);
+			if ((text == "+" || text == "-") && (count == 0 || ((token_t::operator_token & lexemes[count - 1].type)
+				&& lexemes[count - 1].text != ")" && lexemes[count - 1].text != "!"))) {
+				type = token_t::signal_operator;
+				text = text == "+" ? "pos" : "neg";
+			}
+			lexemes[count++] = { type, text };
+			pos += len;
+		}
+		std::span<const static_lexeme> tokens(lexemes.data(), count);
+		size_t parentheses = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (tokens[i].text == "(") {
+				parentheses++;
+			}
+			else if (tokens[i].text == ")" && parentheses-- == 0) {
+				throw std::runtime_error("存在多余的右括弧");
+			}
+			if (check_token(tokens, i).count() != 0) {
+				throw std::runtime_error("表达式的运算符序列、数字或函数调用格式非法");
+			}
+		}
+		if (parentheses != 0) {
+			throw std::runtime_error("存在多余的左括弧");
+		}
+
+		static_program<Capacity> result;
+		size_t depth = 0;
+		auto emit = [&](instruction ins) {
+			byte arity = ins.op == opcode::push_number || ins.op == opcode::push_variable ? 0 : operator_lookup(ins.op).operand_num;
+			if (arity > depth) {
+				throw std::runtime_error("表达式结构错误：运算符缺少操作数");
+			}
+			result.depth[result.length] = depth;
+			result.code[result.length++] = ins;
+			depth = depth - arity + 1;
+			result.max_depth = std::max(result.max_depth, depth);
+		};
+		// 运算符栈：左括弧记录所属的函数调用（普通括弧为 SIZE_MAX）
+		struct pending {
+			token tk;
+			size_t call;
+		};
+		// 函数调用：name 为函数名，arguments 为已完成的参数个数，start 为当前参数开始时的栈深度
+		struct call_frame {
+			std::string_view name;
+			size_t arguments;
+			size_t start;
+		};
+		std::array<pending, Capacity> ops{};
+		std::array<call_frame, Capacity> calls{};
+		size_t op_count = 0, call_count = 0;
+		// 弹出运算符直到左括弧（不弹出左括弧），返回该左括弧所属的调用；不在任何括弧内时返回 SIZE_MAX
+		auto unwind = [&]() {
+			while (op_count > 0 && ops[op_count - 1].tk.operator_code() != opcode::left_parenthesis) {
+				emit({ ops[--op_count].tk.operator_code(), 0, 0.0 });
+			}
+			return op_count > 0 ? ops[op_count - 1].call : SIZE_MAX;
+		};
+		// 一个参数结束：必须恰好留下一个值；多参数函数从第二个参数起与前面的结果折叠
+		auto finish_argument = [&](call_frame& frame) {
+			if (depth != frame.start + 1) {
+				throw std::runtime_error("函数参数为空或不完整");
+			}
+			frame.arguments++;
+			for (const auto& fn : lexer::variadic_functions) {
+				if (frame.name == fn.name && frame.arguments >= 2) {
+					emit({ fn.op, 0, 0.0 });
+				}
+			}
+			frame.start = depth;
+		};
+		for (size_t i = 0; i < count; i++) {
+			const static_lexeme& lx = tokens[i];
+			if (token_t::number_token & lx.type) {
+				emit({ opcode::push_number, 0, compile_time::literal_value(lx.text, lx.type) });
+			}
+			else if (lx.type == token_t::variable_token) {
+				size_t slot = 0;
+				while (slot < result.variable_count && result.variables[slot] != lx.text) {
+					slot++;
+				}
+				if (slot == result.variable_count) {
+					result.variables[result.variable_count++] = lx.text;
+				}
+				emit({ opcode::push_variable, static_cast<std::uint32_t>(slot), 0.0 });
+			}
+			// 函数名与其后的左括弧一起入栈
+			else if (lx.type == token_t::function_operator) {
+				calls[call_count] = { lx.text, 0, depth };
+				ops[op_count++] = { token::left_parentheses(), call_count++ };
+				i++;
+			}
+			else if (lx.text == "(") {
+				ops[op_count++] = { token::left_parentheses(), SIZE_MAX };
+			}
+			else if (lx.text == ",") {
+				size_t call = unwind();
+				if (call == SIZE_MAX) {
+					throw std::runtime_error("逗号只能用于分隔函数参数");
+				}
+				finish_argument(calls[call]);
+			}
+			else if (lx.text == ")") {
+				size_t call = unwind();
+				op_count--;
+				if (call == SIZE_MAX) {
+					continue;
+				}
+				call_frame& frame = calls[call];
+				finish_argument(frame);
+				bool variadic = false;
+				for (const auto& fn : lexer::variadic_functions) {
+					variadic = variadic || frame.name == fn.name;
+				}
+				if (!variadic) {
+					if (frame.arguments != 1) {
+						throw std::runtime_error("内置函数只接受 1 个参数");
+					}
+					emit({ token::try_parse_operator(frame.name)->operator_code(), 0, 0.0 });
+				}
+			}
+			// 与 expression 的语法树解析一致：一元 pos/neg 是前缀运算符，入栈时不弹出任何运算符；^ 右结合，只弹出更高优先级
+			else {
+				token tk = *token::try_parse_operator(lx.text);
+				bool prefix = lx.type == token_t::signal_operator;
+				bool right_associative = tk.operator_code() == opcode::exponent;
+				while (!prefix && op_count > 0 && (ops[op_count - 1].tk.operator_prioriry() > tk.operator_prioriry() ||
+					(!right_associative && ops[op_count - 1].tk.operator_prioriry() == tk.operator_prioriry()))) {
+					emit({ ops[--op_count].tk.operator_code(), 0, 0.0 });
+				}
+				ops[op_count++] = { tk, SIZE_MAX };
+			}
+		}
+		while (op_count > 0) {
+			emit({ ops[--op_count].tk.operator_code(), 0, 0.0 });
+		}
+		if (depth != 1) {
+			throw std::runtime_error("表达式结构错误：计算结果不是单一数值");
+		}
+		return result;
+	}
+
+	// 编译期表达式：模板实参为表达式文本，文本非法时编译失败
+	// 求值时按编译期确定的指令序列逐条展开，每条指令的操作码与栈位置都是常量，运算经 operator_table 的执行函数内联，
+	// 运行时没有解析、分派与栈指针维护；不做常量折叠与公共子表达式归并，这些交给编译器完成
+	// 编译器可能在编译期以更高精度折叠常数参数的库函数调用，因此与运行时求值的结果可能相差最后一位
+	// 用法：using formula = chr::static_expression<"x * 2 + sin(y)">; double r = formula::evaluate(1.0, 2.0);
+	template <fixed_string Source>
+	class static_expression {
+		static constexpr auto m_program = parse_static<sizeof(Source.data)>(Source.view());
+	private:
+		template <size_t I>
+		static void step(double* stack, const double* variables) {
+			constexpr instruction ins = m_program.code[I];
+			constexpr size_t top = m_program.depth[I];
+			if constexpr (ins.op == opcode::push_number) {
+				stack[top] = ins.value;
+			}
+			else if constexpr (ins.op == opcode::push_variable) {
+				stack[top] = variables[ins.slot];
+			}
+			else if constexpr (operator_lookup(ins.op).operand_num == 1) {
+				stack[top - 1] = operator_lookup(ins.op).apply(stack[top - 1], 0);
+			}
+			else {
+				stack[top - 2] = operator_lookup(ins.op).apply(stack[top - 2], stack[top - 1]);
+			}
+		}
+		template <size_t... I>
+		static double run(const double* variables, std::index_sequence<I...>) {
+			double stack[m_program.max_depth];
+			(step<I>(stack, variables), ...);
+			return stack[0];
+		}
+	public:
+		static constexpr size_t variable_count = m_program.variable_count;
+		static constexpr std::string_view source() { return Source.view(); }
+		static constexpr std::string_view variable(size_t slot) { return m_program.variables[slot]; }
+		static constexpr size_t variable_slot(std::string_view name) {
+			for (size_t slot = 0; slot < variable_count; slot++) {
+				if (m_program.variables[slot] == name) {
+					return slot;
+				}
+			}
+			throw std::runtime_error("表达式中不存在变量：" + std::string(name));
+		}
+		static constexpr std::span<const instruction> program() { return { m_program.code.data(), m_program.length }; }
+		static constexpr size_t max_depth() { return m_program.max_depth; }
+
+		// values 按变量槽位排列
+		static double evaluate(std::span<const double> values) {
+			if (values.size() < variable_count) {
+				throw std::runtime_error("变量绑定数量不足：需要 " + std::to_string(variable_count) + " 个");
+			}
+			return run(values.data(), std::make_index_sequence<m_program.length>());
+		}
+		// 按变量槽位顺序逐个传入变量值
+		template <typename... Values>
+			requires (std::is_arithmetic_v<Values> && ...)
+		static double evaluate(Values... values) {
+			static_assert(sizeof...(Values) == variable_count, "传入的值个数须与表达式的变量数相同");
+			const double bound[] = { static_cast<double>(values)..., 0.0 };
+			return run(bound, std::make_index_sequence<m_program.length>());
+		}
+	};
+}
+
+#endif // STATIC_EXPRESSION_HPP
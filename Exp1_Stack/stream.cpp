@@ -0,0 +1,220 @@
+#include "stream.hpp"
+#include <atomic>
+#include <barrier>
+#include <charconv>
+#include <chrono>
+#include <string_view>
+#include <thread>
+
+namespace chr {
+	namespace {
+		constexpr size_t STREAM_BUFFER_SIZE = 1 << 20;
+		constexpr size_t STREAM_CHUNK_LINES = 4096;
+
+		// 大缓冲区行读取器：一次 fread 1MB，按 '\n' 切分并去掉行尾 '\r'
+		class line_reader {
+			std::FILE* m_file;
+			std::vector<char> m_buffer;
+			size_t m_begin = 0, m_end = 0;
+			bool m_eof = false;
+		public:
+			explicit line_reader(std::FILE* file) :m_file(file), m_buffer(STREAM_BUFFER_SIZE) {}
+			bool next(std::string& line) {
+				line.clear();
+				while (true) {
+					const char* first = m_buffer.data() + m_begin;
+					const char* newline = static_cast<const char*>(std::memchr(first, '\n', m_end - m_begin));
+					if (newline != nullptr) {
+						line.append(first, newline);
+						m_begin += newline - first + 1;
+						break;
+					}
+					line.append(first, m_end - m_begin);
+					m_begin = m_end = 0;
+					if (m_eof) {
+						if (line.empty()) {
+							return false;
+						}
+						break;
+					}
+					m_end = std::fread(m_buffer.data(), 1, m_buffer.size(), m_file);
+					m_eof = m_end < m_buffer.size();
+				}
+				if (!line.empty() && line.back() == '\r') {
+					line.pop_back();
+				}
+				return true;
+			}
+		};
+
+		// 缓冲写入器：累积到 1MB 再一次性 fwrite
+		class buffered_writer {
+			std::FILE* m_file;
+			std::string m_buffer;
+		public:
+			explicit buffered_writer(std::FILE* file) :m_file(file) { m_buffer.reserve(STREAM_BUFFER_SIZE); }
+			~buffered_writer() { flush(); }
+			void write(std::string_view text) {
+				m_buffer.append(text);
+				if (m_buffer.size() >= STREAM_BUFFER_SIZE) {
+					flush();
+				}
+			}
+			void flush() {
+				std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+				m_buffer.clear();
+			}
+		};
+
+		bool is_blank(const std::string& line) {
+			return std::all_of(line.begin(), line.end(), [](char ch) { return std::isspace(static_cast<unsigned char>(ch)); });
+		}
+
+		// 按 -calc 的规则解析 "name=value" 列表并检查所有变量均已赋值
+		bindings bind_assignments(const expression& expr, const std::string& assignments) {
+			bindings values(expr.variables().size());
+			std::vector<bool> bound(expr.variables().size(), false);
+			std::istringstream stream(assignments);
+			std::string assignment;
+			while (stream >> assignment) {
+				size_t eq = assignment.find('=');
+				if (eq == std::string::npos) {
+					throw std::runtime_error("变量赋值格式应为 name=value: " + assignment);
+				}
+				size_t slot = expr.variable_slot(assignment.substr(0, eq));
+				values[slot] = std::stod(assignment.substr(eq + 1));
+				bound[slot] = true;
+			}
+			for (size_t slot = 0; slot < bound.size(); slot++) {
+				if (!bound[slot]) {
+					throw std::runtime_error("变量未赋值: " + std::string(expr.variables()[slot]));
+				}
+			}
+			return values;
+		}
+
+		double percentile(std::vector<double>& samples, double fraction) {
+			if (samples.empty()) {
+				return 0.0;
+			}
+			size_t rank = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+			std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+			return samples[rank];
+		}
+	}
+
+	bool evaluate_line(const std::string& line, expression_cache& cache, call_memo* memo, std::string& result) {
+		try {
+			size_t separator = line.find(';');
+			auto compiled = cache.get(line.substr(0, separator));
+			bindings values = separator == std::string::npos
+				? bind_assignments(*compiled, "") : bind_assignments(*compiled, line.substr(separator + 1));
+			double value = memo != nullptr
+				? compiled->evaluate(std::span<const double>(values.data(), values.size()), *memo) : compiled->evaluate(values);
+			// 与 std::cout 默认格式一致（%g，6 位有效数字）
+			char text[32];
+			auto [end, ec] = std::to_chars(text, text + sizeof(text), value, std::chars_format::general, 6);
+			result.assign(text, end);
+			return true;
+		}
+		catch (const std::exception& e) {
+			// 错误信息可能跨行，压成一行以保持输入输出逐行对应
+			result = std::string("错误: ") + e.what();
+			std::replace(result.begin(), result.end(), '\n', ' ');
+			return false;
+		}
+	}
+
+	stream_summary evaluate_stream(std::FILE* input, std::FILE* output, expression_cache& cache, size_t threads,
+		size_t memo_capacity) {
+		threads = std::max<size_t>(1, threads);
+		// 第 t 张记忆表只由第 t 个线程使用（主线程为 0 号）
+		std::vector<call_memo> memos;
+		if (memo_capacity != 0) {
+			memos.assign(threads, call_memo(memo_capacity));
+		}
+		line_reader reader(input);
+		buffered_writer writer(output);
+		std::vector<std::string> lines(STREAM_CHUNK_LINES), results(STREAM_CHUNK_LINES);
+		std::vector<double> chunk_latency(STREAM_CHUNK_LINES), latencies;
+		std::vector<char> chunk_failed(STREAM_CHUNK_LINES);
+		size_t chunk_size = 0;
+		std::atomic<size_t> next_line{ 0 };
+		bool finished = false;
+		stream_summary summary;
+
+		// 主线程与 threads - 1 个工作线程共同处理每一块，块之间由两道屏障同步
+		auto work = [&](size_t thread) {
+			call_memo* memo = memos.empty() ? nullptr : &memos[thread];
+			for (size_t i = next_line.fetch_add(1); i < chunk_size; i = next_line.fetch_add(1)) {
+				if (is_blank(lines[i])) {
+					results[i].clear();
+					chunk_latency[i] = -1.0;
+					continue;
+				}
+				auto begin = std::chrono::steady_clock::now();
+				chunk_failed[i] = !evaluate_line(lines[i], cache, memo, results[i]);
+				auto end = std::chrono::steady_clock::now();
+				chunk_latency[i] = std::chrono::duration<double, std::nano>(end - begin).count();
+			}
+		};
+		std::barrier sync(static_cast<std::ptrdiff_t>(threads));
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < threads; t++) {
+			workers.emplace_back([&, t]() {
+				while (true) {
+					sync.arrive_and_wait(); // 等待新块就绪
+					if (finished) {
+						break;
+					}
+					work(t);
+					sync.arrive_and_wait(); // 本块处理完毕
+				}
+			});
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		while (true) {
+			chunk_size = 0;
+			while (chunk_size < STREAM_CHUNK_LINES && reader.next(lines[chunk_size])) {
+				chunk_size++;
+			}
+			if (chunk_size == 0) {
+				break;
+			}
+			next_line = 0;
+			sync.arrive_and_wait();
+			work(0);
+			sync.arrive_and_wait();
+			for (size_t i = 0; i < chunk_size; i++) {
+				writer.write(results[i]);
+				writer.write("\n");
+				if (chunk_latency[i] >= 0.0) {
+					latencies.push_back(chunk_latency[i]);
+					summary.failures += chunk_failed[i];
+				}
+			}
+		}
+		finished = true;
+		sync.arrive_and_wait();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		writer.flush();
+		auto end = std::chrono::steady_clock::now();
+
+		summary.expressions = latencies.size();
+		summary.seconds = std::chrono::duration<double>(end - begin).count();
+		summary.p50_ns = percentile(latencies, 0.50);
+		summary.p99_ns = percentile(latencies, 0.99);
+		for (const call_memo& memo : memos) {
+			summary.memo.hits += memo.statistics().hits;
+			summary.memo.misses += memo.statistics().misses;
+			summary.memo.evictions += memo.statistics().evictions;
+			summary.memo.bypassed += memo.statistics().bypassed;
+			summary.memo.entries += memo.statistics().entries;
+			summary.memo.capacity += memo.statistics().capacity;
+		}
+		return summary;
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include "expression_cache.hpp"
+#include "call_memo.hpp"
+#include <cstdio>
+
+namespace chr {
+
+	// 流式求值汇总
+	struct stream_summary {
+		size_t expressions = 0; // 处理的表达式行数（不含空行）
+		size_t failures = 0;    // 出错的行数
+		double seconds = 0.0;   // 总耗时
+		double p50_ns = 0.0;    // 单条表达式延迟中位数
+		double p99_ns = 0.0;    // 单条表达式延迟 99 分位
+		call_memo_statistics memo; // 各线程记忆表的合计（未启用时全为 0）
+	};
+
+	// 求值一行 <expression> [; name=value ...]，结果写入 result（不含换行，出错时为单行的错误信息）；返回是否成功
+	// memo 为空时不查记忆表
+	bool evaluate_line(const std::string& line, expression_cache& cache, call_memo* memo, std::string& result);
+
+	// 逐行读取 input 中的表达式并按输入顺序把结果写入 output，每行输出一行
+	// 行格式: <expression> [; name=value ...]，空行原样输出为空行
+	// 以 4096 行为一块，块内由 threads 个线程并行求值，已编译表达式经 cache 复用；
+	// 读写均使用 1MB 缓冲区
+	// memo_capacity 非 0 时每个线程各带一张该容量的纯函数调用记忆表，跨行复用相同参数的库函数调用结果
+	stream_summary evaluate_stream(std::FILE* input, std::FILE* output, expression_cache& cache, size_t threads,
+		size_t memo_capacity = 0);
+}
+
+#endif // STREAM_HPP
@@ -0,0 +1,243 @@
+#include "tokenizer_session.hpp"
+
+namespace chr {
+	namespace {
+		// 运算符序列错误编号（token_check::sequence_error，从 1 开始）对应的错误种类
+		diagnostic_code sequence_code(byte sequence_error) {
+			return static_cast<diagnostic_code>(static_cast<byte>(diagnostic_code::ends_with_operator) + sequence_error - 1);
+		}
+		enum : byte {
+			number_consecutive_digits = 1,
+			number_consecutive_operands = 2,
+		};
+
+		bool is_blank(const std::string& text) {
+			return std::all_of(text.begin(), text.end(), [](char ch) { return std::isspace(static_cast<unsigned char>(ch)); });
+		}
+	}
+
+	tokenizer_session::tokenizer_session(const std::string& text) {
+		replace(0, 0, text);
+	}
+
+	void tokenizer_session::insert(size_t offset, const std::string& text) {
+		replace(offset, 0, text);
+	}
+
+	void tokenizer_session::erase(size_t offset, size_t length) {
+		replace(offset, length, "");
+	}
+
+	// 一元 +/- 被改写为 pos/neg，源文本中仍只占一个字符
+	size_t tokenizer_session::source_end(size_t index) const {
+		const lexeme& lx = m_tokens[index];
+		return lx.offset + (lx.type == token_t::signal_operator ? 1 : lx.text.size());
+	}
+
+	size_t tokenizer_session::depth_after(size_t index) const {
+		const lexeme& lx = m_tokens[index];
+		size_t depth = m_states[index].depth;
+		if (lx.text == "(") {
+			return depth + 1;
+		}
+		if (lx.text == ")" && depth > 0) {
+			return depth - 1;
+		}
+		return depth;
+	}
+
+	void tokenizer_session::set_skipped(token_state& state, std::string skipped) {
+		m_skipped_count -= !state.skipped.empty();
+		state.skipped = is_blank(skipped) ? std::string() : std::move(skipped);
+		m_skipped_count += !state.skipped.empty();
+	}
+
+	// 与 expression_tokenizer::parse_signal_operators 相同的规则，只依赖前一个 token
+	void tokenizer_session::classify_signal(size_t index) {
+		lexeme& lx = m_tokens[index];
+		if (lx.type == token_t::signal_operator) {
+			lx.type = token_t::normal_operator;
+			lx.text.assign(1, lx.text == "pos" ? '+' : '-');
+		}
+		if (lx.text == "+" || lx.text == "-") {
+			if (index == 0 || ((token_t::operator_token & m_tokens[index - 1].type) && m_tokens[index - 1].text != ")"
+				&& m_tokens[index - 1].text != "!")) {
+				lx.type = token_t::signal_operator;
+				lx.text = lx.text == "+" ? "pos" : "neg";
+			}
+		}
+	}
+
+	// 重算单个 token 的局部检查
+	void tokenizer_session::check(size_t index) {
+		token_state& state = m_states[index];
+		m_local_errors -= state.check.count();
+		state.check = check_token(std::span<const lexeme>(m_tokens), index);
+		m_local_errors += state.check.count();
+	}
+
+	void tokenizer_session::replace(size_t offset, size_t length, const std::string& text) {
+		if (offset > m_text.size()) {
+			throw std::runtime_error("编辑位置超出表达式长度");
+		}
+		length = std::min(length, m_text.size() - offset);
+		const size_t old_edit_end = offset + length;
+		const size_t new_edit_end = offset + text.size();
+		const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(text.size()) - static_cast<std::ptrdiff_t>(length);
+		m_text.replace(offset, length, text);
+
+		// 重新扫描的起点：第一个可能受编辑影响的 token（扫描时会越过末尾查看 SCAN_LOOKAHEAD 个字符）
+		size_t first = std::partition_point(m_tokens.begin(), m_tokens.end(), [&](const lexeme& lx) {
+			return lx.offset + lx.text.size() + SCAN_LOOKAHEAD < offset;
+		}) - m_tokens.begin();
+		// partition_point 依据的文本长度对 pos/neg 偏大，只会让窗口更靠前，不影响正确性
+		size_t pos = first == 0 ? 0 : source_end(first - 1);
+
+		// 扫描新文本，直到在编辑之后与某个旧 token 的结束位置重新对齐
+		std::vector<lexeme> fresh;
+		std::vector<std::string> fresh_skipped;
+		size_t unknown = pos;
+		size_t old = first;        // 候选对齐的旧 token
+		size_t kept = m_tokens.size(); // 保留的旧 token 起点（未对齐时全部替换）
+		bool synced = false;
+		while (pos < m_text.size()) {
+			if (unknown == pos && pos >= new_edit_end && !fresh.empty()) {
+				size_t old_position = pos - delta;
+				while (old < m_tokens.size() && source_end(old) < old_position) {
+					old++;
+				}
+				if (old < m_tokens.size() && source_end(old) == old_position && old_position >= old_edit_end) {
+					kept = old + 1;
+					synced = true;
+					break;
+				}
+			}
+			token_t type = token_t::invalid_token;
+			size_t len = scan_token(m_text, pos, type);
+			if (len == 0) {
+				pos++;
+				continue;
+			}
+			fresh_skipped.push_back(m_text.substr(unknown, pos - unknown));
+			fresh.push_back({ type, m_text.substr(pos, len), pos });
+			pos += len;
+			unknown = pos;
+		}
+		if (!synced) {
+			std::string trailing = unknown < m_text.size() ? m_text.substr(unknown) : std::string();
+			m_skipped_count -= !m_trailing.empty();
+			m_trailing = is_blank(trailing) ? std::string() : std::move(trailing);
+			m_skipped_count += !m_trailing.empty();
+		}
+
+		// 用新 token 替换 [first, kept)，并平移其后 token 的位置
+		for (size_t i = first; i < kept; i++) {
+			m_skipped_count -= !m_states[i].skipped.empty();
+			m_extra_parentheses -= m_states[i].extra_parenthesis;
+			m_local_errors -= m_states[i].check.count();
+		}
+		m_tokens.erase(m_tokens.begin() + first, m_tokens.begin() + kept);
+		m_states.erase(m_states.begin() + first, m_states.begin() + kept);
+		m_tokens.insert(m_tokens.begin() + first, fresh.begin(), fresh.end());
+		m_states.insert(m_states.begin() + first, fresh.size(), token_state{});
+		const size_t fresh_end = first + fresh.size();
+		for (size_t i = fresh_end; i < m_tokens.size(); i++) {
+			m_tokens[i].offset += delta;
+		}
+		for (size_t i = first; i < fresh_end; i++) {
+			set_skipped(m_states[i], std::move(fresh_skipped[i - first]));
+		}
+		m_relexed = fresh.size();
+
+		// 一元符号判定只依赖前一个 token：重判新 token 与其后第一个保留 token
+		for (size_t i = first; i < std::min(fresh_end + 1, m_tokens.size()); i++) {
+			classify_signal(i);
+		}
+
+		// 括弧深度从窗口起点向后重算，进入保留区后一旦与旧值相同即可停止
+		for (size_t i = first; i < m_tokens.size(); i++) {
+			size_t depth = i == 0 ? 0 : depth_after(i - 1);
+			bool extra = m_tokens[i].text == ")" && depth == 0;
+			token_state& state = m_states[i];
+			if (i >= fresh_end && state.depth == depth && state.extra_parenthesis == extra) {
+				break;
+			}
+			m_extra_parentheses += extra;
+			m_extra_parentheses -= state.extra_parenthesis;
+			state.depth = depth;
+			state.extra_parenthesis = extra;
+		}
+
+		// 局部检查依赖前后各一个 token 以及是否为首尾
+		size_t check_begin = first == 0 ? 0 : first - 1;
+		size_t check_end = std::min(fresh_end + 2, m_tokens.size());
+		for (size_t i = check_begin; i < check_end; i++) {
+			check(i);
+		}
+		if (!m_tokens.empty() && check_end < m_tokens.size()) {
+			check(m_tokens.size() - 1);
+		}
+	}
+
+	bool tokenizer_session::valid() const {
+		bool balanced = m_tokens.empty() || depth_after(m_tokens.size() - 1) == 0;
+		return m_skipped_count == 0 && m_extra_parentheses == 0 && balanced && m_local_errors == 0;
+	}
+
+	// 错误范围的约定见 diagnostic；token 的源文本范围为 [offset, source_end)
+	std::vector<diagnostic> tokenizer_session::errors() const {
+		std::vector<diagnostic> result;
+		auto add = [&](diagnostic_code code, size_t begin, size_t end) {
+			result.push_back({ code, static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end) });
+		};
+		// 有无法识别的字符时 validate 只报告分词错误
+		if (m_skipped_count != 0) {
+			for (size_t i = 0; i < m_tokens.size(); i++) {
+				if (!m_states[i].skipped.empty()) {
+					add(diagnostic_code::unrecognized_character, m_tokens[i].offset - m_states[i].skipped.size(), m_tokens[i].offset);
+				}
+			}
+			if (!m_trailing.empty()) {
+				add(diagnostic_code::trailing_characters, m_text.size() - m_trailing.size(), m_text.size());
+			}
+			return result;
+		}
+		std::vector<size_t> open;
+		for (size_t i = 0; i < m_tokens.size(); i++) {
+			if (m_tokens[i].text == "(") {
+				open.push_back(i);
+			}
+			else if (m_states[i].extra_parenthesis) {
+				add(diagnostic_code::extra_right_parenthesis, m_tokens[i].offset, source_end(i));
+			}
+			else if (m_tokens[i].text == ")") {
+				open.pop_back();
+			}
+		}
+		for (auto it = open.rbegin(); it != open.rend(); ++it) {
+			add(diagnostic_code::extra_left_parenthesis, m_tokens[*it].offset, source_end(*it));
+		}
+		if (m_local_errors == 0) {
+			return result;
+		}
+		for (size_t i = 0; i < m_tokens.size(); i++) {
+			if (m_states[i].check.sequence_error != 0) {
+				add(sequence_code(m_states[i].check.sequence_error), m_tokens[i].offset, source_end(i));
+			}
+		}
+		for (size_t i = 1; i < m_tokens.size(); i++) {
+			if (m_states[i].check.number_error == number_consecutive_digits) {
+				add(diagnostic_code::consecutive_digits, m_tokens[i - 1].offset, source_end(i));
+			}
+			else if (m_states[i].check.number_error == number_consecutive_operands) {
+				add(diagnostic_code::consecutive_operands, m_tokens[i - 1].offset, source_end(i));
+			}
+		}
+		for (size_t i = 0; i < m_tokens.size(); i++) {
+			if (m_states[i].check.function_error) {
+				add(diagnostic_code::function_without_call, m_tokens[i].offset, source_end(i));
+			}
+		}
+		return result;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef TOKENIZER_SESSION_HPP
+#define TOKENIZER_SESSION_HPP
+
+#include "calculator.hpp"
+
+namespace chr {
+
+	// 增量分词会话：用于交互式编辑，每次插入/删除只重新扫描受影响的 token 窗口
+	// tokens()、errors()、valid() 与对当前文本调用 expression_tokenizer::validate 的结果一致
+	// 每个 token 保存其局部检查结果（运算符序列、连续数字、函数调用）与括弧深度，
+	// 编辑后只重算窗口及相邻 token 的检查；括弧深度从窗口开始向后重算，直到与旧值重合为止
+	class tokenizer_session {
+		// 单个 token 的增量状态
+		struct token_state {
+			std::string skipped;            // 该 token 之前无法识别的内容（全为空白时为空）
+			size_t depth = 0;               // 该 token 之前未闭合的左括弧数（多余的右括弧不计入）
+			bool extra_parenthesis = false; // 是否为多余的右括弧
+			token_check check;              // 局部检查结果
+		};
+
+		std::string m_text;
+		std::vector<lexeme> m_tokens;     // 与 expression_tokenizer::tokens() 相同（一元 +/- 已改写为 pos/neg）
+		std::vector<token_state> m_states;
+		std::string m_trailing;           // 末尾无法识别的内容
+		size_t m_skipped_count = 0;       // 含无法识别内容的间隙数（含末尾）
+		size_t m_extra_parentheses = 0;   // 多余的右括弧数
+		size_t m_local_errors = 0;        // 序列 / 数字 / 函数检查的错误总数
+		size_t m_relexed = 0;             // 最近一次编辑重新扫描出的 token 数
+	private:
+		size_t source_end(size_t index) const; // token 在源文本中的结束位置
+		size_t depth_after(size_t index) const;
+		void classify_signal(size_t index);
+		void check(size_t index);
+		void set_skipped(token_state& state, std::string skipped);
+	public:
+		tokenizer_session() = default;
+		explicit tokenizer_session(const std::string& text);
+
+		// 编辑：offset 为源文本中的字节位置，超出文本长度时抛出异常
+		void insert(size_t offset, const std::string& text);
+		void erase(size_t offset, size_t length);
+		void replace(size_t offset, size_t length, const std::string& text);
+
+		const std::string& text() const { return m_text; }
+		const std::vector<lexeme>& tokens() const { return m_tokens; }
+		size_t relexed_tokens() const { return m_relexed; }
+		bool valid() const;
+		// 按 expression_tokenizer::validate 的顺序生成错误列表，可用 render_diagnostics(text(), tokens(), ...) 格式化
+		std::vector<diagnostic> errors() const;
+	};
+}
+
+#endif // TOKENIZER_SESSION_HPP